@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include "instrument_mpi.h"
 
 // mpicc -o pi compute_pi_mpi.c
 // mpirun -np 4 ./pi
@@ -35,9 +36,10 @@ int main(int argc, char** argv) {
     long long points_in_circle = 0;
 
     // Début du chronomètre
-    double start_time = MPI_Wtime();
+    double start_time = instr_wtime();
 
     // Génération des points et comptage
+    INSTR_BEGIN("tirage");
     for (long long i = 0; i < points_per_process; i++) {
         double x = random_double();
         double y = random_double();
@@ -46,12 +48,17 @@ int main(int argc, char** argv) {
         }
     }
 
+    INSTR_END("tirage");
+    INSTR_COUNT("points_cercle", (double)points_in_circle);
+
     // Communication des résultats au processus maître
     long long total_points_in_circle;
+    INSTR_BEGIN("reduction");
     MPI_Reduce(&points_in_circle, &total_points_in_circle, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    INSTR_END("reduction");
 
     // Fin du chronomètre
-    double end_time = MPI_Wtime();
+    double end_time = instr_wtime();
 
     // Calcul de pi par le processus maître
     if (rank == 0) {
@@ -60,6 +67,8 @@ int main(int argc, char** argv) {
         printf("Temps écoulé : %.6f secondes\n", end_time - start_time);
     }
 
+    INSTR_REPORT_MPI(MPI_COMM_WORLD);
+
     // Finalisation de MPI
     MPI_Finalize();
     return 0;
@@ -4,6 +4,7 @@
 #if defined(_OPENMP)
 #include <omp.h>
 #endif
+#include "instrument.h"
 
 // gcc -fopenmp -o pi_omp compute_pi_omp.c
 // OMP_NUM_THREADS=4 ./pi_omp
@@ -26,11 +27,13 @@ int main(int argc, char** argv) {
     // Compteur de points dans le cercle
     long long points_in_circle = 0;
 
+    INSTR_INIT();
     // Début du chronomètre
-    double start_time = omp_get_wtime();
+    double start_time = instr_wtime();
 
     #pragma omp parallel
     {
+        INSTR_BEGIN("tirage");
         // Chaque thread a son prope counteur local
         long long local_points_in_circle = 0;
 
@@ -47,16 +50,20 @@ int main(int argc, char** argv) {
             }
         }
 
+        INSTR_END("tirage");
+        INSTR_COUNT("points_cercle", (double)local_points_in_circle);
+
         #pragma omp atomic
         points_in_circle += local_points_in_circle;
     }
 
     // Fin du chronomètre
-    double end_time = omp_get_wtime();
+    double end_time = instr_wtime();
 
     double pi_estimate = 4.0 * (double)points_in_circle / (double)total_points;
     printf("Estimation de pi : %.10f\n", pi_estimate);
     printf("Temps écoulé : %.6f secondes\n", end_time - start_time);
+    INSTR_REPORT();
 
     return 0;
 }
\ No newline at end of file
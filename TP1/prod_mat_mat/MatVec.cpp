@@ -0,0 +1,93 @@
+#include <algorithm>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+#include "MatVec.hpp"
+
+void matVec(const Matrix& A, const double* u, double* v)
+{
+  #pragma omp parallel
+  {
+    int nThreads = 1, iThread = 0;
+#if defined(_OPENMP)
+    nThreads = omp_get_num_threads();
+    iThread = omp_get_thread_num();
+#endif
+    // Rows of the thread, in multiples of 8 so that the threads write distinct cache lines
+    int nBlocks = (A.nbRows + 7) / 8;
+    int begin = std::min(A.nbRows, 8 * (nBlocks * iThread / nThreads));
+    int end = std::min(A.nbRows, 8 * (nBlocks * (iThread + 1) / nThreads));
+    double* vt = v + begin;
+    std::fill(vt, v + end, 0.);
+    for (int j = 0; j < A.nbCols; ++j) {
+      const double* col = A.data() + std::size_t(j) * A.nbRows + begin;
+      const double uj = u[j];
+      #pragma omp simd
+      for (int i = 0; i < end - begin; ++i)
+        vt[i] += col[i] * uj;
+    }
+  }
+}
+// ========================================================================
+BlockDistribution::BlockDistribution(int n, int nbp) :
+  size{n}, counts(nbp), displs(nbp)
+{
+  for (int r = 0; r < nbp; ++r) {
+    counts[r] = n / nbp + (r < n % nbp ? 1 : 0);
+    displs[r] = r * (n / nbp) + std::min(r, n % nbp);
+  }
+}
+// ------------------------------------------------------------------------
+int BlockDistribution::owner(int i) const
+{
+  return int(std::upper_bound(displs.begin(), displs.end(), i) - displs.begin()) - 1;
+}
+// ========================================================================
+namespace {
+int commRank(MPI_Comm comm)
+{
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  return rank;
+}
+
+int commSize(MPI_Comm comm)
+{
+  int nbp;
+  MPI_Comm_size(comm, &nbp);
+  return nbp;
+}
+}  // namespace
+
+DenseRowBlocks::DenseRowBlocks(int dim, const std::function<double(int, int)>& coef, MPI_Comm comm) :
+  m_comm{comm}, m_dist(dim, commSize(comm)),
+  m_A(m_dist.counts[commRank(comm)], dim), m_u(dim)
+{
+  const int first = m_dist.displs[commRank(comm)];
+  for (int j = 0; j < dim; ++j)
+    for (int i = 0; i < m_A.nbRows; ++i)
+      m_A(i, j) = coef(first + i, j);
+}
+// ------------------------------------------------------------------------
+void DenseRowBlocks::apply(const double* uLoc, double* vLoc)
+{
+  MPI_Allgatherv(uLoc, m_dist.counts[commRank(m_comm)], MPI_DOUBLE, m_u.data(), m_dist.counts.data(),
+                 m_dist.displs.data(), MPI_DOUBLE, m_comm);
+  matVec(m_A, m_u.data(), vLoc);
+}
+// ========================================================================
+DenseColumnBlocks::DenseColumnBlocks(int dim, const std::function<double(int, int)>& coef, MPI_Comm comm) :
+  m_comm{comm}, m_dist(dim, commSize(comm)),
+  m_A(dim, m_dist.counts[commRank(comm)]), m_v(dim)
+{
+  const int first = m_dist.displs[commRank(comm)];
+  for (int j = 0; j < m_A.nbCols; ++j)
+    for (int i = 0; i < dim; ++i)
+      m_A(i, j) = coef(i, first + j);
+}
+// ------------------------------------------------------------------------
+void DenseColumnBlocks::apply(const double* uLoc, double* vLoc)
+{
+  matVec(m_A, uLoc, m_v.data());
+  MPI_Reduce_scatter(m_v.data(), vLoc, m_dist.counts.data(), MPI_DOUBLE, MPI_SUM, m_comm);
+}
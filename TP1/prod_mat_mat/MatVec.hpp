@@ -0,0 +1,59 @@
+#ifndef _MatVec_hpp__
+#define _MatVec_hpp__
+#include <functional>
+#include <vector>
+#include <mpi.h>
+#include "Matrix.hpp"
+
+// v = A.u. The rows are shared among the OpenMP threads ; A being stored by
+// columns, each thread adds the columns times u_j on its rows (vectorized).
+void matVec(const Matrix& A, const double* u, double* v);
+
+// Distribution of n indices by contiguous blocks over nbp processes, for any n :
+// the n % nbp first processes get one index more.
+struct BlockDistribution
+{
+  BlockDistribution(int n, int nbp);
+  int owner(int i) const;
+
+  int size;
+  std::vector<int> counts, displs;
+};
+
+// Dense matrix distributed by blocks of rows ; u and v are distributed as the
+// rows. u is gathered on every process by MPI_Allgatherv, then each process
+// computes its rows of v.
+class DenseRowBlocks
+{
+public:
+  DenseRowBlocks(int dim, const std::function<double(int, int)>& coef, MPI_Comm comm);
+
+  void apply(const double* uLoc, double* vLoc);
+  const BlockDistribution& distribution() const { return m_dist; }
+
+private:
+  MPI_Comm m_comm;
+  BlockDistribution m_dist;
+  Matrix m_A;                  // local rows, all the columns
+  std::vector<double> m_u;     // whole u
+};
+
+// Dense matrix distributed by blocks of columns ; u and v are distributed by
+// blocks as the columns. Each process computes the contribution of its columns
+// to the whole v, MPI_Reduce_scatter sums them and gives each process its block.
+class DenseColumnBlocks
+{
+public:
+  DenseColumnBlocks(int dim, const std::function<double(int, int)>& coef, MPI_Comm comm);
+
+  void apply(const double* uLoc, double* vLoc);
+  const BlockDistribution& distribution() const { return m_dist; }
+
+private:
+  MPI_Comm m_comm;
+  BlockDistribution m_dist;
+  Matrix m_A;                  // all the rows, local columns
+  std::vector<double> m_v;     // contribution to the whole v
+};
+
+#endif
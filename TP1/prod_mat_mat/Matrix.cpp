@@ -1,11 +1,9 @@
 # include "Matrix.hpp"
-# include <cassert>
 
-Matrix::Matrix( int nRows, int nCols ) :
-  nbRows{nRows}, nbCols{nCols}, m_arr_coefs(nRows*nCols)
-{}
-// ------------------------------------------------------------------------
-Matrix::Matrix( int nRows, int nCols, double val ) :
-  nbRows{nRows}, nbCols{nCols}, m_arr_coefs(nRows*nCols, val)
-{}
+// The accessors are inlined from Matrix.hpp : the layouts of the TP are compiled
+// here once, so that an error in one of them shows up whatever the program built.
+template class MatrixT<ColMajor>;
+template class MatrixT<RowMajor>;
+template class MatrixT<BlockMajor<32>>;
+template class MatrixT<BlockMajor<64>>;
 // ========================================================================
@@ -1,39 +1,153 @@
 #ifndef _MATRIX_HPP_
 # define _MATRIX_HPP_
 
+# include <algorithm>
+# include <cstddef>
 # include <vector>
 
-class Matrix
+// Storage layouts : position of the coefficient (i, j) in the array of a matrix
+// of nRows x nCols, known at compile time by the accessors of MatrixT.
+// byRows : consecutive j are contiguous (loops on j innermost).
+// padded : the array holds coefficients outside of the matrix, always zero.
+struct ColMajor
+{
+  static constexpr bool byRows = false;
+  static constexpr bool padded = false;
+  static std::size_t size(int nRows, int nCols) { return std::size_t(nRows)*nCols; }
+  static std::size_t index(int i, int j, int nRows, int /*nCols*/) { return i + std::size_t(j)*nRows; }
+};
+
+struct RowMajor
+{
+  static constexpr bool byRows = true;
+  static constexpr bool padded = false;
+  static std::size_t size(int nRows, int nCols) { return std::size_t(nRows)*nCols; }
+  static std::size_t index(int i, int j, int /*nRows*/, int nCols) { return j + std::size_t(i)*nCols; }
+};
+
+// Tiles of Blk x Blk stored one after the other (column-major inside a tile, the
+// tiles in column-major order). The last tiles are padded with zeros : a tile is
+// always Blk*Blk contiguous coefficients.
+template <int Blk>
+struct BlockMajor
+{
+  static constexpr bool byRows = false;
+  static constexpr bool padded = true;
+  static constexpr int block = Blk;
+  // Unsigned arithmetic : divisions and remainders by Blk are shifts and masks
+  static int nbTiles(int n) { return int((unsigned(n) + Blk - 1)/Blk); }
+  static std::size_t size(int nRows, int nCols) { return std::size_t(nbTiles(nRows))*nbTiles(nCols)*Blk*Blk; }
+  // First coefficient of the tile (iTile, jTile)
+  static std::size_t tile(int iTile, int jTile, int nRows)
+  {
+    return (iTile + std::size_t(jTile)*nbTiles(nRows))*Blk*Blk;
+  }
+  static std::size_t index(int i, int j, int nRows, int /*nCols*/)
+  {
+    return tile(int(unsigned(i)/Blk), int(unsigned(j)/Blk), nRows) + unsigned(i)%Blk + (unsigned(j)%Blk)*Blk;
+  }
+};
+
+template <class Layout>
+class MatrixT
 {
 public:
+  using layout = Layout;
+
   // Constructors - destructor
-  Matrix(int nRows, int nCols);
-  Matrix(int nRows, int nCols, double val);
-  Matrix(const Matrix & A) = delete;
-  Matrix(Matrix && A) = default;
-  ~Matrix() = default;
+  MatrixT(int nRows, int nCols) :
+    nbRows{nRows}, nbCols{nCols}, m_arr_coefs(Layout::size(nRows, nCols))
+  {}
+  MatrixT(int nRows, int nCols, double val) :
+    nbRows{nRows}, nbCols{nCols}, m_arr_coefs(Layout::size(nRows, nCols), Layout::padded ? 0. : val)
+  {
+    if (Layout::padded && val != 0.)
+      for (int j = 0; j < nbCols; ++j)
+        for (int i = 0; i < nbRows; ++i)
+          (*this)(i, j) = val;
+  }
+  MatrixT(const MatrixT & A) = delete;
+  MatrixT(MatrixT && A) = default;
+  ~MatrixT() = default;
 
   // Operators
-  Matrix & operator =(const Matrix & A) = delete;
-  Matrix & operator =(Matrix && A) = default;
+  MatrixT & operator =(const MatrixT & A) = delete;
+  MatrixT & operator =(MatrixT && A) = default;
 
-  // Getters - Setters 
+  // Getters - Setters
   double operator() (int i, int j) const
   {
-    return m_arr_coefs[i+j*nbRows];
+    return m_arr_coefs[Layout::index(i, j, nbRows, nbCols)];
   }
 
   double &operator() (int i, int j)
   {
-    return m_arr_coefs[i+j*nbRows];
+    return m_arr_coefs[Layout::index(i, j, nbRows, nbCols)];
   }
 
   double const* data() const { return m_arr_coefs.data(); }
   double      * data()       { return m_arr_coefs.data(); }
-  
+
   int nbRows, nbCols;
 private:
   std::vector < double >m_arr_coefs;
 };
 
+using Matrix = MatrixT<ColMajor>;
+using RowMatrix = MatrixT<RowMajor>;
+template <int Blk> using TiledMatrix = MatrixT<BlockMajor<Blk>>;
+
+// Calls f(i, j) for every coefficient, by tiles of szBlock x szBlock shared among
+// the OpenMP threads, each tile in the storage order of Layout : the coefficients
+// of a tile written and read by f stay in cache.
+template <class Layout, class F>
+void forEachByTiles(int nRows, int nCols, int szBlock, const F& f)
+{
+  const int nbRowBlks = (nRows + szBlock - 1)/szBlock;
+  const int nbColBlks = (nCols + szBlock - 1)/szBlock;
+  #pragma omp parallel for collapse(2) schedule(static)
+  for (int jBlk = 0; jBlk < nbColBlks; ++jBlk)
+    for (int iBlk = 0; iBlk < nbRowBlks; ++iBlk) {
+      const int iBeg = iBlk*szBlock, iEnd = std::min(nRows, iBeg + szBlock);
+      const int jBeg = jBlk*szBlock, jEnd = std::min(nCols, jBeg + szBlock);
+      if (Layout::byRows) {
+        for (int i = iBeg; i < iEnd; ++i)
+          for (int j = jBeg; j < jEnd; ++j) f(i, j);
+      } else {
+        for (int j = jBeg; j < jEnd; ++j)
+          for (int i = iBeg; i < iEnd; ++i) f(i, j);
+      }
+    }
+}
+
+// B = A, B being stored in any layout (a copy when it is the layout of A)
+template <class To, class From>
+void convert(const MatrixT<From>& A, MatrixT<To>& B, int szBlock = 64)
+{
+  forEachByTiles<To>(A.nbRows, A.nbCols, szBlock, [&](int i, int j) { B(i, j) = A(i, j); });
+}
+
+template <class To, class From>
+MatrixT<To> convert(const MatrixT<From>& A, int szBlock = 64)
+{
+  MatrixT<To> B(A.nbRows, A.nbCols);
+  convert(A, B, szBlock);
+  return B;
+}
+
+// B = transpose of A, both in the same layout
+template <class Layout>
+void transpose(const MatrixT<Layout>& A, MatrixT<Layout>& B, int szBlock = 64)
+{
+  forEachByTiles<Layout>(A.nbCols, A.nbRows, szBlock, [&](int i, int j) { B(i, j) = A(j, i); });
+}
+
+template <class Layout>
+MatrixT<Layout> transpose(const MatrixT<Layout>& A, int szBlock = 64)
+{
+  MatrixT<Layout> B(A.nbCols, A.nbRows);
+  transpose(A, B, szBlock);
+  return B;
+}
+
 #endif
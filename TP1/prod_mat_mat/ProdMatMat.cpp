@@ -2,16 +2,20 @@
 #include <cassert>
 #include <iostream>
 #include <thread>
+#include <vector>
 #if defined(_OPENMP)
 #include <omp.h>
 #endif
 #include "ProdMatMat.hpp"
+#include "instrument.h"
+#include "thread_pool.hpp"
 
 namespace {
 void prodSubBlocks(int iRowBlkA, int iColBlkB, int iColBlkA, int szBlock,
                    const Matrix& A, const Matrix& B, Matrix& C) {
   #pragma omp parallel
   {
+    INSTR_SCOPE("prodSubBlocks");
     #pragma omp for
     for (int i = iRowBlkA; i < std::min(A.nbRows, iRowBlkA + szBlock); ++i)
       for (int k = iColBlkA; k < std::min(A.nbCols, iColBlkA + szBlock); k++)
@@ -21,6 +25,45 @@ void prodSubBlocks(int iRowBlkA, int iColBlkB, int iColBlkA, int szBlock,
   }
 }
 const int szBlock = 1024;
+
+// Rows iBeg..iEnd-1 of A, column after column (iEnd - iBeg doubles per column)
+void packPanel(const Matrix& A, int iBeg, int iEnd, double* panel) {
+  const int nbRowsPanel = iEnd - iBeg;
+  for (int k = 0; k < A.nbCols; ++k)
+    std::copy_n(A.data() + iBeg + std::size_t(k) * A.nbRows, nbRowsPanel, panel + std::size_t(k) * nbRowsPanel);
+}
+
+// C(iBeg:iEnd, jBeg:jEnd) = panel * B(:, jBeg:jEnd), the panel being the rows
+// iBeg..iEnd-1 of A packed by packPanel, the k loop cut in blocks of szBlock
+void prodTile(const double* panel, int iBeg, int iEnd, int jBeg, int jEnd, int szBlock,
+              const Matrix& B, Matrix& C) {
+  const int nbRowsPanel = iEnd - iBeg;
+  for (int kBlk = 0; kBlk < B.nbRows; kBlk += szBlock) {
+    const int kEnd = std::min(B.nbRows, kBlk + szBlock);
+    for (int j = jBeg; j < jEnd; ++j) {
+      double* c = &C(iBeg, j);
+      for (int k = kBlk; k < kEnd; ++k) {
+        const double b = B(k, j);
+        const double* a = panel + std::size_t(k) * nbRowsPanel;
+        #pragma omp simd
+        for (int i = 0; i < nbRowsPanel; ++i)
+          c[i] += a[i] * b;
+      }
+    }
+  }
+}
+
+// c += a * b for tiles of Blk x Blk stored column-major
+template <int Blk>
+void prodTileBlk(const double* a, const double* b, double* c) {
+  for (int j = 0; j < Blk; ++j)
+    for (int k = 0; k < Blk; ++k) {
+      const double bkj = b[k + j * Blk];
+      #pragma omp simd
+      for (int i = 0; i < Blk; ++i)
+        c[i + j * Blk] += a[i + k * Blk] * bkj;
+    }
+}
 }  // namespace
 
 Matrix operator*(const Matrix& A, const Matrix& B) {
@@ -28,3 +71,123 @@ Matrix operator*(const Matrix& A, const Matrix& B) {
   prodSubBlocks(0, 0, 0, std::max({A.nbRows, B.nbCols, A.nbCols}), A, B, C);
   return C;
 }
+
+Matrix prodTiles(const Matrix& A, const Matrix& B, ThreadPool& pool, int szBlock) {
+  Matrix C(A.nbRows, B.nbCols, 0.0);
+  const int nbRowBlks = (A.nbRows + szBlock - 1) / szBlock;
+  std::vector<std::vector<double>> panels(nbRowBlks);
+  TaskGraph graph;
+  for (int iBlk = 0; iBlk < nbRowBlks; ++iBlk) {
+    const int iBeg = iBlk * szBlock, iEnd = std::min(A.nbRows, iBeg + szBlock);
+    TaskGraph::Node packed = graph.add([&, iBlk, iBeg, iEnd] {
+      panels[iBlk].resize(std::size_t(iEnd - iBeg) * A.nbCols);
+      packPanel(A, iBeg, iEnd, panels[iBlk].data());
+    });
+    for (int jBeg = 0; jBeg < B.nbCols; jBeg += szBlock)
+      graph.add([&, iBlk, iBeg, iEnd, jBeg] {
+        prodTile(panels[iBlk].data(), iBeg, iEnd, jBeg, std::min(B.nbCols, jBeg + szBlock), szBlock, B, C);
+      }, {packed});
+  }
+  graph.run(pool);
+  return C;
+}
+
+Matrix prodTilesOmp(const Matrix& A, const Matrix& B, int szBlock) {
+  Matrix C(A.nbRows, B.nbCols, 0.0);
+  const int nbRowBlks = (A.nbRows + szBlock - 1) / szBlock;
+  const int nbColBlks = (B.nbCols + szBlock - 1) / szBlock;
+  std::vector<std::vector<double>> panels(nbRowBlks);
+  #pragma omp parallel
+  {
+    #pragma omp for schedule(dynamic)
+    for (int iBlk = 0; iBlk < nbRowBlks; ++iBlk) {
+      const int iBeg = iBlk * szBlock, iEnd = std::min(A.nbRows, iBeg + szBlock);
+      panels[iBlk].resize(std::size_t(iEnd - iBeg) * A.nbCols);
+      packPanel(A, iBeg, iEnd, panels[iBlk].data());
+    }
+    // Implicit barrier : all the panels are copied before the first tile
+    #pragma omp for collapse(2) schedule(dynamic)
+    for (int iBlk = 0; iBlk < nbRowBlks; ++iBlk)
+      for (int jBlk = 0; jBlk < nbColBlks; ++jBlk) {
+        const int iBeg = iBlk * szBlock, jBeg = jBlk * szBlock;
+        prodTile(panels[iBlk].data(), iBeg, std::min(A.nbRows, iBeg + szBlock), jBeg,
+                 std::min(B.nbCols, jBeg + szBlock), szBlock, B, C);
+      }
+  }
+  return C;
+}
+
+Matrix prodByLayout(const Matrix& A, const Matrix& B, int szBlock) {
+  Matrix C(A.nbRows, B.nbCols, 0.0);
+  const int nbRowBlks = (A.nbRows + szBlock - 1) / szBlock;
+  const int nbColBlks = (B.nbCols + szBlock - 1) / szBlock;
+  #pragma omp parallel for collapse(2) schedule(dynamic)
+  for (int jBlk = 0; jBlk < nbColBlks; ++jBlk)
+    for (int iBlk = 0; iBlk < nbRowBlks; ++iBlk) {
+      const int iBeg = iBlk * szBlock, iEnd = std::min(A.nbRows, iBeg + szBlock);
+      const int jBeg = jBlk * szBlock, jEnd = std::min(B.nbCols, jBeg + szBlock);
+      for (int kBlk = 0; kBlk < A.nbCols; kBlk += szBlock) {
+        const int kEnd = std::min(A.nbCols, kBlk + szBlock);
+        for (int j = jBeg; j < jEnd; ++j) {
+          double* c = C.data() + std::size_t(j) * C.nbRows;
+          for (int k = kBlk; k < kEnd; ++k) {
+            const double b = B(k, j);
+            const double* a = A.data() + std::size_t(k) * A.nbRows;
+            #pragma omp simd
+            for (int i = iBeg; i < iEnd; ++i)
+              c[i] += a[i] * b;
+          }
+        }
+      }
+    }
+  return C;
+}
+
+RowMatrix prodByLayout(const RowMatrix& A, const RowMatrix& B, int szBlock) {
+  RowMatrix C(A.nbRows, B.nbCols, 0.0);
+  const int nbRowBlks = (A.nbRows + szBlock - 1) / szBlock;
+  const int nbColBlks = (B.nbCols + szBlock - 1) / szBlock;
+  #pragma omp parallel for collapse(2) schedule(dynamic)
+  for (int iBlk = 0; iBlk < nbRowBlks; ++iBlk)
+    for (int jBlk = 0; jBlk < nbColBlks; ++jBlk) {
+      const int iBeg = iBlk * szBlock, iEnd = std::min(A.nbRows, iBeg + szBlock);
+      const int jBeg = jBlk * szBlock, jEnd = std::min(B.nbCols, jBeg + szBlock);
+      for (int kBlk = 0; kBlk < A.nbCols; kBlk += szBlock) {
+        const int kEnd = std::min(A.nbCols, kBlk + szBlock);
+        for (int i = iBeg; i < iEnd; ++i) {
+          double* c = C.data() + std::size_t(i) * C.nbCols;
+          for (int k = kBlk; k < kEnd; ++k) {
+            const double a = A(i, k);
+            const double* b = B.data() + std::size_t(k) * B.nbCols;
+            #pragma omp simd
+            for (int j = jBeg; j < jEnd; ++j)
+              c[j] += a * b[j];
+          }
+        }
+      }
+    }
+  return C;
+}
+
+template <int Blk>
+TiledMatrix<Blk> prodByLayout(const TiledMatrix<Blk>& A, const TiledMatrix<Blk>& B) {
+  using Layout = BlockMajor<Blk>;
+  TiledMatrix<Blk> C(A.nbRows, B.nbCols, 0.0);
+  const int nbRowTiles = Layout::nbTiles(A.nbRows);
+  const int nbColTiles = Layout::nbTiles(B.nbCols);
+  const int nbInnerTiles = Layout::nbTiles(A.nbCols);
+  // The padding of the tiles is zero : whole tiles everywhere
+  #pragma omp parallel for collapse(2) schedule(dynamic)
+  for (int jTile = 0; jTile < nbColTiles; ++jTile)
+    for (int iTile = 0; iTile < nbRowTiles; ++iTile) {
+      double* c = C.data() + Layout::tile(iTile, jTile, C.nbRows);
+      for (int kTile = 0; kTile < nbInnerTiles; ++kTile)
+        prodTileBlk<Blk>(A.data() + Layout::tile(iTile, kTile, A.nbRows),
+                         B.data() + Layout::tile(kTile, jTile, B.nbRows), c);
+    }
+  return C;
+}
+
+// Tile sizes compiled with Matrix.cpp
+template TiledMatrix<32> prodByLayout<32>(const TiledMatrix<32>& A, const TiledMatrix<32>& B);
+template TiledMatrix<64> prodByLayout<64>(const TiledMatrix<64>& A, const TiledMatrix<64>& B);
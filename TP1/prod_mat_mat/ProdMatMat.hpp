@@ -5,6 +5,24 @@
 
 Matrix operator* ( const Matrix& A, const Matrix& B );
 
+class ThreadPool;
+// Product by tiles of szBlock x szBlock of C, run as a task graph on the pool :
+// one task copies each panel of szBlock rows of A into a contiguous buffer, and
+// the tiles of C on these rows start as soon as their panel is copied.
+Matrix prodTiles( const Matrix& A, const Matrix& B, ThreadPool& pool, int szBlock = 128 );
+// Same tiles scheduled by OpenMP : every panel is copied before the first tile
+Matrix prodTilesOmp( const Matrix& A, const Matrix& B, int szBlock = 128 );
+
+// Product specialized for the storage layout, without any copy : tiles of C of
+// szBlock x szBlock shared among the OpenMP threads, the innermost loop running
+// with unit stride (on i by columns, on j by rows). In block-major layout the
+// tiles are those of the storage, each product of tiles streaming Blk*Blk
+// contiguous coefficients.
+Matrix prodByLayout( const Matrix& A, const Matrix& B, int szBlock = 128 );
+RowMatrix prodByLayout( const RowMatrix& A, const RowMatrix& B, int szBlock = 128 );
+template <int Blk>
+TiledMatrix<Blk> prodByLayout( const TiledMatrix<Blk>& A, const TiledMatrix<Blk>& B );
+
 enum prod_algo { naive, block, parallel_naive, parallel_block1, parallel_block2 } ;
 void setProdMatMat( prod_algo algo );
 void setBlockSize( int size );
@@ -0,0 +1,142 @@
+#include <algorithm>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+#include "SparseMatrix.hpp"
+
+CsrMatrix::CsrMatrix(int nRows, int nCols, std::vector<Triplet> entries) :
+  nbRows{nRows}, nbCols{nCols}, rowPtr(nRows + 1, 0)
+{
+  std::sort(entries.begin(), entries.end(), [](const Triplet& a, const Triplet& b) {
+    return a.row < b.row || (a.row == b.row && a.col < b.col);
+  });
+  for (std::size_t k = 0; k < entries.size(); ++k) {
+    if (!colInd.empty() && k > 0 && entries[k].row == entries[k - 1].row && entries[k].col == entries[k - 1].col) {
+      values.back() += entries[k].value;
+      continue;
+    }
+    colInd.push_back(entries[k].col);
+    values.push_back(entries[k].value);
+    ++rowPtr[entries[k].row + 1];
+  }
+  for (int i = 0; i < nRows; ++i)
+    rowPtr[i + 1] += rowPtr[i];
+}
+// ------------------------------------------------------------------------
+void CsrMatrix::apply(const double* u, double* v, bool accumulate) const
+{
+  #pragma omp parallel
+  {
+    int nThreads = 1, iThread = 0;
+#if defined(_OPENMP)
+    nThreads = omp_get_num_threads();
+    iThread = omp_get_thread_num();
+#endif
+    #pragma omp single
+    if (int(m_threadRows.size()) != nThreads + 1) {
+      // Same number of nonzeros (plus one per row for the loop overhead) per thread
+      m_threadRows.assign(nThreads + 1, nbRows);
+      m_threadRows[0] = 0;
+      const double perThread = double(nnz() + nbRows) / nThreads;
+      int t = 1;
+      for (int i = 0; i < nbRows && t < nThreads; ++i)
+        while (t < nThreads && rowPtr[i + 1] + i + 1 > t * perThread)
+          m_threadRows[t++] = i + 1;
+    }
+    for (int i = m_threadRows[iThread]; i < m_threadRows[iThread + 1]; ++i) {
+      double sum = 0.;
+      #pragma omp simd reduction(+ : sum)
+      for (long k = rowPtr[i]; k < rowPtr[i + 1]; ++k)
+        sum += values[k] * u[colInd[k]];
+      v[i] = accumulate ? v[i] + sum : sum;
+    }
+  }
+}
+// ========================================================================
+DistributedCsr::DistributedCsr(const CsrMatrix& localRows, const BlockDistribution& dist, MPI_Comm comm)
+{
+  int rank, nbp;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nbp);
+  const int first = dist.displs[rank], count = dist.counts[rank];
+
+  // Ghost columns, sorted : they come grouped by owner
+  std::vector<int> ghostCols;
+  for (int col : localRows.colInd)
+    if (col < first || col >= first + count) ghostCols.push_back(col);
+  std::sort(ghostCols.begin(), ghostCols.end());
+  ghostCols.erase(std::unique(ghostCols.begin(), ghostCols.end()), ghostCols.end());
+  m_ghosts.resize(ghostCols.size());
+
+  std::vector<Triplet> local, remote;
+  for (int i = 0; i < localRows.nbRows; ++i)
+    for (long k = localRows.rowPtr[i]; k < localRows.rowPtr[i + 1]; ++k) {
+      int col = localRows.colInd[k];
+      if (col >= first && col < first + count)
+        local.push_back({i, col - first, localRows.values[k]});
+      else
+        remote.push_back({i, int(std::lower_bound(ghostCols.begin(), ghostCols.end(), col) - ghostCols.begin()),
+                          localRows.values[k]});
+    }
+  m_local = CsrMatrix(localRows.nbRows, count, std::move(local));
+  m_remote = CsrMatrix(localRows.nbRows, int(ghostCols.size()), std::move(remote));
+
+  // Plan : every process tells the owners which of their entries it needs
+  std::vector<int> recvCounts(nbp, 0), sendCounts(nbp), recvDispls(nbp, 0), sendDispls(nbp, 0);
+  for (int col : ghostCols)
+    ++recvCounts[dist.owner(col)];
+  MPI_Alltoall(recvCounts.data(), 1, MPI_INT, sendCounts.data(), 1, MPI_INT, comm);
+  for (int r = 1; r < nbp; ++r) {
+    recvDispls[r] = recvDispls[r - 1] + recvCounts[r - 1];
+    sendDispls[r] = sendDispls[r - 1] + sendCounts[r - 1];
+  }
+  m_sendIndices.resize(sendDispls[nbp - 1] + sendCounts[nbp - 1]);
+  MPI_Alltoallv(ghostCols.data(), recvCounts.data(), recvDispls.data(), MPI_INT, m_sendIndices.data(),
+                sendCounts.data(), sendDispls.data(), MPI_INT, comm);
+  for (int& index : m_sendIndices)
+    index -= first;
+  m_sendBuffer.resize(m_sendIndices.size());
+
+  // Persistent requests, started by every product
+  const int tag = 37;
+  for (int r = 0; r < nbp; ++r)
+    if (recvCounts[r] > 0 || sendCounts[r] > 0) ++m_nbNeighbours;
+  for (int r = 0; r < nbp; ++r) {
+    if (recvCounts[r] > 0) {
+      m_requests.emplace_back();
+      MPI_Recv_init(m_ghosts.data() + recvDispls[r], recvCounts[r], MPI_DOUBLE, r, tag, comm, &m_requests.back());
+    }
+  }
+  for (int r = 0; r < nbp; ++r) {
+    if (sendCounts[r] > 0) {
+      m_requests.emplace_back();
+      MPI_Send_init(m_sendBuffer.data() + sendDispls[r], sendCounts[r], MPI_DOUBLE, r, tag, comm,
+                    &m_requests.back());
+    }
+  }
+}
+// ------------------------------------------------------------------------
+DistributedCsr::~DistributedCsr()
+{
+  for (auto& request : m_requests)
+    MPI_Request_free(&request);
+}
+// ------------------------------------------------------------------------
+void DistributedCsr::apply(const double* uLoc, double* vLoc, bool overlap)
+{
+  #pragma omp parallel for
+  for (std::size_t k = 0; k < m_sendIndices.size(); ++k)
+    m_sendBuffer[k] = uLoc[m_sendIndices[k]];
+  if (!m_requests.empty())
+    MPI_Startall(int(m_requests.size()), m_requests.data());
+  if (overlap)
+    m_local.apply(uLoc, vLoc);
+  double start = MPI_Wtime();
+  if (!m_requests.empty())
+    MPI_Waitall(int(m_requests.size()), m_requests.data(), MPI_STATUSES_IGNORE);
+  waitTime += MPI_Wtime() - start;
+  if (!overlap)
+    m_local.apply(uLoc, vLoc);
+  if (m_remote.nnz() > 0)
+    m_remote.apply(m_ghosts.data(), vLoc, true);
+}
@@ -0,0 +1,72 @@
+#ifndef _SparseMatrix_hpp__
+#define _SparseMatrix_hpp__
+#include <vector>
+#include <mpi.h>
+#include "MatVec.hpp"
+
+struct Triplet
+{
+  int row, col;
+  double value;
+};
+
+// Sparse matrix in CSR format : the nonzeros of row i are values[rowPtr[i] .. rowPtr[i+1]-1],
+// in the columns colInd[rowPtr[i] .. rowPtr[i+1]-1].
+class CsrMatrix
+{
+public:
+  CsrMatrix() = default;
+  // Duplicated (row, col) entries are summed
+  CsrMatrix(int nRows, int nCols, std::vector<Triplet> entries);
+
+  // v = A.u, or v += A.u if `accumulate`. The rows are shared among the OpenMP
+  // threads in blocks of about the same number of nonzeros ; the product of a
+  // row is vectorized (gather of u).
+  void apply(const double* u, double* v, bool accumulate = false) const;
+
+  long nnz() const { return rowPtr.empty() ? 0 : rowPtr.back(); }
+
+  int nbRows = 0, nbCols = 0;
+  std::vector<long> rowPtr;
+  std::vector<int> colInd;
+  std::vector<double> values;
+
+private:
+  // First row of every thread, computed for the number of threads of the first product
+  mutable std::vector<int> m_threadRows;
+};
+
+// Sparse matrix distributed by blocks of rows, u and v being distributed as the
+// rows. The columns of the local rows are split in :
+//   - the local columns (entries of u owned by this process),
+//   - the ghost columns, whose entries of u are received from their owners.
+// The communication plan (which entries of u each process sends to which
+// neighbour) is built once ; every product then starts persistent sends and
+// receives of the ghost entries only, computes the local columns while they are
+// in flight and adds the ghost columns once they arrived.
+class DistributedCsr
+{
+public:
+  // localRows : the rows dist.displs[rank] .. of the matrix, with global column indices. Collective.
+  DistributedCsr(const CsrMatrix& localRows, const BlockDistribution& dist, MPI_Comm comm);
+  ~DistributedCsr();
+  DistributedCsr(const DistributedCsr&) = delete;
+  DistributedCsr& operator=(const DistributedCsr&) = delete;
+
+  // vLoc = rows of A.u ; overlap = false waits for the ghosts before computing (comparison)
+  void apply(const double* uLoc, double* vLoc, bool overlap = true);
+
+  int nbNeighbours() const { return m_nbNeighbours; }
+  long nbGhosts() const { return long(m_ghosts.size()); }
+  long nbSent() const { return long(m_sendIndices.size()); }
+  double waitTime = 0.;   // time spent in MPI_Waitall, summed over the products
+
+private:
+  CsrMatrix m_local, m_remote;    // m_remote : columns are indices in m_ghosts
+  std::vector<int> m_sendIndices; // local indices of u to send, neighbour after neighbour
+  std::vector<double> m_sendBuffer, m_ghosts;
+  std::vector<MPI_Request> m_requests;
+  int m_nbNeighbours = 0;
+};
+
+#endif
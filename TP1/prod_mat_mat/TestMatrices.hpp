@@ -0,0 +1,72 @@
+#ifndef _TestMatrices_hpp__
+#define _TestMatrices_hpp__
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include "Matrix.hpp"
+#include "instrument.h"
+
+// Helpers shared by the product tests (test_product_tasks, test_product_layouts)
+
+// Best time of `repeat` calls of f (seconds)
+template <class F>
+double bestTime(int repeat, F f)
+{
+  double best = std::numeric_limits<double>::max();
+  for (int r = 0; r < repeat; ++r) {
+    double start = instr_wtime();
+    f();
+    best = std::min(best, instr_wtime() - start);
+  }
+  return best;
+}
+
+// Seconds per call of f, over `repeat` calls : for calls too short to be timed alone
+template <class F>
+double timePerCall(int repeat, F f)
+{
+  double start = instr_wtime();
+  for (int r = 0; r < repeat; ++r) f();
+  return (instr_wtime() - start) / repeat;
+}
+
+// A(i, j) = (i + 2 j) mod 7 - 3 : the products are exact in double
+inline double coef(int i, int j) { return (i + 2 * j) % 7 - 3; }
+
+inline Matrix initMatrix(int nRows, int nCols)
+{
+  Matrix A(nRows, nCols);
+  for (int j = 0; j < nCols; ++j)
+    for (int i = 0; i < nRows; ++i)
+      A(i, j) = coef(i, j);
+  return A;
+}
+
+// (A B)(i, j) for A and B given by initMatrix with inner dimension nInner,
+// independently of any product kernel : the terms of the sum only depend on k mod 7
+inline double expectedProduct(int i, int j, int nInner)
+{
+  double sum = 0.;
+  for (int r = 0; r < 7; ++r) {
+    const int count = nInner / 7 + (r < nInner % 7 ? 1 : 0);
+    sum += count * coef(i, r) * coef(r, j);
+  }
+  return sum;
+}
+
+// Every coefficient of C compared with the closed form, in any layout. Returns
+// false at the first error.
+template <class Layout>
+bool verifProduct(const MatrixT<Layout>& C, int nInner)
+{
+  for (int j = 0; j < C.nbCols; ++j)
+    for (int i = 0; i < C.nbRows; ++i)
+      if (C(i, j) != expectedProduct(i, j, nInner)) {
+        std::cerr << "Erreur : C(" << i << ", " << j << ") = " << C(i, j) << " au lieu de "
+                  << expectedProduct(i, j, nInner) << std::endl;
+        return false;
+      }
+  return true;
+}
+
+#endif
@@ -0,0 +1,94 @@
+// Comparaison des dispositions mémoire de Matrix (par colonnes, par lignes, par tuiles) :
+//   - débit de la conversion depuis le stockage par colonnes, de la copie et de la transposition ;
+//   - produit matrice-matrice spécialisé pour chaque disposition (prodByLayout) ;
+// vérifiés contre A et la forme close du produit, sur des matrices carrées puis
+// rectangulaires dont aucune dimension n'est un multiple des tuiles.
+// OMP_NUM_THREADS=4 ./test_product_layouts.exe [dim] [szBlock]
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+#include "Matrix.hpp"
+#include "ProdMatMat.hpp"
+#include "TestMatrices.hpp"
+
+namespace {
+Matrix gemm(const Matrix& A, const Matrix& B, int szBlock) { return prodByLayout(A, B, szBlock); }
+RowMatrix gemm(const RowMatrix& A, const RowMatrix& B, int szBlock) { return prodByLayout(A, B, szBlock); }
+template <int Blk>
+TiledMatrix<Blk> gemm(const TiledMatrix<Blk>& A, const TiledMatrix<Blk>& B, int) { return prodByLayout(A, B); }
+
+// Conversion, copy, transposition and product in the layout, checked against A
+// and the closed form of the product. Returns false if they differ.
+template <class Layout>
+bool benchLayout(const char* name, const Matrix& A, const Matrix& B, int szBlock)
+{
+  const double bytes = 2. * sizeof(double) * A.nbRows * A.nbCols;  // read + write
+  const double flops = 2. * A.nbRows * A.nbCols * B.nbCols;
+  // Into matrices already allocated : only the copies are timed
+  MatrixT<Layout> AL = convert<Layout>(A), BL = convert<Layout>(B);
+  double tConvert = bestTime(5, [&] { convert(A, AL, szBlock); });
+  MatrixT<Layout> copy = convert<Layout>(AL, szBlock);
+  double tCopy = bestTime(5, [&] { convert(AL, copy, szBlock); });
+  MatrixT<Layout> ALt = transpose(AL, szBlock);
+  double tTranspose = bestTime(5, [&] { transpose(AL, ALt, szBlock); });
+  MatrixT<Layout> CL = gemm(AL, BL, szBlock);
+  double tProd = bestTime(3, [&] { CL = gemm(AL, BL, szBlock); });
+
+  bool isPassed = true;
+  for (int j = 0; j < A.nbCols && isPassed; ++j)
+    for (int i = 0; i < A.nbRows; ++i)
+      if (AL(i, j) != A(i, j) || ALt(j, i) != A(i, j) || copy(i, j) != A(i, j)) {
+        std::cerr << name << " : erreur de copie en (" << i << ", " << j << ")" << std::endl;
+        isPassed = false;
+        break;
+      }
+  if (isPassed && !verifProduct(CL, A.nbCols)) {
+    std::cerr << name << " : erreur du produit" << std::endl;
+    isPassed = false;
+  }
+  std::cout << name << "\t" << bytes / tConvert * 1.E-9 << "\t" << bytes / tCopy * 1.E-9 << "\t"
+            << bytes / tTranspose * 1.E-9 << "\t" << flops / tProd * 1.E-9 << std::endl;
+  return isPassed;
+}
+
+// Every layout on A (nRows x nInner) and B (nInner x nCols)
+bool benchLayouts(int nRows, int nInner, int nCols, int szBlock)
+{
+  std::cout << "A " << nRows << " x " << nInner << ", B " << nInner << " x " << nCols << "\n";
+  Matrix A = initMatrix(nRows, nInner), B = initMatrix(nInner, nCols);
+  std::cout << "Disposition\tConversion (Go/s)\tCopie (Go/s)\tTransposition (Go/s)\tProduit (GFlops)\n";
+  bool isPassed = benchLayout<ColMajor>("colonnes", A, B, szBlock);
+  isPassed = benchLayout<RowMajor>("lignes", A, B, szBlock) && isPassed;
+  isPassed = benchLayout<BlockMajor<32>>("tuiles 32", A, B, szBlock) && isPassed;
+  isPassed = benchLayout<BlockMajor<64>>("tuiles 64", A, B, szBlock) && isPassed;
+  return isPassed;
+}
+}  // namespace
+
+int main(int nargs, char* vargs[])
+{
+  int dim = 1024, szBlock = 64;
+  if (nargs > 1) dim = std::atoi(vargs[1]);
+  if (nargs > 2) szBlock = std::atoi(vargs[2]);
+  int nbThreads = 1;
+#if defined(_OPENMP)
+  nbThreads = omp_get_max_threads();
+#endif
+  std::cout << "Dimension " << dim << ", blocs de " << szBlock << ", " << nbThreads << " threads OpenMP\n";
+
+  // Upper bound of the copies : memcpy of the array
+  std::vector<double> src(std::size_t(dim) * dim, 1.), dst(src.size());
+  double tMemcpy = bestTime(5, [&] { std::memcpy(dst.data(), src.data(), src.size() * sizeof(double)); });
+  std::cout << "memcpy : " << 2. * sizeof(double) * src.size() / tMemcpy * 1.E-9 << " Go/s\n";
+
+  bool isPassed = benchLayouts(dim, dim, dim, szBlock);
+  // Rectangular, no dimension a multiple of the tiles
+  isPassed = benchLayouts(301, 173, 229, szBlock) && isPassed;
+  std::cout << (isPassed ? "Test passed" : "Test failed") << std::endl;
+  return isPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -3,9 +3,10 @@
 #include <cassert>
 #include <cmath>
 #include <iostream>
-#include <chrono>
+#include <limits>
 #include "Matrix.hpp"
 #include "ProdMatMat.hpp"
+#include "instrument.h"
 
 std::tuple<std::vector<double>,std::vector<double>,
 	   std::vector<double>,std::vector<double>>  computeTensors(int dim)
@@ -69,27 +70,34 @@ int main(int nargs, char *vargs[])
   int dim = 1024;
   if (nargs > 1)
     dim = atoi(vargs[1]);
+  INSTR_INIT();
   std::vector < double >uA, vA, uB, vB;
   std::tie(uA, vA, uB, vB) = computeTensors(dim);
 
+  INSTR_BEGIN("initialisation");
   Matrix A = initTensorMatrices(uA, vA);
   Matrix B = initTensorMatrices(uB, vB);
+  INSTR_END("initialisation");
 
-  std::chrono::time_point < std::chrono::system_clock > start, end;
-  start = std::chrono::system_clock::now();
+  double start = instr_wtime();
+  INSTR_BEGIN("produit");
   Matrix C = A * B;
-  end = std::chrono::system_clock::now();
-  std::chrono::duration < double >elapsed_seconds = end - start;
+  INSTR_END("produit");
+  double elapsed_seconds = instr_wtime() - start;
+  INSTR_COUNT("flops", 2.*dim*dim*dim);
 
+  INSTR_BEGIN("verification");
   bool isPassed = verifProduct(uA, vA, uB, vB, C);
+  INSTR_END("verification");
   if (isPassed)
     {
       std::cout << "Test passed\n";
-      std::cout << "Temps CPU produit matrice-matrice naif : " << elapsed_seconds.count() << " secondes\n";
-      std::cout << "MFlops -> " << (2.*dim*dim*dim)/elapsed_seconds.count()/1000000 <<std::endl;
+      std::cout << "Temps CPU produit matrice-matrice naif : " << elapsed_seconds << " secondes\n";
+      std::cout << "MFlops -> " << (2.*dim*dim*dim)/elapsed_seconds/1000000 <<std::endl;
     }
   else
     std::cout << "Test failed\n";
+  INSTR_REPORT();
 
   return (isPassed ? EXIT_SUCCESS : EXIT_FAILURE);
 }
@@ -0,0 +1,160 @@
+// Produits matrice-vecteur distribués (remplace matvec_v1.py et matvec_v2.py du TP2) :
+//   - matrice pleine A_ij = (i+j) % dim + 1 répartie par blocs de lignes (Allgatherv de u)
+//     ou de colonnes (Reduce_scatter de v), dim quelconque ;
+//   - matrice creuse CSR du laplacien 5 points sur une grille grid x grid, répartie
+//     par blocs de lignes, seules les composantes fantômes de u étant échangées.
+// Les résultats restent répartis ; chaque processus vérifie ses composantes de v.
+//
+//   mpirun -np 4 ./test_product_matvec.exe [dim] [grid] [repeat]   (4000 1000 100)
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <mpi.h>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+#include "MatVec.hpp"
+#include "SparseMatrix.hpp"
+
+namespace {
+// Slowest process
+double maxOver(double t, MPI_Comm comm)
+{
+  MPI_Allreduce(MPI_IN_PLACE, &t, 1, MPI_DOUBLE, MPI_MAX, comm);
+  return t;
+}
+
+// v_i = sum_j ((i+j) % dim + 1)(j + 1) : sums of integers below 2^53, exact whatever the order
+bool checkDense(const std::vector<double>& vLoc, int first, int dim)
+{
+  for (std::size_t i = 0; i < vLoc.size(); ++i) {
+    double expected = 0.;
+    for (int j = 0; j < dim; ++j)
+      expected += double((int(first + i) + j) % dim + 1) * (j + 1);
+    if (vLoc[i] != expected) {
+      std::cerr << "Erreur : v(" << first + i << ") = " << vLoc[i] << " au lieu de " << expected << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+template <class Product>
+double timeProduct(Product& product, int first, int count, int repeat, std::vector<double>& vLoc, MPI_Comm comm)
+{
+  std::vector<double> uLoc(count);
+  for (int i = 0; i < count; ++i)
+    uLoc[i] = first + i + 1.;
+  product.apply(uLoc.data(), vLoc.data());  // warm up
+  MPI_Barrier(comm);
+  double start = MPI_Wtime();
+  for (int r = 0; r < repeat; ++r)
+    product.apply(uLoc.data(), vLoc.data());
+  return maxOver((MPI_Wtime() - start) / repeat, comm);
+}
+
+double gridValue(int i) { return std::sin(0.001 * i) + 0.5 * std::cos(0.0137 * i); }
+// Distributed operators are destroyed (their persistent requests freed) before MPI_Finalize
+int runProducts(int dim, int grid, int repeat, MPI_Comm comm)
+{
+  int rank, nbp;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nbp);
+  int nThreads = 1;
+#if defined(_OPENMP)
+  nThreads = omp_get_max_threads();
+#endif
+  bool isPassed = true;
+  auto coef = [dim](int i, int j) { return double((i + j) % dim + 1); };
+
+  // Dense, blocks of rows then of columns
+  DenseRowBlocks rows(dim, coef, comm);
+  const int first = rows.distribution().displs[rank], count = rows.distribution().counts[rank];
+  std::vector<double> vLoc(count);
+  double tRows = timeProduct(rows, first, count, repeat, vLoc, comm);
+  isPassed = checkDense(vLoc, first, dim) && isPassed;
+  DenseColumnBlocks columns(dim, coef, comm);
+  double tColumns = timeProduct(columns, first, count, repeat, vLoc, comm);
+  isPassed = checkDense(vLoc, first, dim) && isPassed;
+
+  // Sparse : laplacian, row k = (x, y) of the grid
+  const int n = grid * grid;
+  BlockDistribution dist(n, nbp);
+  const int sFirst = dist.displs[rank], sCount = dist.counts[rank];
+  std::vector<Triplet> entries;
+  entries.reserve(5 * std::size_t(sCount));
+  for (int k = sFirst; k < sFirst + sCount; ++k) {
+    const int x = k % grid, y = k / grid, i = k - sFirst;
+    entries.push_back({i, k, 4.});
+    if (x > 0) entries.push_back({i, k - 1, -1.});
+    if (x < grid - 1) entries.push_back({i, k + 1, -1.});
+    if (y > 0) entries.push_back({i, k - grid, -1.});
+    if (y < grid - 1) entries.push_back({i, k + grid, -1.});
+  }
+  CsrMatrix localRows(sCount, n, std::move(entries));
+  DistributedCsr sparse(localRows, dist, comm);
+  std::vector<double> uLoc(sCount), svLoc(sCount);
+  for (int i = 0; i < sCount; ++i)
+    uLoc[i] = gridValue(sFirst + i);
+  // Per mode : [0] with overlap, [1] without
+  double tSparse[2], wait[2];
+  for (int overlap = 1; overlap >= 0; --overlap) {
+    sparse.apply(uLoc.data(), svLoc.data(), overlap);
+    sparse.waitTime = 0.;
+    MPI_Barrier(comm);
+    double start = MPI_Wtime();
+    for (int r = 0; r < repeat; ++r)
+      sparse.apply(uLoc.data(), svLoc.data(), overlap);
+    tSparse[1 - overlap] = maxOver((MPI_Wtime() - start) / repeat, comm);
+    wait[1 - overlap] = maxOver(sparse.waitTime / repeat, comm);
+  }
+  double maxError = 0.;
+  for (int k = sFirst; k < sFirst + sCount; ++k) {
+    const int x = k % grid, y = k / grid;
+    double expected = 4. * gridValue(k) - (x > 0 ? gridValue(k - 1) : 0.) - (x < grid - 1 ? gridValue(k + 1) : 0.)
+                      - (y > 0 ? gridValue(k - grid) : 0.) - (y < grid - 1 ? gridValue(k + grid) : 0.);
+    maxError = std::max(maxError, std::fabs(svLoc[k - sFirst] - expected));
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &maxError, 1, MPI_DOUBLE, MPI_MAX, comm);
+  if (maxError > 1.E-12) {
+    if (rank == 0) std::cerr << "Erreur : ecart maximal du produit creux " << maxError << std::endl;
+    isPassed = false;
+  }
+  long ghosts = sparse.nbGhosts(), nnz = localRows.nnz();
+  MPI_Allreduce(MPI_IN_PLACE, &ghosts, 1, MPI_LONG, MPI_MAX, comm);
+  MPI_Allreduce(MPI_IN_PLACE, &nnz, 1, MPI_LONG, MPI_SUM, comm);
+  int passed = isPassed;
+  MPI_Allreduce(MPI_IN_PLACE, &passed, 1, MPI_INT, MPI_MIN, comm);
+
+  if (rank == 0) {
+    std::cout << (passed ? "Test passed\n" : "Test failed\n");
+    std::cout << nbp << " processus x " << nThreads << " threads, " << repeat << " produits\n";
+    std::cout << "Matrice pleine " << dim << " x " << dim << " :\n";
+    std::cout << "  blocs de lignes   (Allgatherv)     : " << tRows << " secondes par produit, "
+              << 2. * dim * dim / tRows / 1.E9 << " GFlops\n";
+    std::cout << "  blocs de colonnes (Reduce_scatter) : " << tColumns << " secondes par produit, "
+              << 2. * dim * dim / tColumns / 1.E9 << " GFlops\n";
+    std::cout << "Matrice creuse (laplacien " << grid << " x " << grid << ", " << nnz << " coefficients) :\n";
+    std::cout << "  avec recouvrement : " << tSparse[0] << " secondes par produit, " << 2. * nnz / tSparse[0] / 1.E9
+              << " GFlops, attente des fantomes " << wait[0] << " s\n";
+    std::cout << "  sans recouvrement : " << tSparse[1] << " secondes par produit, " << 2. * nnz / tSparse[1] / 1.E9
+              << " GFlops, attente des fantomes " << wait[1] << " s\n";
+    std::cout << "  au plus " << ghosts << " composantes fantomes de u recues par processus\n";
+  }
+  return passed;
+}
+}  // namespace
+
+int main(int nargs, char* vargs[])
+{
+  MPI_Init(&nargs, &vargs);
+  MPI_Comm comm = MPI_COMM_WORLD;
+  int dim = nargs > 1 ? std::atoi(vargs[1]) : 4000;
+  int grid = nargs > 2 ? std::atoi(vargs[2]) : 1000;
+  int repeat = nargs > 3 ? std::max(1, std::atoi(vargs[3])) : 100;
+  int passed = runProducts(dim, grid, repeat, comm);
+  MPI_Finalize();
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
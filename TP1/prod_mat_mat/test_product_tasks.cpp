@@ -0,0 +1,120 @@
+// Comparaison du pool de threads à vol de tâches (tasks/thread_pool.hpp) et d'OpenMP :
+//   - coût d'une boucle parallèle (création/attente des threads pour OpenMP, découpage pour le pool) ;
+//   - coût d'une tâche ;
+//   - graphes créés, exécutés puis détruits aussitôt, sur 4 workers (le graphe
+//     ne doit plus être lu une fois run() terminé) ;
+//   - produit matrice-matrice par tuiles (graphe de tâches contre boucles OpenMP).
+// POOL_NUM_THREADS=4 OMP_NUM_THREADS=4 ./test_product_tasks.exe [dim] [szBlock]
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+#include "Matrix.hpp"
+#include "ProdMatMat.hpp"
+#include "TestMatrices.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+// `nbGraphs` graphs of 8 nodes (two chains of 3 joined by a node, one more node
+// after the right chain) built, run and destroyed at once, as prodTiles does with its graph. Returns false if a node
+// did not run exactly once.
+bool stressGraphs(ThreadPool& pool, int nbGraphs)
+{
+  std::atomic<int> count(0);
+  for (int g = 0; g < nbGraphs; ++g) {
+    count.store(0);
+    TaskGraph* graph = new TaskGraph;
+    auto work = [&count] { count.fetch_add(1, std::memory_order_relaxed); };
+    TaskGraph::Node left = graph->add(work), right = graph->add(work);
+    for (int k = 0; k < 2; ++k) {
+      left = graph->add(work, {left});
+      right = graph->add(work, {right});
+    }
+    graph->add(work, {left, right});
+    graph->add(work, {right});
+    graph->run(pool);
+    delete graph;
+    if (count.load() != 8) {
+      std::cerr << "Erreur : graphe " << g << ", " << count.load() << " noeuds executes au lieu de 8" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace
+
+int main(int nargs, char* vargs[])
+{
+  int dim = 1024, szBlock = 128;
+  if (nargs > 1) dim = std::atoi(vargs[1]);
+  if (nargs > 2) szBlock = std::atoi(vargs[2]);
+
+  ThreadPool pool;
+  int nbOmp = 1;
+#if defined(_OPENMP)
+  nbOmp = omp_get_max_threads();
+#endif
+  bool isPassed = true;
+  std::cout << "Pool : " << pool.size() << " threads, OpenMP : " << nbOmp << " threads\n";
+
+  // Boucle parallèle courte : 4 itérations par thread
+  const int nbIter = 4 * std::max(pool.size(), nbOmp), repeat = 2000;
+  std::vector<double> x(nbIter, 1.);
+  double tPool = timePerCall(repeat, [&] {
+    pool.parallel_for(0, nbIter, [&](long b, long e) { for (long i = b; i < e; ++i) x[i] = std::sqrt(x[i] + 1.); }, 1);
+  });
+  double tOmp = timePerCall(repeat, [&] {
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < nbIter; ++i) x[i] = std::sqrt(x[i] + 1.);
+  });
+  std::cout << "Boucle parallele de " << nbIter << " iterations (us par boucle) : pool " << 1.E6 * tPool
+            << ", OpenMP " << 1.E6 * tOmp << "\n";
+
+  // Tâches indépendantes réduites à une écriture
+  const int nbTasks = 100000;
+  std::vector<int> marks(nbTasks);
+  TaskGraph graph;
+  for (int t = 0; t < nbTasks; ++t) graph.add([&marks, t] { marks[t] = t; });
+  tPool = timePerCall(5, [&] { graph.run(pool); });
+  tOmp = timePerCall(5, [&] {
+    #pragma omp parallel
+    #pragma omp single
+    for (int t = 0; t < nbTasks; ++t) {
+      #pragma omp task
+      marks[t] = t;
+    }
+  });
+  std::cout << "Tache minimale (ns par tache) : pool " << 1.E9 * tPool / nbTasks << ", OpenMP " << 1.E9 * tOmp / nbTasks
+            << "\n";
+
+  // Graphes détruits dès la fin de run(), workers non attachés aux processeurs
+  ThreadPool stressPool(4, false);
+  const int nbGraphs = 20000;
+  double tStress = timePerCall(1, [&] { isPassed = stressGraphs(stressPool, nbGraphs); });
+  std::cout << nbGraphs << " graphes crees, executes et detruits sur " << stressPool.size() << " workers : "
+            << 1.E6 * tStress / nbGraphs << " us par graphe\n";
+
+  // Produit par tuiles
+  Matrix A = initMatrix(dim, dim), B = initMatrix(dim, dim);
+  double flops = 2. * dim * dim * dim;
+  Matrix C = prodTiles(A, B, pool, szBlock);
+  tPool = timePerCall(3, [&] { C = prodTiles(A, B, pool, szBlock); });
+  Matrix COmp = prodTilesOmp(A, B, szBlock);
+  tOmp = timePerCall(3, [&] { COmp = prodTilesOmp(A, B, szBlock); });
+  isPassed = isPassed && verifProduct(C, dim) &&
+                  std::equal(C.data(), C.data() + std::size_t(dim) * dim, COmp.data());
+  if (!isPassed) {
+    std::cout << "Test failed\n";
+    return EXIT_FAILURE;
+  }
+  std::cout << "Test passed\n";
+  std::cout << "Produit " << dim << " x " << dim << " par tuiles de " << szBlock << " (s) : pool " << tPool
+            << " (" << flops / tPool * 1.E-9 << " GFlops), OpenMP " << tOmp << " (" << flops / tOmp * 1.E-9
+            << " GFlops)" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,127 @@
+#include <cmath>
+#include <stdexcept>
+#include "deep_zoom.hpp"
+
+namespace {
+// Relative size of the first neglected term of the series, beyond which it stops
+const double series_tolerance = 1.E-12;
+
+// z_{n+1} = z_n^2 + c until |z| > escape radius. Calls visit(n, z_n) for every
+// computed value and returns the number of iterations done.
+template <class Visit>
+int multiprecision_orbit(const BigFixed& cr, const BigFixed& ci, const MandelbrotSet& set, Visit visit) {
+    const double r2max = set.escape_radius * set.escape_radius;
+    BigFixed zr(cr.fraction_limbs()), zi(cr.fraction_limbs());
+    for (int n = 0; n < set.max_iterations; ++n) {
+        BigFixed zr2 = zr * zr, zi2 = zi * zi, zrzi = zr * zi;
+        zi = zrzi + zrzi + ci;
+        zr = zr2 - zi2 + cr;
+        double re = zr.to_double(), im = zi.to_double();
+        visit(n + 1, re, im);
+        if (re * re + im * im > r2max) return n + 1;
+    }
+    return set.max_iterations;
+}
+
+// Same formula as MandelbrotSet.count_iterations : escape at iteration `iter`
+// (z_{iter+1} is the first value out of the disc)
+double escape_count(int iter, double r2, bool smooth) {
+    if (!smooth) return iter;
+    return iter + 1 - std::log(0.5 * std::log(r2)) / std::log(2.);
+}
+}  // namespace
+
+DeepZoom::DeepZoom(const MandelbrotSet& set, const std::string& re, const std::string& im, double radius, int width,
+                   int height)
+    : set(set), width(width), height(height) {
+    if (!(radius > 0.) || width <= 0 || height <= 0) throw std::invalid_argument("invalid deep zoom view");
+    scale = 2. * radius / height;
+    limbs = fraction_limbs_for(scale);
+    center_re = BigFixed::parse(re, limbs);
+    center_im = BigFixed::parse(im, limbs);
+    max_delta = scale * std::hypot(0.5 * width, 0.5 * height);
+}
+
+std::complex<double> DeepZoom::pixel_delta(int x, int y) const {
+    // Same pixel grid as View : the centre of the view is the corner of pixel (w/2, h/2)
+    return {(x - 0.5 * width) * scale, (y - 0.5 * height) * scale};
+}
+
+void DeepZoom::prepare(bool series_approximation) {
+    reference.assign(1, {0., 0.});
+    multiprecision_orbit(center_re, center_im, set, [&](int, double re, double im) { reference.push_back({re, im}); });
+
+    // d_n = a_n u + b_n u^2 + c_n u^3 with dc = max_delta u :
+    //   a_{n+1} = 2 Z_n a_n + max_delta, b_{n+1} = 2 Z_n b_n + a_n^2, c_{n+1} = 2 Z_n c_n + 2 a_n b_n
+    series_a = series_b = series_c = 0.;
+    skipped = 0;
+    if (!series_approximation) return;
+    const int last = reference_length();
+    for (int n = 0; n + 1 < last; ++n) {
+        const std::complex<double> twice_z = 2. * reference[n];
+        std::complex<double> a = twice_z * series_a + max_delta;
+        std::complex<double> b = twice_z * series_b + series_a * series_a;
+        std::complex<double> c = twice_z * series_c + 2. * series_a * series_b;
+        // |u| <= 1 : the truncated terms are negligible as long as the cubic one is
+        if (std::abs(c) > series_tolerance * std::abs(a)) break;
+        series_a = a;
+        series_b = b;
+        series_c = c;
+        skipped = n + 1;
+    }
+}
+
+void DeepZoom::count_row(int y, bool smooth, float* out) const {
+    const double r2max = set.escape_radius * set.escape_radius;
+    const int last = reference_length();
+    long long rebases = 0;
+    for (int x = 0; x < width; ++x) {
+        const std::complex<double> dc = pixel_delta(x, y);
+        std::complex<double> d = 0.;
+        if (skipped > 0) {
+            std::complex<double> u = dc / max_delta;
+            d = ((series_c * u + series_b) * u + series_a) * u;
+        }
+        double count = set.max_iterations;
+        int m = skipped;  // index in the reference orbit
+        for (int n = skipped; n < set.max_iterations; ++n) {
+            const double zr = reference[m].real(), zi = reference[m].imag();
+            const double dr = d.real(), di = d.imag();
+            double nr = 2. * (zr * dr - zi * di) + dr * dr - di * di + dc.real();
+            double ni = 2. * (zr * di + zi * dr) + 2. * dr * di + dc.imag();
+            ++m;
+            double fr = reference[m].real() + nr, fi = reference[m].imag() + ni;
+            double r2 = fr * fr + fi * fi;
+            if (r2 > r2max) {
+                count = escape_count(n, r2, smooth);
+                break;
+            }
+            if (r2 < nr * nr + ni * ni || m == last) {
+                // Rebase : z itself becomes the difference with Z_0 = 0
+                d = {fr, fi};
+                m = 0;
+                ++rebases;
+            } else {
+                d = {nr, ni};
+            }
+        }
+        out[x] = float(count);
+    }
+#pragma omp atomic
+    rebase_count += rebases;
+}
+
+void DeepZoom::count_image(bool smooth, float* out) const {
+#pragma omp parallel for schedule(dynamic)
+    for (int y = 0; y < height; ++y) count_row(y, smooth, out + std::size_t(y) * width);
+}
+
+double DeepZoom::count_iterations_multiprecision(int x, int y, bool smooth) const {
+    const std::complex<double> dc = pixel_delta(x, y);
+    BigFixed cr = center_re + BigFixed::from_double(dc.real(), limbs);
+    BigFixed ci = center_im + BigFixed::from_double(dc.imag(), limbs);
+    double r2 = 0.;
+    int n = multiprecision_orbit(cr, ci, set, [&](int, double re, double im) { r2 = re * re + im * im; });
+    if (r2 <= set.escape_radius * set.escape_radius) return set.max_iterations;
+    return escape_count(n - 1, r2, smooth);
+}
@@ -0,0 +1,59 @@
+#ifndef _DEEP_ZOOM_HPP_
+#define _DEEP_ZOOM_HPP_
+
+#include <complex>
+#include <string>
+#include <vector>
+#include "mandelbrot_engine.hpp"
+#include "multiprecision.hpp"
+
+// Deep zoom by perturbation : the orbit of the centre of the view (reference) is
+// computed once in multiprecision and every pixel c = C + dc iterates in double
+// its difference d_n = z_n - Z_n with the reference :
+//     d_{n+1} = 2 Z_n d_n + d_n^2 + dc
+// A cubic series in dc gives d_n for the first iterations of all the pixels at
+// once (series approximation). When |z_n| < |d_n| the difference is no longer
+// accurate (glitch) : the pixel is rebased on the start of the reference orbit
+// (d <- z_n, n' <- 0). Deltas are doubles : depths down to about 1e-300.
+class DeepZoom {
+public:
+    // View of width x height pixels centred on (center_re, center_im) (decimal strings
+    // of any length), `radius` being half of its height. Throws std::invalid_argument.
+    DeepZoom(const MandelbrotSet& set, const std::string& center_re, const std::string& center_im, double radius,
+             int width, int height);
+
+    // Reference orbit, then the series coefficients when `series_approximation`
+    void prepare(bool series_approximation = true);
+
+    // Iteration counts (smooth if asked) of row y, max_iterations for the points
+    // that do not escape. No known convergence zone test at this scale.
+    void count_row(int y, bool smooth, float* out) const;
+    // Whole image, rows shared among the OpenMP threads
+    void count_image(bool smooth, float* out) const;
+
+    // Same count for pixel (x, y), every iteration in multiprecision (reference)
+    double count_iterations_multiprecision(int x, int y, bool smooth) const;
+
+    int precision_bits() const { return 32 * limbs; }
+    int reference_length() const { return int(reference.size()) - 1; }
+    int skipped_iterations() const { return skipped; }
+    long long rebases() const { return rebase_count; }
+
+private:
+    std::complex<double> pixel_delta(int x, int y) const;
+
+    MandelbrotSet set;
+    int width, height;
+    double scale;       // size of a pixel
+    int limbs;          // fraction limbs of the multiprecision numbers
+    BigFixed center_re, center_im;
+    std::vector<std::complex<double>> reference;  // Z_0 = 0 .. Z_L
+    // Series d_skipped = a u + b u^2 + c u^3, u = dc / max|dc| so that the
+    // coefficients stay in the range of doubles at any depth
+    std::complex<double> series_a, series_b, series_c;
+    double max_delta;
+    int skipped = 0;
+    mutable long long rebase_count = 0;
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <zlib.h>
+#include "image_io.hpp"
+
+namespace {
+std::array<std::array<unsigned char, 3>, 256> make_plasma() {
+    // Degree 6 polynomial per channel fitted on matplotlib's plasma
+    const double c[7][3] = {{0.05873234392399702, 0.02333670892565664, 0.5433401826748754},
+                            {2.176514634195958, 0.2383834171260182, 0.7539604599784036},
+                            {-2.689460476458034, -7.455851135738909, 3.110799939717086},
+                            {6.130348345893603, 42.3461881477227, -28.51885465332158},
+                            {-11.10743619062271, -82.66631109428045, 60.13984767418263},
+                            {10.02306557647065, 71.41361770095349, -54.07218655560067},
+                            {-3.658713842777788, -22.93153465461149, 18.19190778539828}};
+    std::array<std::array<unsigned char, 3>, 256> table;
+    for (int k = 0; k < 256; ++k) {
+        double t = k / 255.;
+        for (int ch = 0; ch < 3; ++ch) {
+            double v = c[6][ch];
+            for (int d = 5; d >= 0; --d) v = v * t + c[d][ch];
+            // np.uint8(color * 255) truncates
+            table[k][ch] = (unsigned char)(std::max(0., std::min(v, 1.)) * 255);
+        }
+    }
+    return table;
+}
+
+void put_u32(std::vector<unsigned char>& out, std::uint32_t v) {
+    for (int s = 24; s >= 0; s -= 8) out.push_back((v >> s) & 0xFF);
+}
+
+// Length, type, data, CRC of the type and data
+void put_chunk(std::vector<unsigned char>& out, const char* type, const unsigned char* data, std::size_t size) {
+    put_u32(out, std::uint32_t(size));
+    std::size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + size);
+    put_u32(out, std::uint32_t(crc32(0L, out.data() + start, uInt(out.size() - start))));
+}
+
+void write_file(const std::string& filename, const unsigned char* data, std::size_t size) {
+    FILE* f = std::fopen(filename.c_str(), "wb");
+    if (f == nullptr) throw std::runtime_error("cannot create " + filename);
+    bool ok = std::fwrite(data, 1, size, f) == size;
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok) throw std::runtime_error("cannot write " + filename);
+}
+}  // namespace
+
+const std::array<std::array<unsigned char, 3>, 256>& plasma() {
+    static const auto table = make_plasma();
+    return table;
+}
+
+void apply_colormap(const float* values, std::size_t count, unsigned char* rgb) {
+    // R | G << 8 | B << 16 : stored as 4 bytes on little endian processors, the 4th
+    // one being overwritten by the next pixel
+    static const auto packed = [] {
+        std::array<std::uint32_t, 256> words;
+        for (int k = 0; k < 256; ++k) words[k] = plasma()[k][0] | plasma()[k][1] << 8 | plasma()[k][2] << 16;
+        return words;
+    }();
+    const std::size_t block = 512;
+    std::int32_t index[block];
+    for (std::size_t start = 0; start < count; start += block) {
+        const std::size_t n = std::min(block, count - start);
+#pragma omp simd
+        for (std::size_t i = 0; i < n; ++i) index[i] = std::min(std::max(int(values[start + i] * 256.f), 0), 255);
+        unsigned char* out = rgb + 3 * start;
+        // The last pixel of the image has no 4th byte to spare
+        const std::size_t words = start + n == count ? n - 1 : n;
+        std::size_t i = 0;
+        for (; i < words; ++i) std::memcpy(out + 3 * i, &packed[index[i]], 4);
+        for (; i < n; ++i) std::memcpy(out + 3 * i, plasma()[index[i]].data(), 3);
+    }
+}
+
+std::vector<unsigned char> encode_ppm(int width, int height, const unsigned char* rgb) {
+    char header[64];
+    int length = std::snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+    std::vector<unsigned char> data(header, header + length);
+    data.insert(data.end(), rgb, rgb + std::size_t(width) * height * 3);
+    return data;
+}
+
+std::vector<unsigned char> encode_png(int width, int height, const unsigned char* rgb) {
+    // Every row starts with its filter type (0 : none)
+    const std::size_t row_bytes = std::size_t(width) * 3;
+    std::vector<unsigned char> raw((row_bytes + 1) * height);
+    for (int y = 0; y < height; ++y) {
+        raw[y * (row_bytes + 1)] = 0;
+        std::copy_n(rgb + y * row_bytes, row_bytes, raw.begin() + y * (row_bytes + 1) + 1);
+    }
+    uLongf packed_size = compressBound(uLong(raw.size()));
+    std::vector<unsigned char> packed(packed_size);
+    if (compress2(packed.data(), &packed_size, raw.data(), uLong(raw.size()), Z_BEST_SPEED) != Z_OK)
+        throw std::runtime_error("cannot compress the image");
+
+    std::vector<unsigned char> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    std::vector<unsigned char> ihdr;
+    put_u32(ihdr, width);
+    put_u32(ihdr, height);
+    ihdr.insert(ihdr.end(), {8, 2, 0, 0, 0});  // 8 bits, RGB, deflate, no filter, no interlace
+    put_chunk(png, "IHDR", ihdr.data(), ihdr.size());
+    put_chunk(png, "IDAT", packed.data(), packed_size);
+    put_chunk(png, "IEND", nullptr, 0);
+    return png;
+}
+
+void write_bytes(const std::string& filename, const std::vector<unsigned char>& data) {
+    write_file(filename, data.data(), data.size());
+}
+
+void write_ppm(const std::string& filename, int width, int height, const unsigned char* rgb) {
+    write_bytes(filename, encode_ppm(width, height, rgb));
+}
+
+void write_png(const std::string& filename, int width, int height, const unsigned char* rgb) {
+    write_bytes(filename, encode_png(width, height, rgb));
+}
+
+void write_image(const std::string& filename, int width, int height, const unsigned char* rgb) {
+    auto dot = filename.rfind('.');
+    std::string extension = dot == std::string::npos ? "" : filename.substr(dot);
+    if (extension == ".ppm")
+        write_ppm(filename, width, height, rgb);
+    else if (extension == ".png")
+        write_png(filename, width, height, rgb);
+    else
+        throw std::runtime_error("unknown image format (.png or .ppm) : " + filename);
+}
@@ -0,0 +1,28 @@
+#ifndef _IMAGE_IO_HPP_
+#define _IMAGE_IO_HPP_
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// 256 colors of matplotlib's plasma colormap (polynomial fit of the listed colormap)
+const std::array<std::array<unsigned char, 3>, 256>& plasma();
+
+// RGB pixels (3 bytes each) of `count` convergence values in [0, 1], looked up as
+// matplotlib.cm.plasma does (index min(int(256 v), 255)). The indices of a block of
+// pixels are computed by SIMD vectors, then every pixel is one 4 byte load and store.
+void apply_colormap(const float* values, std::size_t count, unsigned char* rgb);
+
+// Binary PPM (P6) or PNG (from the file extension) of width x height RGB pixels.
+// Throws std::runtime_error if the file cannot be written.
+void write_image(const std::string& filename, int width, int height, const unsigned char* rgb);
+void write_ppm(const std::string& filename, int width, int height, const unsigned char* rgb);
+void write_png(const std::string& filename, int width, int height, const unsigned char* rgb);
+
+// Same files in memory, and writing of such bytes
+std::vector<unsigned char> encode_ppm(int width, int height, const unsigned char* rgb);
+std::vector<unsigned char> encode_png(int width, int height, const unsigned char* rgb);
+void write_bytes(const std::string& filename, const std::vector<unsigned char>& data);
+
+#endif
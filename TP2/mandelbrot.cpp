@@ -0,0 +1,276 @@
+// Calcul de l'ensemble de Mandelbrot en C++ : même calcul que mandelbrot.py,
+// les pixels d'une ligne étant itérés par vecteurs SIMD et les lignes réparties
+// entre les threads OpenMP.
+//
+//   mandelbrot.exe [options]
+//     --size WxH               image size (1024x1024)
+//     --max-iterations N       (50)
+//     --escape-radius R        (10)
+//     --precision float|double (double)
+//     --view xmin,xmax,ymin,ymax region of the complex plane (-2,1,-1.125,1.125)
+//     --no-smooth              integer iteration counts
+//     --out file               .png or .ppm (mandel.png)
+//     --bench                  time the scalar and vector kernels, float and double,
+//                              on 1 and all threads, against the Python time
+//     --python-time s          time of mandelbrot.py for the same image (2.0647, README)
+//
+//   Zoom profond (perturbation autour d'une orbite de référence en multiprécision) :
+//     --center RE,IM           centre of the view, decimal numbers of any length
+//     --radius r               half height of the view (1e-3 .. 1e-300)
+//     --no-series              no series approximation of the first iterations
+//     --sample N               with --bench, pixels iterated in multiprecision (64)
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <omp.h>
+#include "deep_zoom.hpp"
+#include "image_io.hpp"
+#include "mandelbrot_engine.hpp"
+
+namespace {
+double elapsed_since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Best of `repeats` runs
+double time_compute(const MandelbrotSet& set, const View& view, Precision precision, int width, int height,
+                    bool smooth, bool vectorized, int threads, std::vector<float>& out, int repeats = 3) {
+    omp_set_num_threads(threads);
+    double best = 1.E30;
+    for (int r = 0; r < repeats; ++r) {
+        auto start = std::chrono::high_resolution_clock::now();
+        compute_convergence(set, view, precision, width, height, smooth, out.data(), vectorized);
+        best = std::min(best, elapsed_since(start));
+    }
+    return best;
+}
+
+void run_bench(const MandelbrotSet& set, const View& view, int width, int height, bool smooth, double python_time) {
+    const int max_threads = omp_get_max_threads();
+    std::vector<float> reference(std::size_t(width) * height), out(reference.size());
+    compute_convergence(set, view, Precision::Double, width, height, smooth, reference.data(), false);
+
+    std::printf("Image %dx%d, %d iterations, rayon %g, vecteurs %s\n\n", width, height, set.max_iterations,
+                set.escape_radius, simd_name());
+    std::printf("Noyau                | Threads | Temps (secondes) | Acceleration / Python | Ecart max / reference\n");
+    std::printf("---------------------|---------|------------------|-----------------------|----------------------\n");
+    std::printf("Python (README)      | 1       | %16.4f | %21.1f | -\n", python_time, 1.);
+    struct Case {
+        const char* name;
+        Precision precision;
+        bool vectorized;
+    };
+    const Case cases[] = {{"scalaire double", Precision::Double, false},
+                          {"scalaire float", Precision::Float, false},
+                          {"SIMD double", Precision::Double, true},
+                          {"SIMD float", Precision::Float, true}};
+    for (const auto& c : cases) {
+        for (int threads : {1, max_threads}) {
+            double t = time_compute(set, view, c.precision, width, height, smooth, c.vectorized, threads, out);
+            double error = 0.;
+            for (std::size_t i = 0; i < out.size(); ++i)
+                error = std::max(error, double(std::fabs(out[i] - reference[i])));
+            char name[32];
+            std::snprintf(name, sizeof(name), "%s (x%d)", c.name, c.vectorized ? simd_lanes(c.precision) : 1);
+            std::printf("%-20s | %-7d | %16.4f | %21.1f | %.2e\n", name, threads, t, python_time / t, error);
+            if (max_threads == 1) break;
+        }
+    }
+}
+// Iteration counts to [0, 1] over the frame, as in mandelbrot_v3.py : at depth
+// all the pixels need many iterations, only their spread is meaningful
+void normalize_counts(std::vector<float>& counts, int max_iterations) {
+    float low = float(max_iterations), high = 0.f;
+    for (float c : counts) {
+        if (c >= max_iterations) continue;
+        low = std::min(low, c);
+        high = std::max(high, c);
+    }
+    const float range = high > low ? high - low : 1.f;
+    for (float& c : counts) c = c >= max_iterations ? 1.f : (c - low) / range;
+}
+
+// Perturbation with and without series approximation against the multiprecision
+// iteration of every pixel, timed on `sample` pixels and extrapolated to the image
+void run_deep_bench(const MandelbrotSet& set, const std::string& center_re, const std::string& center_im,
+                    double radius, int width, int height, bool smooth, int sample) {
+    DeepZoom zoom(set, center_re, center_im, radius, width, height);
+    const std::size_t npixels = std::size_t(width) * height;
+    std::vector<float> plain(npixels), series(npixels);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    zoom.prepare(false);
+    double t_reference = elapsed_since(start);
+    start = std::chrono::high_resolution_clock::now();
+    zoom.count_image(smooth, plain.data());
+    double t_plain = elapsed_since(start);
+    long long rebases = zoom.rebases();
+
+    start = std::chrono::high_resolution_clock::now();
+    zoom.prepare(true);
+    double t_series_prepare = elapsed_since(start);
+    start = std::chrono::high_resolution_clock::now();
+    zoom.count_image(smooth, series.data());
+    double t_series = elapsed_since(start);
+
+    // Multiprecision on pixels spread over the whole image
+    sample = int(std::min<std::size_t>(std::max(sample, 1), npixels));
+    const std::size_t stride = npixels / sample;
+    double error_plain = 0., error_series = 0.;
+    start = std::chrono::high_resolution_clock::now();
+    for (int s = 0; s < sample; ++s) {
+        std::size_t p = s * stride + stride / 2;
+        double exact = zoom.count_iterations_multiprecision(int(p % width), int(p / width), smooth);
+        error_plain = std::max(error_plain, std::fabs(plain[p] - exact));
+        error_series = std::max(error_series, std::fabs(series[p] - exact));
+    }
+    double t_exact = elapsed_since(start) * double(npixels) / sample;
+
+    std::size_t mismatches = 0;
+    for (std::size_t p = 0; p < npixels; ++p)
+        if (std::fabs(plain[p] - series[p]) >= 1.f) ++mismatches;
+
+    std::printf("Image %dx%d, %d iterations, rayon %g, %d bits, orbite de reference : %d iterations (%.4f s)\n",
+                width, height, set.max_iterations, radius, zoom.precision_bits(), zoom.reference_length(),
+                t_reference);
+    std::printf("Serie : %d iterations sautees (%.4f s), %lld rebasements par image, %zu pixels differant "
+                "d'une iteration ou plus avec/sans serie\n\n",
+                zoom.skipped_iterations(), t_series_prepare, rebases, mismatches);
+    std::printf("Methode                    | Temps (secondes) | Acceleration | Ecart max (%d pixels)\n", sample);
+    std::printf("---------------------------|------------------|--------------|---------------------\n");
+    std::printf("multiprecision (extrapole) | %16.4f | %12.1f | -\n", t_exact, 1.);
+    std::printf("perturbation               | %16.4f | %12.1f | %.2e\n", t_plain, t_exact / t_plain, error_plain);
+    std::printf("perturbation + serie       | %16.4f | %12.1f | %.2e\n", t_series, t_exact / t_series,
+                error_series);
+}
+}  // namespace
+
+int main(int nargs, char* argv[]) {
+    int width = 1024, height = 1024;
+    MandelbrotSet mandelbrot_set{50, 10.};
+    Precision precision = Precision::Double;
+    double xmin = -2., xmax = 1., ymin = -1.125, ymax = 1.125;
+    bool smooth = true, bench = false;
+    double python_time = 2.0647;
+    std::string out_file = "mandel.png";
+    std::string center_re, center_im;
+    double radius = 0.;
+    bool series = true;
+    int sample = 64;
+    try {
+        for (int a = 1; a < nargs; ++a) {
+            std::string arg = argv[a];
+            bool has_value = a + 1 < nargs;
+            if (arg == "--size" && has_value) {
+                std::string value = argv[++a];
+                auto x = value.find('x');
+                width = std::stoi(value.substr(0, x));
+                height = std::stoi(value.substr(x + 1));
+            } else if (arg == "--max-iterations" && has_value) {
+                mandelbrot_set.max_iterations = std::stoi(argv[++a]);
+            } else if (arg == "--escape-radius" && has_value) {
+                mandelbrot_set.escape_radius = std::stod(argv[++a]);
+            } else if (arg == "--precision" && has_value) {
+                std::string value = argv[++a];
+                if (value != "float" && value != "double") throw std::invalid_argument("precision " + value);
+                precision = value == "float" ? Precision::Float : Precision::Double;
+            } else if (arg == "--view" && has_value) {
+                std::stringstream values(argv[++a]);
+                char comma;
+                if (!(values >> xmin >> comma >> xmax >> comma >> ymin >> comma >> ymax))
+                    throw std::invalid_argument("view " + values.str());
+            } else if (arg == "--center" && has_value) {
+                std::string value = argv[++a];
+                auto comma = value.find(',');
+                if (comma == std::string::npos) throw std::invalid_argument("center " + value);
+                center_re = value.substr(0, comma);
+                center_im = value.substr(comma + 1);
+            } else if (arg == "--radius" && has_value) {
+                radius = std::stod(argv[++a]);
+            } else if (arg == "--no-series") {
+                series = false;
+            } else if (arg == "--sample" && has_value) {
+                sample = std::stoi(argv[++a]);
+            } else if (arg == "--no-smooth") {
+                smooth = false;
+            } else if (arg == "--out" && has_value) {
+                out_file = argv[++a];
+            } else if (arg == "--bench") {
+                bench = true;
+            } else if (arg == "--python-time" && has_value) {
+                python_time = std::stod(argv[++a]);
+            } else {
+                throw std::invalid_argument(arg);
+            }
+        }
+    } catch (const std::logic_error& e) {
+        std::cerr << "Argument invalide : " << e.what() << std::endl;
+        return 1;
+    }
+    if (width <= 0 || height <= 0 || mandelbrot_set.max_iterations <= 0) {
+        std::cerr << "Taille d'image et nombre d'iterations positifs attendus" << std::endl;
+        return 1;
+    }
+    const bool deep = !center_re.empty() || radius > 0.;
+    if (deep && (center_re.empty() || !(radius > 0.))) {
+        std::cerr << "Le zoom profond demande --center et --radius" << std::endl;
+        return 1;
+    }
+    View view = View::fit(width, height, xmin, xmax, ymin, ymax);
+
+    if (bench && deep) {
+        try {
+            run_deep_bench(mandelbrot_set, center_re, center_im, radius, width, height, smooth, sample);
+        } catch (const std::invalid_argument& e) {
+            std::cerr << "Argument invalide : " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (bench) {
+        run_bench(mandelbrot_set, view, width, height, smooth, python_time);
+        return 0;
+    }
+
+    auto deb_total = std::chrono::high_resolution_clock::now();
+    std::vector<float> convergence(std::size_t(width) * height);
+    // Calcul de l'ensemble de mandelbrot :
+    auto deb = std::chrono::high_resolution_clock::now();
+    if (deep) {
+        try {
+            DeepZoom zoom(mandelbrot_set, center_re, center_im, radius, width, height);
+            zoom.prepare(series);
+            std::cout << "Orbite de reference : " << zoom.reference_length() << " iterations sur "
+                      << zoom.precision_bits() << " bits, " << zoom.skipped_iterations()
+                      << " iterations sautees par la serie, temps : " << elapsed_since(deb) << std::endl;
+            zoom.count_image(smooth, convergence.data());
+        } catch (const std::invalid_argument& e) {
+            std::cerr << "Argument invalide : " << e.what() << std::endl;
+            return 1;
+        }
+        normalize_counts(convergence, mandelbrot_set.max_iterations);
+    } else {
+        compute_convergence(mandelbrot_set, view, precision, width, height, smooth, convergence.data());
+    }
+    std::cout << "Temps du calcul de l'ensemble de Mandelbrot : " << elapsed_since(deb) << std::endl;
+
+    // Constitution de l'image résultante :
+    deb = std::chrono::high_resolution_clock::now();
+    std::vector<unsigned char> image(convergence.size() * 3);
+    apply_colormap(convergence.data(), convergence.size(), image.data());
+    std::cout << "Temps de constitution de l'image : " << elapsed_since(deb) << std::endl;
+    try {
+        write_image(out_file, width, height, image.data());
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << "Temps total : " << elapsed_since(deb_total) << std::endl;
+    return 0;
+}
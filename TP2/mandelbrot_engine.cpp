@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <cmath>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+#include "mandelbrot_engine.hpp"
+
+template <class Real>
+Real MandelbrotSet::count_iterations(Real cr, Real ci, bool smooth) const {
+    // On vérifie dans un premier temps si le complexe n'appartient pas à une zone
+    // de convergence connue :
+    //   1. Appartenance aux disques C0{(0,0),1/4} et C1{(-1,0),1/4}
+    if (cr * cr + ci * ci < Real(0.0625)) return Real(max_iterations);
+    if ((cr + 1) * (cr + 1) + ci * ci < Real(0.0625)) return Real(max_iterations);
+    //   2. Appartenance à la cardioïde {(1/4,0),1/2(1-cos(theta))}
+    if (cr > Real(-0.75) && cr < Real(0.5)) {
+        Real ctr = cr - Real(0.25);
+        Real ctnrm = std::sqrt(ctr * ctr + ci * ci);
+        if (ctnrm < Real(0.5) * (1 - ctr / std::max(ctnrm, Real(1.E-14)))) return Real(max_iterations);
+    }
+    // Sinon on itère
+    const Real r2max = Real(escape_radius * escape_radius);
+    Real zr = 0, zi = 0;
+    for (int iter = 0; iter < max_iterations; ++iter) {
+        Real zr2 = zr * zr, zi2 = zi * zi;
+        zi = (zr + zr) * zi + ci;
+        zr = zr2 - zi2 + cr;
+        Real r2 = zr * zr + zi * zi;
+        if (r2 > r2max) {
+            if (smooth) return Real(iter + 1 - std::log(0.5 * std::log(double(r2))) / std::log(2.));
+            return Real(iter);
+        }
+    }
+    return Real(max_iterations);
+}
+
+template <class Real>
+Real MandelbrotSet::convergence(Real cr, Real ci, bool smooth, bool clamp) const {
+    Real value = count_iterations(cr, ci, smooth) / max_iterations;
+    return clamp ? std::max(Real(0), std::min(value, Real(1))) : value;
+}
+
+template float MandelbrotSet::count_iterations<float>(float, float, bool) const;
+template double MandelbrotSet::count_iterations<double>(double, double, bool) const;
+template float MandelbrotSet::convergence<float>(float, float, bool, bool) const;
+template double MandelbrotSet::convergence<double>(double, double, bool, bool) const;
+
+namespace {
+// Operations on a vector of `lanes` reals and on the masks given by comparisons.
+// blend(m, a, b) : b where m is set, a elsewhere.
+template <class Real>
+struct Simd;
+
+#if defined(__AVX512F__)
+template <>
+struct Simd<double> {
+    using V = __m512d;
+    using M = __mmask8;
+    static constexpr int lanes = 8;
+    static V set1(double a) { return _mm512_set1_pd(a); }
+    static V ramp() { return _mm512_set_pd(7, 6, 5, 4, 3, 2, 1, 0); }
+    static V add(V a, V b) { return _mm512_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm512_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm512_mul_pd(a, b); }
+    static V div(V a, V b) { return _mm512_div_pd(a, b); }
+    // maskz forms : the plain ones read an undefined register (-Wmaybe-uninitialized with GCC 12)
+    static V max(V a, V b) { return _mm512_maskz_max_pd(0xFF, a, b); }
+    static V sqrt(V a) { return _mm512_maskz_sqrt_pd(0xFF, a); }
+    static M lt(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+    static M gt(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+    static M all() { return 0xFF; }
+    static M mask_and(M a, M b) { return a & b; }
+    static M mask_or(M a, M b) { return a | b; }
+    static M mask_andnot(M a, M b) { return a & ~b; }
+    static bool any(M m) { return m != 0; }
+    static V blend(M m, V a, V b) { return _mm512_mask_blend_pd(m, a, b); }
+    static void store(double* p, V a) { _mm512_storeu_pd(p, a); }
+};
+
+template <>
+struct Simd<float> {
+    using V = __m512;
+    using M = __mmask16;
+    static constexpr int lanes = 16;
+    static V set1(float a) { return _mm512_set1_ps(a); }
+    static V ramp() { return _mm512_set_ps(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0); }
+    static V add(V a, V b) { return _mm512_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm512_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm512_div_ps(a, b); }
+    static V max(V a, V b) { return _mm512_maskz_max_ps(0xFFFF, a, b); }
+    static V sqrt(V a) { return _mm512_maskz_sqrt_ps(0xFFFF, a); }
+    static M lt(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    static M gt(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+    static M all() { return 0xFFFF; }
+    static M mask_and(M a, M b) { return a & b; }
+    static M mask_or(M a, M b) { return a | b; }
+    static M mask_andnot(M a, M b) { return a & ~b; }
+    static bool any(M m) { return m != 0; }
+    static V blend(M m, V a, V b) { return _mm512_mask_blend_ps(m, a, b); }
+    static void store(float* p, V a) { _mm512_storeu_ps(p, a); }
+};
+#elif defined(__AVX2__)
+// Without mask registers the masks are vectors whose lanes are all ones or all zeros
+template <>
+struct Simd<double> {
+    using V = __m256d;
+    using M = __m256d;
+    static constexpr int lanes = 4;
+    static V set1(double a) { return _mm256_set1_pd(a); }
+    static V ramp() { return _mm256_set_pd(3, 2, 1, 0); }
+    static V add(V a, V b) { return _mm256_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+    static V div(V a, V b) { return _mm256_div_pd(a, b); }
+    static V max(V a, V b) { return _mm256_max_pd(a, b); }
+    static V sqrt(V a) { return _mm256_sqrt_pd(a); }
+    static M lt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static M gt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+    static M all() { return _mm256_castsi256_pd(_mm256_set1_epi64x(-1)); }
+    static M mask_and(M a, M b) { return _mm256_and_pd(a, b); }
+    static M mask_or(M a, M b) { return _mm256_or_pd(a, b); }
+    static M mask_andnot(M a, M b) { return _mm256_andnot_pd(b, a); }
+    static bool any(M m) { return _mm256_movemask_pd(m) != 0; }
+    static V blend(M m, V a, V b) { return _mm256_blendv_pd(a, b, m); }
+    static void store(double* p, V a) { _mm256_storeu_pd(p, a); }
+};
+
+template <>
+struct Simd<float> {
+    using V = __m256;
+    using M = __m256;
+    static constexpr int lanes = 8;
+    static V set1(float a) { return _mm256_set1_ps(a); }
+    static V ramp() { return _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0); }
+    static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm256_div_ps(a, b); }
+    static V max(V a, V b) { return _mm256_max_ps(a, b); }
+    static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+    static M lt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static M gt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static M all() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+    static M mask_and(M a, M b) { return _mm256_and_ps(a, b); }
+    static M mask_or(M a, M b) { return _mm256_or_ps(a, b); }
+    static M mask_andnot(M a, M b) { return _mm256_andnot_ps(b, a); }
+    static bool any(M m) { return _mm256_movemask_ps(m) != 0; }
+    static V blend(M m, V a, V b) { return _mm256_blendv_ps(a, b, m); }
+    static void store(float* p, V a) { _mm256_storeu_ps(p, a); }
+};
+#endif
+
+#if !defined(__AVX2__) && !defined(__AVX512F__)
+// No vector instructions : one pixel at a time through the same code
+template <class Real>
+struct Simd {
+    using V = Real;
+    using M = bool;
+    static constexpr int lanes = 1;
+    static V set1(Real a) { return a; }
+    static V ramp() { return 0; }
+    static V add(V a, V b) { return a + b; }
+    static V sub(V a, V b) { return a - b; }
+    static V mul(V a, V b) { return a * b; }
+    static V div(V a, V b) { return a / b; }
+    static V max(V a, V b) { return std::max(a, b); }
+    static V sqrt(V a) { return std::sqrt(a); }
+    static M lt(V a, V b) { return a < b; }
+    static M gt(V a, V b) { return a > b; }
+    static M all() { return true; }
+    static M mask_and(M a, M b) { return a && b; }
+    static M mask_or(M a, M b) { return a || b; }
+    static M mask_andnot(M a, M b) { return a && !b; }
+    static bool any(M m) { return m; }
+    static V blend(M m, V a, V b) { return m ? b : a; }
+    static void store(Real* p, V a) { *p = a; }
+};
+#endif
+
+// The pixels of a vector keep iterating until they all escaped : the escape
+// iteration and |z|^2 of a lane are recorded by the mask when it first escapes,
+// its later values are not used. Two independent vectors are iterated together so
+// that the latency of one recurrence is hidden by the other.
+template <class Real>
+void convergence_row_simd(const MandelbrotSet& set, const View& view, int y, int x0, int n, bool smooth,
+                          float* out) {
+    using S = Simd<Real>;
+    using V = typename S::V;
+    using M = typename S::M;
+    constexpr int L = S::lanes;
+    constexpr int K = 2;
+    const int max_iterations = set.max_iterations;
+    const V ci = S::set1(Real(view.ymin + y * view.scale_y));
+    const V ci2 = S::mul(ci, ci);
+    const V xmin = S::set1(Real(view.xmin)), scale_x = S::set1(Real(view.scale_x));
+    const V quarter2 = S::set1(Real(0.0625)), one = S::set1(Real(1)), half = S::set1(Real(0.5));
+    const V r2max = S::set1(Real(set.escape_radius * set.escape_radius));
+    const double inv_log2 = 1. / std::log(2.);
+    Real iterations[K * L], modulus2[K * L];
+
+    for (int x = x0; x < x0 + n; x += K * L) {
+        V cr[K], zr[K], zi[K], iter[K], mod2[K];
+        M active[K];
+        for (int k = 0; k < K; ++k) {
+            cr[k] = S::add(xmin, S::mul(scale_x, S::add(S::set1(Real(x + k * L)), S::ramp())));
+
+            // Known convergence zones : discs C0, C1 and the cardioid
+            M inside = S::lt(S::add(S::mul(cr[k], cr[k]), ci2), quarter2);
+            V cr1 = S::add(cr[k], one);
+            inside = S::mask_or(inside, S::lt(S::add(S::mul(cr1, cr1), ci2), quarter2));
+            V ctr = S::sub(cr[k], S::set1(Real(0.25)));
+            V ctnrm = S::sqrt(S::add(S::mul(ctr, ctr), ci2));
+            M cardioid = S::mask_and(S::gt(cr[k], S::set1(Real(-0.75))), S::lt(cr[k], half));
+            V bound = S::mul(half, S::sub(one, S::div(ctr, S::max(ctnrm, S::set1(Real(1.E-14))))));
+            inside = S::mask_or(inside, S::mask_and(cardioid, S::lt(ctnrm, bound)));
+
+            active[k] = S::mask_andnot(S::all(), inside);
+            zr[k] = zi[k] = mod2[k] = S::set1(0);
+            iter[k] = S::set1(Real(max_iterations));
+        }
+        for (int it = 0; it < max_iterations && S::any(S::mask_or(active[0], active[1])); ++it) {
+            const V current = S::set1(Real(it));
+            for (int k = 0; k < K; ++k) {
+                V zr2 = S::mul(zr[k], zr[k]), zi2 = S::mul(zi[k], zi[k]);
+                zi[k] = S::add(S::mul(S::add(zr[k], zr[k]), zi[k]), ci);
+                zr[k] = S::add(S::sub(zr2, zi2), cr[k]);
+                V r2 = S::add(S::mul(zr[k], zr[k]), S::mul(zi[k], zi[k]));
+                M escaped = S::mask_and(active[k], S::gt(r2, r2max));
+                iter[k] = S::blend(escaped, iter[k], current);
+                mod2[k] = S::blend(escaped, mod2[k], r2);
+                active[k] = S::mask_andnot(active[k], escaped);
+            }
+        }
+        for (int k = 0; k < K; ++k) {
+            S::store(iterations + k * L, iter[k]);
+            S::store(modulus2 + k * L, mod2[k]);
+        }
+
+        const int count = std::min(K * L, x0 + n - x);
+        for (int l = 0; l < count; ++l) {
+            double value = iterations[l];
+            if (smooth && iterations[l] < max_iterations)
+                value = value + 1 - std::log(0.5 * std::log(double(modulus2[l]))) * inv_log2;
+            value /= max_iterations;
+            out[x - x0 + l] = float(std::max(0., std::min(value, 1.)));
+        }
+    }
+}
+
+template <class Real>
+void convergence_row_reference(const MandelbrotSet& set, const View& view, int y, int x0, int n, bool smooth,
+                               float* out) {
+    const Real ci = Real(view.ymin + y * view.scale_y);
+    for (int x = x0; x < x0 + n; ++x) {
+        Real cr = Real(view.xmin) + Real(view.scale_x) * Real(x);
+        out[x - x0] = float(set.convergence(cr, ci, smooth));
+    }
+}
+}  // namespace
+
+const char* simd_name() {
+#if defined(__AVX512F__)
+    return "AVX-512";
+#elif defined(__AVX2__)
+    return "AVX2";
+#else
+    return "scalaire";
+#endif
+}
+
+int simd_lanes(Precision precision) {
+    return precision == Precision::Float ? Simd<float>::lanes : Simd<double>::lanes;
+}
+
+void convergence_row(const MandelbrotSet& set, const View& view, Precision precision, int y, int x0, int n,
+                     bool smooth, float* out) {
+    if (precision == Precision::Float)
+        convergence_row_simd<float>(set, view, y, x0, n, smooth, out);
+    else
+        convergence_row_simd<double>(set, view, y, x0, n, smooth, out);
+}
+
+void convergence_row_scalar(const MandelbrotSet& set, const View& view, Precision precision, int y, int x0,
+                            int n, bool smooth, float* out) {
+    if (precision == Precision::Float)
+        convergence_row_reference<float>(set, view, y, x0, n, smooth, out);
+    else
+        convergence_row_reference<double>(set, view, y, x0, n, smooth, out);
+}
+
+void compute_convergence(const MandelbrotSet& set, const View& view, Precision precision, int width, int height,
+                         bool smooth, float* out, bool vectorized) {
+    // The cost of a row depends on how much of the set it crosses : dynamic schedule
+#pragma omp parallel for schedule(dynamic)
+    for (int y = 0; y < height; ++y) {
+        float* row = out + std::size_t(y) * width;
+        if (vectorized)
+            convergence_row(set, view, precision, y, 0, width, smooth, row);
+        else
+            convergence_row_scalar(set, view, precision, y, 0, width, smooth, row);
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef _MANDELBROT_ENGINE_HPP_
+#define _MANDELBROT_ENGINE_HPP_
+
+// Native version of the MandelbrotSet class of mandelbrot.py : same early out
+// (discs of radius 1/4 around 0 and -1, main cardioid), escape radius, smooth
+// iteration count and clamping, the pixels of a row being iterated by SIMD
+// vectors (AVX-512 or AVX2 according to the -march flags, scalar otherwise).
+
+enum class Precision { Float, Double };
+
+struct MandelbrotSet {
+    int max_iterations;
+    double escape_radius = 2.0;
+
+    // Same as MandelbrotSet.count_iterations of mandelbrot.py, one point at a time
+    template <class Real>
+    Real count_iterations(Real cr, Real ci, bool smooth = false) const;
+
+    // count_iterations / max_iterations, clamped to [0, 1] if `clamp`
+    template <class Real>
+    Real convergence(Real cr, Real ci, bool smooth = false, bool clamp = true) const;
+};
+
+// Region of the complex plane : pixel (x, y) is c = (xmin + x*scale_x) + i (ymin + y*scale_y)
+struct View {
+    double xmin = -2., ymin = -1.125;
+    double scale_x = 3. / 1024, scale_y = 2.25 / 1024;
+
+    // [xmin, xmax] x [ymin, ymax] on width x height pixels (the region of mandelbrot.py by default)
+    static View fit(int width, int height, double xmin = -2., double xmax = 1., double ymin = -1.125,
+                    double ymax = 1.125) {
+        return {xmin, ymin, (xmax - xmin) / width, (ymax - ymin) / height};
+    }
+};
+
+// Name of the vector instruction set the kernels were compiled for
+const char* simd_name();
+
+// Number of pixels iterated together for the given precision
+int simd_lanes(Precision precision);
+
+// Clamped convergence of the pixels x0 .. x0+n-1 of row y into out[0 .. n-1]
+void convergence_row(const MandelbrotSet& set, const View& view, Precision precision, int y, int x0, int n,
+                     bool smooth, float* out);
+
+// Same values computed one pixel at a time with count_iterations (reference)
+void convergence_row_scalar(const MandelbrotSet& set, const View& view, Precision precision, int y, int x0,
+                            int n, bool smooth, float* out);
+
+// Whole image, out[y*width + x]. The rows are shared among the OpenMP threads.
+void compute_convergence(const MandelbrotSet& set, const View& view, Precision precision, int width, int height,
+                         bool smooth, float* out, bool vectorized = true);
+
+#endif
@@ -0,0 +1,487 @@
+// Rendu d'une animation (zoom vers un point) en pipeline : les images traversent
+// quatre étapes qui travaillent en même temps sur des images différentes, reliées
+// par des files bornées sans verrou (tasks/bounded_queue.hpp) :
+//   - calcul        : chaque processus calcule ses lignes (distribuées par groupes
+//                     de --rows-chunk lignes, cycliquement), partagées entre ses
+//                     threads OpenMP
+//   - rassemblement : un thread de chaque processus envoie ses lignes au processus 0
+//                     (MPI_Gatherv) pendant que le calcul passe à l'image suivante
+//   - couleurs      : sur le processus 0, table de couleurs vectorisée
+//   - encodage      : sur le processus 0, --encoders threads encodent les images
+//                     (PNG ou PPM) et les écrivent dans --out-dir
+// Le nombre de tampons entre deux étapes borne le nombre d'images en vol. Le débit
+// est celui de l'étape la plus lente et non l'inverse de la somme des temps des
+// étapes, que donne --sequential (les étapes l'une après l'autre, image par image).
+//
+//   mpirun -np 4 ./mandelbrot_frames.exe [options]
+//     --size WxH               image size (800x600)
+//     --frames N               (64)
+//     --center RE,IM           point the animation zooms to (-0.743643887,0.131825904)
+//     --radius r               half height of the first image (1.5)
+//     --zoom z                 radius multiplied by z from an image to the next (0.93)
+//     --max-iterations N       (500)
+//     --precision float|double (double)
+//     --rows-chunk R           rows dealt to the processes by groups of R (4)
+//     --depth D                buffers between two stages (4)
+//     --encoders E             encoding threads on process 0 (2)
+//     --format png|ppm         (png)
+//     --out-dir dir            frame_NNNNN.png (or .ppm) written there, nothing written otherwise
+//     --sequential             the stages one after the other, image after image
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <mpi.h>
+#include <omp.h>
+#include "bounded_queue.hpp"
+#include "image_io.hpp"
+#include "mandelbrot_engine.hpp"
+
+namespace {
+// Index of the buffer announcing the end of the animation
+const int END = -1;
+
+struct Animation {
+    MandelbrotSet set;
+    Precision precision;
+    int width, height, frames;
+    double center_x, center_y, radius, zoom;
+
+    View view(int frame) const {
+        const double r = radius * std::pow(zoom, frame);
+        const double half_width = r * width / height;
+        return View::fit(width, height, center_x - half_width, center_x + half_width, center_y - r, center_y + r);
+    }
+};
+
+// Rows of every process : groups of `chunk` consecutive rows dealt cyclically
+std::vector<std::vector<int>> deal_rows(int height, int chunk, int nbp) {
+    std::vector<std::vector<int>> rows(nbp);
+    for (int y = 0; y < height; ++y) rows[(y / chunk) % nbp].push_back(y);
+    return rows;
+}
+
+// busy : time spent working ; wait_input : waiting for an image of the previous
+// stage ; wait_output : waiting for a free buffer of the next one. Summed over the
+// threads of the stage.
+struct StageTimes {
+    long frames = 0;
+    double busy = 0., wait_input = 0., wait_output = 0.;
+
+    void add(const StageTimes& other) {
+        frames += other.frames;
+        busy += other.busy;
+        wait_input += other.wait_input;
+        wait_output += other.wait_output;
+    }
+};
+
+// Buffer indices going from a stage to the next one. A thread finding the queue
+// empty spins a little, then yields and then sleeps : a single core may have to run
+// every stage. The occupancy is sampled after every push.
+class Channel {
+public:
+    explicit Channel(int depth) : queue(depth) {}
+
+    void push(int slot) {
+        for (int round = 0; !queue.try_push(slot); ++round) backoff(round);
+        if (slot == END) return;
+        const long occupancy = long(queue.size());
+        samples.fetch_add(1, std::memory_order_relaxed);
+        occupancy_sum.fetch_add(occupancy, std::memory_order_relaxed);
+        long seen = occupancy_max.load(std::memory_order_relaxed);
+        while (occupancy > seen && !occupancy_max.compare_exchange_weak(seen, occupancy)) {
+        }
+    }
+
+    // The time spent waiting is added to `waited`
+    int pop(double& waited) {
+        int slot;
+        if (queue.try_pop(slot)) return slot;
+        const double start = omp_get_wtime();
+        for (int round = 0; !queue.try_pop(slot); ++round) backoff(round);
+        waited += omp_get_wtime() - start;
+        return slot;
+    }
+
+    double mean_occupancy() const {
+        const long n = samples.load();
+        return n > 0 ? double(occupancy_sum.load()) / n : 0.;
+    }
+    long max_occupancy() const { return occupancy_max.load(); }
+
+private:
+    static void backoff(int round) {
+        if (round < 64) return;
+        if (round < 128)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+    BoundedQueue<int> queue;
+    std::atomic<long> samples{0}, occupancy_sum{0}, occupancy_max{0};
+};
+
+struct QueueStats {
+    double mean = 0.;
+    long max = 0;
+    int buffers = 0;
+};
+
+// Buffers of a stage and the image each one holds
+struct Pool {
+    std::vector<std::vector<float>> values;
+    std::vector<std::vector<unsigned char>> rgb;
+    std::vector<int> frame;
+};
+
+struct Renderer {
+    Animation animation;
+    MPI_Comm comm;
+    int rank, nbp, encoders;
+    std::string format, out_dir;
+    std::vector<std::vector<int>> rows;     // rows of every process
+    std::vector<int> counts, displs;        // values sent by every process
+    std::vector<float> staging;             // process 0 : values ordered by process
+    std::vector<std::uint64_t> checksums;   // process 0 : hash of the pixels of every image
+    std::atomic<bool> failed{false};
+    QueueStats queue_stats[3];              // pipeline : computed, gathered, colored images
+
+    std::size_t pixels() const { return std::size_t(animation.width) * animation.height; }
+
+    void compute(int frame, float* out) const {
+        const View view = animation.view(frame);
+        const std::vector<int>& mine = rows[rank];
+#pragma omp parallel for schedule(dynamic)
+        for (std::size_t k = 0; k < mine.size(); ++k) {
+            convergence_row(animation.set, view, animation.precision, mine[k], 0, animation.width, true,
+                            out + k * animation.width);
+        }
+    }
+
+    // Rows of every process into `image` on process 0. The time includes the wait
+    // for the processes still computing the image.
+    void gather(const float* mine, float* image) {
+        MPI_Gatherv(mine, counts[rank], MPI_FLOAT, staging.data(), counts.data(), displs.data(), MPI_FLOAT, 0,
+                    comm);
+        if (rank != 0) return;
+        const int width = animation.width;
+        for (int p = 0; p < nbp; ++p) {
+            const float* from = staging.data() + displs[p];
+            for (std::size_t k = 0; k < rows[p].size(); ++k)
+                std::memcpy(image + std::size_t(rows[p][k]) * width, from + k * width, width * sizeof(float));
+        }
+    }
+
+    void encode(int frame, const unsigned char* rgb) {
+        const int width = animation.width, height = animation.height;
+        // 8 bytes at a time : the checksum costs little next to the encoding
+        std::uint64_t hash = 1469598103934665603ULL;
+        const std::size_t size = pixels() * 3;
+        std::size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            std::uint64_t word;
+            std::memcpy(&word, rgb + i, 8);
+            hash = (hash ^ word) * 1099511628211ULL;
+        }
+        for (; i < size; ++i) hash = (hash ^ rgb[i]) * 1099511628211ULL;
+        checksums[frame] = hash;
+
+        std::vector<unsigned char> bytes =
+            format == "png" ? encode_png(width, height, rgb) : encode_ppm(width, height, rgb);
+        if (out_dir.empty()) return;
+        char name[32];
+        std::snprintf(name, sizeof(name), "/frame_%05d.%s", frame, format.c_str());
+        try {
+            write_bytes(out_dir + name, bytes);
+        } catch (const std::runtime_error& e) {
+            if (!failed.exchange(true)) std::cerr << e.what() << std::endl;
+        }
+    }
+
+    // Every stage in turn for every image : compute, gather, colormap, encode
+    std::vector<StageTimes> run_sequential() {
+        std::vector<StageTimes> times(4);
+        std::vector<float> mine(std::size_t(counts[rank])), image(rank == 0 ? pixels() : 0);
+        std::vector<unsigned char> rgb(rank == 0 ? pixels() * 3 : 0);
+        for (int frame = 0; frame < animation.frames; ++frame) {
+            double t = omp_get_wtime();
+            compute(frame, mine.data());
+            times[0].busy += omp_get_wtime() - t;
+            t = omp_get_wtime();
+            gather(mine.data(), image.data());
+            times[1].busy += omp_get_wtime() - t;
+            if (rank == 0) {
+                t = omp_get_wtime();
+                apply_colormap(image.data(), image.size(), rgb.data());
+                times[2].busy += omp_get_wtime() - t;
+                t = omp_get_wtime();
+                encode(frame, rgb.data());
+                times[3].busy += omp_get_wtime() - t;
+            }
+            for (auto& stage : times) ++stage.frames;
+        }
+        return times;
+    }
+
+    // The main thread computes ; a thread of every process gathers ; on process 0,
+    // one thread applies the colormap and `encoders` threads encode. Each link has
+    // `depth` buffers : a free pool the producer takes them from, and the queue of
+    // filled ones. Only the gathering thread calls MPI while the pipeline runs.
+    std::vector<StageTimes> run_pipeline(int depth) {
+        std::vector<StageTimes> times(4);
+        Pool local, frames, colored;
+        local.values.assign(depth, std::vector<float>(std::size_t(counts[rank])));
+        local.frame.assign(depth, 0);
+        Channel free_local(depth), computed(depth);
+        // Each encoder holds its image while encoding it
+        const int rgb_depth = depth + encoders;
+        Channel free_frames(depth), gathered(depth), free_rgb(rgb_depth), ready(rgb_depth);
+        if (rank == 0) {
+            frames.values.assign(depth, std::vector<float>(pixels()));
+            frames.frame.assign(depth, 0);
+            colored.rgb.assign(rgb_depth, std::vector<unsigned char>(pixels() * 3));
+            colored.frame.assign(rgb_depth, 0);
+            for (int s = 0; s < depth; ++s) free_frames.push(s);
+            for (int s = 0; s < rgb_depth; ++s) free_rgb.push(s);
+        }
+        for (int s = 0; s < depth; ++s) free_local.push(s);
+
+        std::thread gathering([&] {
+            StageTimes& mine = times[1];
+            while (true) {
+                const int slot = computed.pop(mine.wait_input);
+                if (slot == END) break;
+                const int image = rank == 0 ? free_frames.pop(mine.wait_output) : 0;
+                const double t = omp_get_wtime();
+                gather(local.values[slot].data(), rank == 0 ? frames.values[image].data() : nullptr);
+                mine.busy += omp_get_wtime() - t;
+                ++mine.frames;
+                if (rank == 0) {
+                    frames.frame[image] = local.frame[slot];
+                    gathered.push(image);
+                }
+                free_local.push(slot);
+            }
+            if (rank == 0) gathered.push(END);
+        });
+
+        std::vector<std::thread> workers;
+        std::mutex times_lock;
+        if (rank == 0) {
+            workers.emplace_back([&] {
+                StageTimes& mine = times[2];
+                while (true) {
+                    const int image = gathered.pop(mine.wait_input);
+                    if (image == END) break;
+                    const int slot = free_rgb.pop(mine.wait_output);
+                    const double t = omp_get_wtime();
+                    apply_colormap(frames.values[image].data(), pixels(), colored.rgb[slot].data());
+                    mine.busy += omp_get_wtime() - t;
+                    ++mine.frames;
+                    colored.frame[slot] = frames.frame[image];
+                    free_frames.push(image);
+                    ready.push(slot);
+                }
+                for (int e = 0; e < encoders; ++e) ready.push(END);
+            });
+            for (int e = 0; e < encoders; ++e) {
+                workers.emplace_back([&] {
+                    StageTimes mine;
+                    while (true) {
+                        const int slot = ready.pop(mine.wait_input);
+                        if (slot == END) break;
+                        const double t = omp_get_wtime();
+                        encode(colored.frame[slot], colored.rgb[slot].data());
+                        mine.busy += omp_get_wtime() - t;
+                        ++mine.frames;
+                        free_rgb.push(slot);
+                    }
+                    std::lock_guard<std::mutex> guard(times_lock);
+                    times[3].add(mine);
+                });
+            }
+        }
+
+        StageTimes& mine = times[0];
+        for (int frame = 0; frame < animation.frames; ++frame) {
+            const int slot = free_local.pop(mine.wait_output);
+            const double t = omp_get_wtime();
+            compute(frame, local.values[slot].data());
+            mine.busy += omp_get_wtime() - t;
+            ++mine.frames;
+            local.frame[slot] = frame;
+            computed.push(slot);
+        }
+        computed.push(END);
+        gathering.join();
+        for (auto& worker : workers) worker.join();
+
+        const Channel* links[3] = {&computed, &gathered, &ready};
+        for (int q = 0; q < 3; ++q) queue_stats[q] = {links[q]->mean_occupancy(), links[q]->max_occupancy(), depth};
+        queue_stats[2].buffers = rgb_depth;
+        return times;
+    }
+};
+}  // namespace
+
+int main(int nargs, char* argv[]) {
+    int provided;
+    MPI_Init_thread(&nargs, &argv, MPI_THREAD_SERIALIZED, &provided);
+    MPI_Comm globCom;
+    MPI_Comm_dup(MPI_COMM_WORLD, &globCom);
+    int nbp, rank;
+    MPI_Comm_size(globCom, &nbp);
+    MPI_Comm_rank(globCom, &rank);
+
+    Renderer renderer;
+    Animation& animation = renderer.animation;
+    animation = {{500, 2.}, Precision::Double, 800, 600, 64, -0.743643887, 0.131825904, 1.5, 0.93};
+    renderer.comm = globCom;
+    renderer.rank = rank;
+    renderer.nbp = nbp;
+    renderer.encoders = 2;
+    renderer.format = "png";
+    int rows_chunk = 4, depth = 4;
+    bool sequential = false;
+    try {
+        for (int a = 1; a < nargs; ++a) {
+            std::string arg = argv[a];
+            bool has_value = a + 1 < nargs;
+            if (arg == "--size" && has_value) {
+                std::string value = argv[++a];
+                auto x = value.find('x');
+                animation.width = std::stoi(value.substr(0, x));
+                animation.height = std::stoi(value.substr(x + 1));
+            } else if (arg == "--frames" && has_value) {
+                animation.frames = std::stoi(argv[++a]);
+            } else if (arg == "--center" && has_value) {
+                std::string value = argv[++a];
+                auto comma = value.find(',');
+                if (comma == std::string::npos) throw std::invalid_argument("center " + value);
+                animation.center_x = std::stod(value.substr(0, comma));
+                animation.center_y = std::stod(value.substr(comma + 1));
+            } else if (arg == "--radius" && has_value) {
+                animation.radius = std::stod(argv[++a]);
+            } else if (arg == "--zoom" && has_value) {
+                animation.zoom = std::stod(argv[++a]);
+            } else if (arg == "--max-iterations" && has_value) {
+                animation.set.max_iterations = std::stoi(argv[++a]);
+            } else if (arg == "--precision" && has_value) {
+                std::string value = argv[++a];
+                if (value != "float" && value != "double") throw std::invalid_argument("precision " + value);
+                animation.precision = value == "float" ? Precision::Float : Precision::Double;
+            } else if (arg == "--rows-chunk" && has_value) {
+                rows_chunk = std::stoi(argv[++a]);
+            } else if (arg == "--depth" && has_value) {
+                depth = std::stoi(argv[++a]);
+            } else if (arg == "--encoders" && has_value) {
+                renderer.encoders = std::stoi(argv[++a]);
+            } else if (arg == "--format" && has_value) {
+                renderer.format = argv[++a];
+                if (renderer.format != "png" && renderer.format != "ppm")
+                    throw std::invalid_argument("format " + renderer.format);
+            } else if (arg == "--out-dir" && has_value) {
+                renderer.out_dir = argv[++a];
+            } else if (arg == "--sequential") {
+                sequential = true;
+            } else {
+                throw std::invalid_argument(arg);
+            }
+        }
+        if (animation.width <= 0 || animation.height <= 0 || animation.frames <= 0 || rows_chunk <= 0 ||
+            depth <= 0 || renderer.encoders <= 0 || animation.radius <= 0. || animation.zoom <= 0.)
+            throw std::invalid_argument("sizes must be positive");
+    } catch (const std::logic_error& e) {
+        if (rank == 0) std::cerr << "Argument invalide : " << e.what() << std::endl;
+        MPI_Finalize();
+        return 1;
+    }
+    if (!sequential && provided < MPI_THREAD_SERIALIZED) {
+        if (rank == 0)
+            std::cerr << "Attention : MPI sans MPI_THREAD_SERIALIZED, etapes executees l'une apres l'autre"
+                      << std::endl;
+        sequential = true;
+    }
+
+    renderer.rows = deal_rows(animation.height, rows_chunk, nbp);
+    renderer.counts.resize(nbp);
+    renderer.displs.assign(nbp, 0);
+    for (int p = 0; p < nbp; ++p) {
+        renderer.counts[p] = int(renderer.rows[p].size()) * animation.width;
+        if (p > 0) renderer.displs[p] = renderer.displs[p - 1] + renderer.counts[p - 1];
+    }
+    if (rank == 0) {
+        renderer.staging.resize(renderer.pixels());
+        renderer.checksums.assign(animation.frames, 0);
+    }
+
+    MPI_Barrier(globCom);
+    const double start = MPI_Wtime();
+    std::vector<StageTimes> times = sequential ? renderer.run_sequential() : renderer.run_pipeline(depth);
+    const double wall = MPI_Wtime() - start;
+
+    // The slowest process bounds the computing stage
+    double mine[3] = {times[0].busy, times[0].wait_input, times[0].wait_output};
+    double slowest[3];
+    MPI_Reduce(mine, slowest, 3, MPI_DOUBLE, MPI_MAX, 0, globCom);
+    int failed = renderer.failed ? 1 : 0, any_failed;
+    MPI_Reduce(&failed, &any_failed, 1, MPI_INT, MPI_MAX, 0, globCom);
+    if (rank == 0) {
+        times[0].busy = slowest[0];
+        times[0].wait_input = slowest[1];
+        times[0].wait_output = slowest[2];
+        const char* names[4] = {"calcul", "rassemblement", "couleurs", "encodage"};
+        const int threads[4] = {omp_get_max_threads(), 1, 1, sequential ? 1 : renderer.encoders};
+
+        std::printf("%d images %dx%d, %d iterations, %d processus x %d threads, %s, %s\n", animation.frames,
+                    animation.width, animation.height, animation.set.max_iterations, nbp, omp_get_max_threads(),
+                    renderer.format.c_str(), sequential ? "etapes sequentielles" : "pipeline");
+        std::printf("Etape         | Threads | Occupe (s) | Attente entree (s) | Attente sortie (s) | Debit max (images/s)\n");
+        std::printf("--------------|---------|------------|--------------------|--------------------|---------------------\n");
+        // Time of an image in a stage when its threads share the images
+        double per_frame[4], sum = 0., slowest_stage = 0.;
+        int bottleneck = 0;
+        for (int s = 0; s < 4; ++s) {
+            const int workers = s == 0 ? 1 : threads[s];
+            per_frame[s] = times[s].busy / (workers * double(animation.frames));
+            sum += per_frame[s];
+            if (per_frame[s] > slowest_stage) {
+                slowest_stage = per_frame[s];
+                bottleneck = s;
+            }
+        }
+        for (int s = 0; s < 4; ++s) {
+            std::printf("%-13s | %7d | %10.4f | %18.4f | %18.4f | %20.1f%s\n", names[s], threads[s], times[s].busy,
+                        times[s].wait_input, times[s].wait_output, 1. / per_frame[s],
+                        s == bottleneck ? " <- plus lente" : "");
+        }
+        std::printf("Temps total : %.4f s, %.1f images/s (etape la plus lente : %.1f, somme des etapes : %.1f)\n", wall,
+                    animation.frames / wall, 1. / slowest_stage, 1. / sum);
+        if (!sequential) {
+            const char* links[3] = {"calcul -> rassemblement", "rassemblement -> couleurs", "couleurs -> encodage"};
+            std::printf("File                      | Tampons | Occupation moyenne | Occupation max\n");
+            std::printf("--------------------------|---------|--------------------|---------------\n");
+            for (int q = 0; q < 3; ++q) {
+                const QueueStats& stats = renderer.queue_stats[q];
+                std::printf("%-25s | %7d | %18.2f | %14ld\n", links[q], stats.buffers, stats.mean, stats.max);
+            }
+        }
+        std::uint64_t hash = 1469598103934665603ULL;
+        for (std::uint64_t h : renderer.checksums) hash = (hash ^ h) * 1099511628211ULL;
+        std::printf("Empreinte des images : %016llx\n", (unsigned long long)hash);
+    }
+
+    MPI_Finalize();
+    return any_failed && rank == 0 ? 1 : 0;
+}
@@ -0,0 +1,392 @@
+// Calcul parallèle de l'ensemble de Mandelbrot (MPI + OpenMP) avec trois
+// répartitions du travail, comme mandelbrot_v1.py, v2.py et v3.py :
+//   - block   : un bloc de lignes contiguës par processus
+//   - cyclic  : la ligne y au processus y % nbp
+//   - master  : file de tuiles distribuée par le processus 0 ; les processus
+//               demandent des lots de tuiles et redemandent avant d'avoir vidé
+//               leur file locale, d'où les threads tirent les tuiles
+// Chaque processus mesure le temps où ses threads calculent (temps occupé) ;
+// l'efficacité est la somme des temps occupés sur nbp fois le temps écoulé.
+//
+//   mpirun -np 4 ./mandelbrot_mpi.exe [options]
+//     --size WxH               image size (1024x1024)
+//     --max-iterations N       (50)
+//     --escape-radius R        (10)
+//     --precision float|double (double)
+//     --strategy block|cyclic|master|all (all)
+//     --tile N                 master : tiles of N x N pixels (64)
+//     --batch B                master : tiles given per request (4)
+//     --out file               image of the last strategy (.png or .ppm)
+//     --check                  compare with a sequential computation on process 0
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <mpi.h>
+#include <omp.h>
+#include "image_io.hpp"
+#include "mandelbrot_engine.hpp"
+
+namespace {
+const int TAG_REQUEST = 1;
+const int TAG_TILES = 2;
+
+struct Tile {
+    int x0, y0, width, height;
+};
+
+struct Problem {
+    MandelbrotSet set;
+    View view;
+    Precision precision;
+    bool smooth;
+    int width, height;
+};
+
+// Tiles computed by a process : their index and their pixels, tile after tile
+struct Results {
+    std::vector<int> ids;
+    std::vector<float> pixels;
+};
+
+// busy : time the threads spent computing, summed and divided by the number of threads
+struct RankTimes {
+    double busy = 0., wall = 0.;
+};
+
+std::vector<Tile> make_tiles(int width, int height, int size) {
+    std::vector<Tile> tiles;
+    for (int y = 0; y < height; y += size)
+        for (int x = 0; x < width; x += size)
+            tiles.push_back({x, y, std::min(size, width - x), std::min(size, height - y)});
+    return tiles;
+}
+
+void compute_tile(const Problem& problem, const Tile& tile, Results& results) {
+    std::size_t start = results.pixels.size();
+    results.pixels.resize(start + std::size_t(tile.width) * tile.height);
+    for (int y = 0; y < tile.height; ++y) {
+        convergence_row(problem.set, problem.view, problem.precision, tile.y0 + y, tile.x0, tile.width,
+                        problem.smooth, results.pixels.data() + start + std::size_t(y) * tile.width);
+    }
+}
+
+void merge(std::vector<Results>& per_thread, Results& results) {
+    for (auto& r : per_thread) {
+        results.ids.insert(results.ids.end(), r.ids.begin(), r.ids.end());
+        results.pixels.insert(results.pixels.end(), r.pixels.begin(), r.pixels.end());
+    }
+}
+
+// block and cyclic : static list of rows, shared among the threads with a dynamic schedule
+RankTimes run_static(const Problem& problem, const std::vector<Tile>& rows, bool cyclic, Results& results,
+                     MPI_Comm comm) {
+    int rank, nbp;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nbp);
+    std::vector<int> mine;
+    const int nrows = int(rows.size());
+    if (cyclic) {
+        for (int y = rank; y < nrows; y += nbp) mine.push_back(y);
+    } else {
+        int start = rank * (nrows / nbp) + std::min(rank, nrows % nbp);
+        int count = nrows / nbp + (rank < nrows % nbp ? 1 : 0);
+        for (int y = start; y < start + count; ++y) mine.push_back(y);
+    }
+
+    const int nthreads = omp_get_max_threads();
+    std::vector<Results> per_thread(nthreads);
+    std::vector<double> busy(nthreads, 0.);
+    MPI_Barrier(comm);
+    double start = MPI_Wtime();
+#pragma omp parallel for schedule(dynamic)
+    for (std::size_t k = 0; k < mine.size(); ++k) {
+        const int thread = omp_get_thread_num();
+        double t = omp_get_wtime();
+        compute_tile(problem, rows[mine[k]], per_thread[thread]);
+        per_thread[thread].ids.push_back(mine[k]);
+        busy[thread] += omp_get_wtime() - t;
+    }
+    RankTimes times;
+    times.wall = MPI_Wtime() - start;
+    for (double b : busy) times.busy += b / nthreads;
+    merge(per_thread, results);
+    return times;
+}
+
+// master : process 0 owns the queue of tiles and also computes. Thread 0 of every
+// process handles the messages between two tiles (MPI_THREAD_FUNNELED) : on process 0
+// it answers the requests, elsewhere it asks for `batch` more tiles as soon as the
+// local queue holds no more than one tile per thread, so that the answer arrives
+// before the threads run dry. A request is answered by a range of consecutive tiles,
+// an empty range meaning that the queue is empty.
+RankTimes run_master_worker(const Problem& problem, const std::vector<Tile>& tiles, int batch, Results& results,
+                            MPI_Comm comm) {
+    int rank, nbp;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nbp);
+    const int ntiles = int(tiles.size());
+    const int nthreads = omp_get_max_threads();
+    const std::size_t low_water = std::size_t(nthreads);
+
+    std::deque<int> local;
+    std::mutex local_lock;
+    std::atomic<bool> exhausted{false};
+    // Process 0
+    int next_tile = 0, workers_done = 0;
+    // Other processes
+    bool pending = false;
+    int reply[2] = {0, 0};
+    MPI_Request request = MPI_REQUEST_NULL;
+
+    auto service = [&]() {
+        if (rank == 0) {
+            int flag = 0;
+            MPI_Status status;
+            MPI_Iprobe(MPI_ANY_SOURCE, TAG_REQUEST, comm, &flag, &status);
+            while (flag) {
+                int wanted;
+                MPI_Recv(&wanted, 1, MPI_INT, status.MPI_SOURCE, TAG_REQUEST, comm, MPI_STATUS_IGNORE);
+                int range[2] = {next_tile, std::min(wanted, ntiles - next_tile)};
+                next_tile += range[1];
+                if (range[1] == 0) ++workers_done;
+                MPI_Send(range, 2, MPI_INT, status.MPI_SOURCE, TAG_TILES, comm);
+                MPI_Iprobe(MPI_ANY_SOURCE, TAG_REQUEST, comm, &flag, &status);
+            }
+            std::lock_guard<std::mutex> guard(local_lock);
+            while (local.size() <= low_water && next_tile < ntiles) local.push_back(next_tile++);
+            if (next_tile == ntiles && workers_done == nbp - 1) exhausted = true;
+        } else {
+            if (pending) {
+                int flag = 0;
+                MPI_Test(&request, &flag, MPI_STATUS_IGNORE);
+                if (flag) {
+                    pending = false;
+                    std::lock_guard<std::mutex> guard(local_lock);
+                    for (int k = 0; k < reply[1]; ++k) local.push_back(reply[0] + k);
+                    if (reply[1] == 0) exhausted = true;
+                }
+            }
+            std::size_t queued;
+            {
+                std::lock_guard<std::mutex> guard(local_lock);
+                queued = local.size();
+            }
+            if (!pending && !exhausted && queued <= low_water) {
+                MPI_Irecv(reply, 2, MPI_INT, 0, TAG_TILES, comm, &request);
+                MPI_Send(&batch, 1, MPI_INT, 0, TAG_REQUEST, comm);
+                pending = true;
+            }
+        }
+    };
+
+    std::vector<Results> per_thread(nthreads);
+    std::vector<double> busy(nthreads, 0.);
+    MPI_Barrier(comm);
+    double start = MPI_Wtime();
+#pragma omp parallel
+    {
+        const int thread = omp_get_thread_num();
+        while (true) {
+            if (thread == 0) service();
+            int tile = -1;
+            bool done;
+            {
+                std::lock_guard<std::mutex> guard(local_lock);
+                if (!local.empty()) {
+                    tile = local.front();
+                    local.pop_front();
+                }
+                done = exhausted && local.empty();
+            }
+            if (tile >= 0) {
+                double t = omp_get_wtime();
+                compute_tile(problem, tiles[tile], per_thread[thread]);
+                per_thread[thread].ids.push_back(tile);
+                busy[thread] += omp_get_wtime() - t;
+            } else if (done) {
+                break;
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(20));
+            }
+        }
+    }
+    RankTimes times;
+    times.wall = MPI_Wtime() - start;
+    for (double b : busy) times.busy += b / nthreads;
+    merge(per_thread, results);
+    return times;
+}
+
+// Image on process 0, out[y*width + x]
+void gather_image(const Problem& problem, const std::vector<Tile>& tiles, const Results& results,
+                  std::vector<float>& image, MPI_Comm comm) {
+    int rank, nbp;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nbp);
+    int counts[2] = {int(results.ids.size()), int(results.pixels.size())};
+    std::vector<int> all_counts(2 * nbp);
+    MPI_Gather(counts, 2, MPI_INT, all_counts.data(), 2, MPI_INT, 0, comm);
+    std::vector<int> id_counts(nbp), id_displs(nbp, 0), pixel_counts(nbp), pixel_displs(nbp, 0);
+    for (int p = 0; p < nbp; ++p) {
+        id_counts[p] = all_counts[2 * p];
+        pixel_counts[p] = all_counts[2 * p + 1];
+        if (p > 0) {
+            id_displs[p] = id_displs[p - 1] + id_counts[p - 1];
+            pixel_displs[p] = pixel_displs[p - 1] + pixel_counts[p - 1];
+        }
+    }
+    std::vector<int> ids(rank == 0 ? tiles.size() : 0);
+    std::vector<float> pixels(rank == 0 ? std::size_t(problem.width) * problem.height : 0);
+    MPI_Gatherv(results.ids.data(), counts[0], MPI_INT, ids.data(), id_counts.data(), id_displs.data(), MPI_INT,
+                0, comm);
+    MPI_Gatherv(results.pixels.data(), counts[1], MPI_FLOAT, pixels.data(), pixel_counts.data(),
+                pixel_displs.data(), MPI_FLOAT, 0, comm);
+    if (rank != 0) return;
+
+    image.assign(std::size_t(problem.width) * problem.height, 0.f);
+    std::size_t offset = 0;
+    for (int id : ids) {
+        const Tile& tile = tiles[id];
+        for (int y = 0; y < tile.height; ++y) {
+            std::copy_n(pixels.begin() + offset + std::size_t(y) * tile.width, tile.width,
+                        image.begin() + std::size_t(tile.y0 + y) * problem.width + tile.x0);
+        }
+        offset += std::size_t(tile.width) * tile.height;
+    }
+}
+}  // namespace
+
+int main(int nargs, char* argv[]) {
+    int provided;
+    MPI_Init_thread(&nargs, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm globCom;
+    MPI_Comm_dup(MPI_COMM_WORLD, &globCom);
+    int nbp, rank;
+    MPI_Comm_size(globCom, &nbp);
+    MPI_Comm_rank(globCom, &rank);
+
+    Problem problem{{50, 10.}, View(), Precision::Double, true, 1024, 1024};
+    std::string strategy = "all", out_file;
+    int tile_size = 64, batch = 4;
+    bool check = false;
+    try {
+        for (int a = 1; a < nargs; ++a) {
+            std::string arg = argv[a];
+            bool has_value = a + 1 < nargs;
+            if (arg == "--size" && has_value) {
+                std::string value = argv[++a];
+                auto x = value.find('x');
+                problem.width = std::stoi(value.substr(0, x));
+                problem.height = std::stoi(value.substr(x + 1));
+            } else if (arg == "--max-iterations" && has_value) {
+                problem.set.max_iterations = std::stoi(argv[++a]);
+            } else if (arg == "--escape-radius" && has_value) {
+                problem.set.escape_radius = std::stod(argv[++a]);
+            } else if (arg == "--precision" && has_value) {
+                std::string value = argv[++a];
+                if (value != "float" && value != "double") throw std::invalid_argument("precision " + value);
+                problem.precision = value == "float" ? Precision::Float : Precision::Double;
+            } else if (arg == "--strategy" && has_value) {
+                strategy = argv[++a];
+                if (strategy != "block" && strategy != "cyclic" && strategy != "master" && strategy != "all")
+                    throw std::invalid_argument("strategy " + strategy);
+            } else if (arg == "--tile" && has_value) {
+                tile_size = std::stoi(argv[++a]);
+            } else if (arg == "--batch" && has_value) {
+                batch = std::stoi(argv[++a]);
+            } else if (arg == "--out" && has_value) {
+                out_file = argv[++a];
+            } else if (arg == "--check") {
+                check = true;
+            } else {
+                throw std::invalid_argument(arg);
+            }
+        }
+        if (problem.width <= 0 || problem.height <= 0 || tile_size <= 0 || batch <= 0)
+            throw std::invalid_argument("sizes must be positive");
+    } catch (const std::logic_error& e) {
+        if (rank == 0) std::cerr << "Argument invalide : " << e.what() << std::endl;
+        MPI_Finalize();
+        return 1;
+    }
+    problem.view = View::fit(problem.width, problem.height);
+    if (rank == 0 && provided < MPI_THREAD_FUNNELED)
+        std::cerr << "Attention : MPI sans support des threads (MPI_THREAD_FUNNELED)" << std::endl;
+
+    std::vector<std::string> strategies;
+    if (strategy == "all")
+        strategies = {"block", "cyclic", "master"};
+    else
+        strategies = {strategy};
+
+    std::vector<float> reference;
+    if (check && rank == 0) {
+        reference.resize(std::size_t(problem.width) * problem.height);
+        compute_convergence(problem.set, problem.view, problem.precision, problem.width, problem.height,
+                            problem.smooth, reference.data());
+    }
+
+    if (rank == 0) {
+        std::printf("Image %dx%d, %d iterations, %d processus x %d threads, vecteurs %s\n", problem.width,
+                    problem.height, problem.set.max_iterations, nbp, omp_get_max_threads(), simd_name());
+        std::printf("Strategie | Temps (secondes) | Efficacite | Desequilibre (max/moyenne occupe) | Occupe par processus (s)\n");
+        std::printf("----------|------------------|------------|------------------------------------|-------------------------\n");
+    }
+    for (const auto& name : strategies) {
+        std::vector<Tile> tiles;
+        if (name == "master") {
+            tiles = make_tiles(problem.width, problem.height, tile_size);
+        } else {
+            for (int y = 0; y < problem.height; ++y) tiles.push_back({0, y, problem.width, 1});
+        }
+        Results results;
+        RankTimes times = name == "master" ? run_master_worker(problem, tiles, batch, results, globCom)
+                                           : run_static(problem, tiles, name == "cyclic", results, globCom);
+        std::vector<float> image;
+        gather_image(problem, tiles, results, image, globCom);
+
+        double mine[2] = {times.busy, times.wall};
+        std::vector<double> all(2 * nbp);
+        MPI_Gather(mine, 2, MPI_DOUBLE, all.data(), 2, MPI_DOUBLE, 0, globCom);
+        if (rank != 0) continue;
+
+        double busy_sum = 0., busy_max = 0., wall_max = 0.;
+        for (int p = 0; p < nbp; ++p) {
+            busy_sum += all[2 * p];
+            busy_max = std::max(busy_max, all[2 * p]);
+            wall_max = std::max(wall_max, all[2 * p + 1]);
+        }
+        std::printf("%-9s | %16.4f | %9.1f%% | %34.3f |", name.c_str(), wall_max, 100. * busy_sum / (nbp * wall_max),
+                    busy_max * nbp / busy_sum);
+        for (int p = 0; p < nbp; ++p) std::printf(" %.4f", all[2 * p]);
+        std::printf("\n");
+        if (check) {
+            double error = 0.;
+            for (std::size_t i = 0; i < image.size(); ++i)
+                error = std::max(error, double(std::fabs(image[i] - reference[i])));
+            std::printf("          ecart max avec le calcul sequentiel : %.2e\n", error);
+        }
+        if (!out_file.empty() && &name == &strategies.back()) {
+            std::vector<unsigned char> rgb(image.size() * 3);
+            apply_colormap(image.data(), image.size(), rgb.data());
+            try {
+                write_image(out_file, problem.width, problem.height, rgb.data());
+            } catch (const std::runtime_error& e) {
+                std::cerr << e.what() << std::endl;
+            }
+        }
+        std::fflush(stdout);
+    }
+
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,174 @@
+// Exploration de l'ensemble de Mandelbrot par tuiles : les tuiles d'un quadtree
+// (niveau, x, y, nombre d'itérations) déjà calculées sont gardées dans un cache
+// LRU en mémoire, éventuellement déversé sur disque, et réutilisées d'une image
+// à l'autre. On simule une exploration : translation de --pan pixels à chaque
+// image, zoom x2 toutes les --zoom-every images. Seules les tuiles nouvellement
+// découvertes sont calculées ; au zoom, un aperçu sur-échantillonné des tuiles
+// du niveau précédent est produit avant de calculer le nouveau niveau.
+//
+//   mandelbrot_tiles.exe [options]
+//     --size WxH               frame size (800x600)
+//     --max-iterations N       (200)
+//     --escape-radius R        (10)
+//     --center RE,IM           centre of the first frame (-0.7436,0.1318)
+//     --level L                quadtree level of the first frame (2)
+//     --frames N               (16)
+//     --pan DX,DY              translation in pixels between two frames (48,0)
+//     --zoom-every K           zoom in x2 every K frames, 0 for never (4)
+//     --tile N                 tiles of N x N pixels (64)
+//     --cache N                tiles kept in memory (1024)
+//     --spill dir              directory where the evicted tiles are written (none)
+//     --preview-depth D        levels above for the preview of new areas, 0 for none (2)
+//     --compare                also recompute every frame from scratch (time and max difference)
+//     --out-dir dir            frame_NNN.png and frame_NNN_apercu.png for every frame
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "image_io.hpp"
+#include "mandelbrot_engine.hpp"
+#include "tile_cache.hpp"
+
+namespace {
+double elapsed_since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void save(const std::string& filename, int width, int height, const float* values) {
+    std::vector<unsigned char> image(std::size_t(width) * height * 3);
+    apply_colormap(values, std::size_t(width) * height, image.data());
+    write_image(filename, width, height, image.data());
+}
+}  // namespace
+
+int main(int nargs, char* argv[]) {
+    int width = 800, height = 600;
+    MandelbrotSet mandelbrot_set{200, 10.};
+    double center_re = -0.7436, center_im = 0.1318;
+    int level = 2, frames = 16, pan_x = 48, pan_y = 0, zoom_every = 4;
+    int tile_size = 64, cache_tiles = 1024, preview_depth = 2;
+    bool compare = false;
+    std::string spill_directory, out_directory;
+    try {
+        for (int a = 1; a < nargs; ++a) {
+            std::string arg = argv[a];
+            bool has_value = a + 1 < nargs;
+            if (arg == "--size" && has_value) {
+                std::string value = argv[++a];
+                auto x = value.find('x');
+                width = std::stoi(value.substr(0, x));
+                height = std::stoi(value.substr(x + 1));
+            } else if (arg == "--max-iterations" && has_value) {
+                mandelbrot_set.max_iterations = std::stoi(argv[++a]);
+            } else if (arg == "--escape-radius" && has_value) {
+                mandelbrot_set.escape_radius = std::stod(argv[++a]);
+            } else if ((arg == "--center" || arg == "--pan") && has_value) {
+                std::stringstream values(argv[++a]);
+                char comma;
+                double first, second;
+                if (!(values >> first >> comma >> second)) throw std::invalid_argument(arg + " " + values.str());
+                if (arg == "--center") {
+                    center_re = first;
+                    center_im = second;
+                } else {
+                    pan_x = int(first);
+                    pan_y = int(second);
+                }
+            } else if (arg == "--level" && has_value) {
+                level = std::stoi(argv[++a]);
+            } else if (arg == "--frames" && has_value) {
+                frames = std::stoi(argv[++a]);
+            } else if (arg == "--zoom-every" && has_value) {
+                zoom_every = std::stoi(argv[++a]);
+            } else if (arg == "--tile" && has_value) {
+                tile_size = std::stoi(argv[++a]);
+            } else if (arg == "--cache" && has_value) {
+                cache_tiles = std::stoi(argv[++a]);
+            } else if (arg == "--spill" && has_value) {
+                spill_directory = argv[++a];
+            } else if (arg == "--preview-depth" && has_value) {
+                preview_depth = std::stoi(argv[++a]);
+            } else if (arg == "--compare") {
+                compare = true;
+            } else if (arg == "--out-dir" && has_value) {
+                out_directory = argv[++a];
+            } else {
+                throw std::invalid_argument(arg);
+            }
+        }
+    } catch (const std::logic_error& e) {
+        std::cerr << "Argument invalide : " << e.what() << std::endl;
+        return 1;
+    }
+    if (width <= 0 || height <= 0 || mandelbrot_set.max_iterations <= 0 || tile_size <= 0 || level < 0 ||
+        cache_tiles <= 0) {
+        std::cerr << "Taille d'image, de tuile, de cache et nombre d'iterations positifs attendus" << std::endl;
+        return 1;
+    }
+
+    TileCache cache(cache_tiles, {tile_size, mandelbrot_set.escape_radius, true}, spill_directory);
+    TileRenderer renderer(mandelbrot_set, cache, preview_depth);
+    Viewport viewport = Viewport::centered(level, tile_size, center_re, center_im, width, height);
+    std::vector<float> frame(std::size_t(width) * height), full(frame.size());
+
+    std::printf("Images %dx%d, tuiles %dx%d, cache de %d tuiles%s%s\n\n", width, height, tile_size, tile_size,
+                cache_tiles, spill_directory.empty() ? "" : ", deverse dans ", spill_directory.c_str());
+    std::printf("Image | Niveau | Tuiles | Memoire | Disque | Calculees | Succes | Apercu (s) | Temps (s) | "
+                "Economise (s)%s\n",
+                compare ? " | Complet (s) | Ecart max" : "");
+    std::printf("------|--------|--------|---------|--------|-----------|--------|------------|-----------|"
+                "--------------%s\n",
+                compare ? "|-------------|----------" : "");
+    FrameStats total;
+    double total_full = 0.;
+    char name[64];
+    for (int f = 0; f < frames; ++f) {
+        if (f > 0 && zoom_every > 0 && f % zoom_every == 0)
+            viewport = viewport.zoomed_in();
+        else if (f > 0)
+            viewport = viewport.panned(pan_x, pan_y);
+        std::fill(frame.begin(), frame.end(), 0.f);
+        FrameStats stats = renderer.render(viewport, frame.data(), [&](const float* preview) {
+            if (out_directory.empty()) return;
+            std::snprintf(name, sizeof(name), "/frame_%03d_apercu.png", f);
+            save(out_directory + name, width, height, preview);
+        });
+        if (!out_directory.empty()) {
+            std::snprintf(name, sizeof(name), "/frame_%03d.png", f);
+            save(out_directory + name, width, height, frame.data());
+        }
+        std::printf("%5d | %6d | %6d | %7d | %6d | %9d | %5.1f%% | %10.4f | %9.4f | %13.4f", f, viewport.level,
+                    stats.tiles, stats.memory_hits, stats.disk_hits, stats.computed, 100. * stats.hit_rate(),
+                    stats.preview_tiles ? stats.preview_time : 0., stats.total_time, stats.saved_time);
+        if (compare) {
+            auto start = std::chrono::high_resolution_clock::now();
+            compute_convergence(mandelbrot_set, viewport.view(tile_size), Precision::Double, width, height, true,
+                                full.data());
+            double t_full = elapsed_since(start);
+            total_full += t_full;
+            double error = 0.;
+            for (std::size_t i = 0; i < full.size(); ++i)
+                error = std::max(error, double(std::fabs(full[i] - frame[i])));
+            std::printf(" | %11.4f | %.2e", t_full, error);
+        }
+        std::printf("\n");
+        total.tiles += stats.tiles;
+        total.memory_hits += stats.memory_hits;
+        total.disk_hits += stats.disk_hits;
+        total.computed += stats.computed;
+        total.total_time += stats.total_time;
+        total.saved_time += stats.saved_time;
+    }
+    std::printf("\nTotal : %d tuiles, taux de succes %.1f%%, %d calculees (%.2e s par tuile), temps %.4f s, "
+                "economise %.4f s%s",
+                total.tiles, 100. * total.hit_rate(), total.computed, renderer.tile_time(), total.total_time,
+                total.saved_time, compare ? "" : "\n");
+    if (compare) std::printf(", recalcul complet %.4f s\n", total_full);
+    if (cache.spilled > 0) std::printf("Tuiles deversees sur disque : %lld\n", cache.spilled);
+    return 0;
+}
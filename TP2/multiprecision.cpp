@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <stdexcept>
+#include "multiprecision.hpp"
+
+bool BigFixed::is_zero() const {
+    for (auto limb : limbs)
+        if (limb != 0) return false;
+    return true;
+}
+
+int BigFixed::compare_magnitude(const BigFixed& a, const BigFixed& b) {
+    for (std::size_t k = a.limbs.size(); k-- > 0;) {
+        if (a.limbs[k] != b.limbs[k]) return a.limbs[k] < b.limbs[k] ? -1 : 1;
+    }
+    return 0;
+}
+
+void BigFixed::add_magnitude(const BigFixed& a, const BigFixed& b, BigFixed& out) {
+    std::uint64_t carry = 0;
+    for (std::size_t k = 0; k < a.limbs.size(); ++k) {
+        std::uint64_t sum = std::uint64_t(a.limbs[k]) + b.limbs[k] + carry;
+        out.limbs[k] = std::uint32_t(sum);
+        carry = sum >> 32;
+    }
+    if (carry) throw std::overflow_error("BigFixed overflow");
+}
+
+void BigFixed::sub_magnitude(const BigFixed& a, const BigFixed& b, BigFixed& out) {
+    std::int64_t borrow = 0;
+    for (std::size_t k = 0; k < a.limbs.size(); ++k) {
+        std::int64_t diff = std::int64_t(a.limbs[k]) - b.limbs[k] - borrow;
+        borrow = diff < 0 ? 1 : 0;
+        out.limbs[k] = std::uint32_t(diff + (borrow << 32));
+    }
+}
+
+BigFixed BigFixed::operator-() const {
+    BigFixed result = *this;
+    result.negative = !negative && !is_zero();
+    return result;
+}
+
+BigFixed operator+(const BigFixed& a, const BigFixed& b) {
+    BigFixed result(a.fraction_limbs());
+    if (a.negative == b.negative) {
+        BigFixed::add_magnitude(a, b, result);
+        result.negative = a.negative;
+    } else if (BigFixed::compare_magnitude(a, b) >= 0) {
+        BigFixed::sub_magnitude(a, b, result);
+        result.negative = a.negative;
+    } else {
+        BigFixed::sub_magnitude(b, a, result);
+        result.negative = b.negative;
+    }
+    if (result.is_zero()) result.negative = false;
+    return result;
+}
+
+BigFixed operator-(const BigFixed& a, const BigFixed& b) { return a + (-b); }
+
+BigFixed operator*(const BigFixed& a, const BigFixed& b) {
+    // Full product of the n+1 limbs numbers, then drop the n lowest limbs
+    const std::size_t n = a.limbs.size();
+    std::vector<std::uint32_t> product(2 * n, 0);
+    for (std::size_t i = 0; i < n; ++i) {
+        if (a.limbs[i] == 0) continue;
+        std::uint64_t carry = 0;
+        for (std::size_t j = 0; j < n; ++j) {
+            std::uint64_t t = std::uint64_t(a.limbs[i]) * b.limbs[j] + product[i + j] + carry;
+            product[i + j] = std::uint32_t(t);
+            carry = t >> 32;
+        }
+        product[i + n] = std::uint32_t(carry);
+    }
+    if (product[2 * n - 1] != 0) throw std::overflow_error("BigFixed overflow");
+    BigFixed result(int(n) - 1);
+    for (std::size_t k = 0; k < n; ++k) result.limbs[k] = product[k + n - 1];
+    result.negative = (a.negative != b.negative) && !result.is_zero();
+    return result;
+}
+
+BigFixed& BigFixed::mul_small(std::uint32_t factor) {
+    std::uint64_t carry = 0;
+    for (auto& limb : limbs) {
+        std::uint64_t t = std::uint64_t(limb) * factor + carry;
+        limb = std::uint32_t(t);
+        carry = t >> 32;
+    }
+    if (carry) throw std::overflow_error("BigFixed overflow");
+    if (is_zero()) negative = false;
+    return *this;
+}
+
+BigFixed& BigFixed::div_small(std::uint32_t divisor) {
+    std::uint64_t remainder = 0;
+    for (std::size_t k = limbs.size(); k-- > 0;) {
+        std::uint64_t t = (remainder << 32) | limbs[k];
+        limbs[k] = std::uint32_t(t / divisor);
+        remainder = t % divisor;
+    }
+    if (is_zero()) negative = false;
+    return *this;
+}
+
+BigFixed BigFixed::from_double(double value, int fraction_limbs) {
+    BigFixed result(fraction_limbs);
+    double magnitude = std::fabs(value);
+    if (!(magnitude < 4294967296.)) throw std::overflow_error("BigFixed overflow");
+    // A double has at most 53 significant bits : the loop is exact
+    double integer = std::floor(magnitude);
+    result.limbs.back() = std::uint32_t(integer);
+    double fraction = magnitude - integer;
+    for (int k = fraction_limbs - 1; k >= 0 && fraction > 0.; --k) {
+        fraction *= 4294967296.;
+        double limb = std::floor(fraction);
+        result.limbs[k] = std::uint32_t(limb);
+        fraction -= limb;
+    }
+    result.negative = value < 0 && !result.is_zero();
+    return result;
+}
+
+double BigFixed::to_double() const {
+    double value = 0.;
+    for (std::size_t k = 0; k < limbs.size(); ++k)
+        value += std::ldexp(double(limbs[k]), 32 * (int(k) - fraction_limbs()));
+    return negative ? -value : value;
+}
+
+BigFixed BigFixed::parse(const std::string& text, int fraction_limbs) {
+    std::size_t pos = 0;
+    bool negative = false;
+    if (pos < text.size() && (text[pos] == '-' || text[pos] == '+')) negative = text[pos++] == '-';
+    std::string integer_digits, fraction_digits;
+    while (pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos]))) integer_digits += text[pos++];
+    if (pos < text.size() && text[pos] == '.') {
+        ++pos;
+        while (pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos]))) fraction_digits += text[pos++];
+    }
+    long exponent = 0;
+    if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+        std::size_t used = 0;
+        try {
+            exponent = std::stol(text.substr(pos + 1), &used);
+        } catch (const std::logic_error&) {
+            throw std::invalid_argument("invalid number " + text);
+        }
+        pos += 1 + used;
+    }
+    if (pos != text.size() || (integer_digits.empty() && fraction_digits.empty()))
+        throw std::invalid_argument("invalid number " + text);
+
+    // Fraction by Horner from the last digit : x = (x + d) / 10
+    BigFixed fraction(fraction_limbs);
+    for (std::size_t k = fraction_digits.size(); k-- > 0;) {
+        fraction.limbs.back() += std::uint32_t(fraction_digits[k] - '0');
+        fraction.div_small(10);
+    }
+    BigFixed result(fraction_limbs);
+    try {
+        BigFixed integer(fraction_limbs);
+        for (char d : integer_digits) {
+            integer.mul_small(10);
+            integer = integer + from_double(d - '0', fraction_limbs);
+        }
+        result = integer + fraction;
+        // A non zero value overflows or vanishes after a few hundred steps at most,
+        // whatever the exponent
+        for (; exponent > 0 && !result.is_zero(); --exponent) result.mul_small(10);
+        for (; exponent < 0 && !result.is_zero(); ++exponent) result.div_small(10);
+    } catch (const std::overflow_error&) {
+        throw std::invalid_argument("number out of range " + text);
+    }
+    result.negative = negative && !result.is_zero();
+    return result;
+}
+
+int fraction_limbs_for(double resolution, int guard_bits) {
+    int bits = int(std::ceil(-std::log2(resolution))) + guard_bits;
+    return std::max(2, (bits + 31) / 32);
+}
@@ -0,0 +1,47 @@
+#ifndef _MULTIPRECISION_HPP_
+#define _MULTIPRECISION_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Fixed point real number of arbitrary precision : sign and magnitude, one
+// 32 bits limb for the integer part (|x| < 2^32) and `fraction_limbs` limbs of
+// 32 bits after the point. Operations truncate toward zero. Both operands of
+// an operation must have the same number of limbs.
+class BigFixed {
+public:
+    explicit BigFixed(int fraction_limbs = 2) : limbs(fraction_limbs + 1, 0) {}
+
+    // Decimal number such as "-1.25", "3e-5" or "0.1234567890123456789012345678901234567890".
+    // Throws std::invalid_argument if `text` is not a number or if |x| >= 2^32.
+    static BigFixed parse(const std::string& text, int fraction_limbs);
+    static BigFixed from_double(double value, int fraction_limbs);
+    double to_double() const;
+
+    int fraction_limbs() const { return int(limbs.size()) - 1; }
+
+    BigFixed operator-() const;
+    friend BigFixed operator+(const BigFixed& a, const BigFixed& b);
+    friend BigFixed operator-(const BigFixed& a, const BigFixed& b);
+    friend BigFixed operator*(const BigFixed& a, const BigFixed& b);
+
+    // Multiplication and division by a small integer
+    BigFixed& mul_small(std::uint32_t factor);
+    BigFixed& div_small(std::uint32_t divisor);
+
+private:
+    bool negative = false;
+    // Little endian : limbs[0] is the least significant, limbs.back() the integer part
+    std::vector<std::uint32_t> limbs;
+
+    bool is_zero() const;
+    static int compare_magnitude(const BigFixed& a, const BigFixed& b);
+    static void add_magnitude(const BigFixed& a, const BigFixed& b, BigFixed& out);
+    static void sub_magnitude(const BigFixed& a, const BigFixed& b, BigFixed& out);  // |a| >= |b|
+};
+
+// Number of fraction limbs to resolve details of size `resolution` with `guard_bits` spare bits
+int fraction_limbs_for(double resolution, int guard_bits = 64);
+
+#endif
@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <unordered_set>
+#include <omp.h>
+#include "tile_cache.hpp"
+
+namespace {
+std::int64_t floor_div(std::int64_t a, std::int64_t b) {
+    std::int64_t q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+double elapsed_since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Size in the complex plane of a tile of level `level`
+double tile_span(int level) { return std::ldexp(4., -level); }
+
+// First bytes of a spill file ("TIL2"), the files without the cost of the tile
+// being rejected
+const std::int32_t spill_magic = 0x324C4954;
+}  // namespace
+
+TileKey TileKey::ancestor(int depth) const {
+    return {level - depth, floor_div(x, std::int64_t(1) << depth), floor_div(y, std::int64_t(1) << depth),
+            max_iterations};
+}
+
+std::size_t TileKeyHash::operator()(const TileKey& key) const {
+    std::size_t h = std::hash<std::int64_t>()(key.x);
+    h ^= std::hash<std::int64_t>()(key.y) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    h ^= std::hash<int>()(key.level * 1000003 + key.max_iterations) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    return h;
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+TileCache::TileCache(std::size_t capacity, const Settings& settings, const std::string& spill_directory)
+    : capacity(std::max<std::size_t>(capacity, 1)), config(settings), spill_directory(spill_directory) {}
+
+TileCache::~TileCache() {
+    if (spill_directory.empty()) return;
+    for (const auto& entry : order) spill(entry);
+}
+
+const std::vector<float>* TileCache::peek(const TileKey& key) const {
+    auto found = index.find(key);
+    return found == index.end() ? nullptr : &found->second->values;
+}
+
+const std::vector<float>* TileCache::find(const TileKey& key, double* cost) {
+    auto found = index.find(key);
+    if (found != index.end()) {
+        order.splice(order.begin(), order, found->second);
+        ++memory_hits;
+        if (cost) *cost = order.front().cost;
+        return &order.front().values;
+    }
+    std::vector<float> values;
+    double loaded_cost = 0.;
+    if (!spill_directory.empty() && load(key, values, loaded_cost)) {
+        ++disk_hits;
+        insert(key, std::move(values), loaded_cost);
+        if (cost) *cost = loaded_cost;
+        return &order.front().values;
+    }
+    ++misses;
+    return nullptr;
+}
+
+void TileCache::insert(const TileKey& key, std::vector<float> values, double cost) {
+    auto found = index.find(key);
+    if (found != index.end()) {
+        found->second->values = std::move(values);
+        found->second->cost = cost;
+        order.splice(order.begin(), order, found->second);
+        return;
+    }
+    order.push_front({key, std::move(values), cost});
+    index[key] = order.begin();
+    while (order.size() > capacity) {
+        if (!spill_directory.empty()) spill(order.back());
+        index.erase(order.back().key);
+        order.pop_back();
+    }
+}
+
+std::string TileCache::spill_path(const TileKey& key) const {
+    char name[128];
+    std::snprintf(name, sizeof(name), "/tile_%d_%lld_%lld_%d.bin", key.level, (long long)key.x, (long long)key.y,
+                  key.max_iterations);
+    return spill_directory + name;
+}
+
+// File : magic, tile size, escape radius and smoothing of the settings, time it
+// took to compute the tile, then the values
+void TileCache::spill(const Entry& entry) {
+    std::string path = spill_path(entry.key);
+    std::ifstream exists(path, std::ios::binary);
+    std::int32_t magic = 0;
+    exists.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    if (exists && magic == spill_magic) return;  // tiles never change once computed
+    exists.close();
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return;   // the spill is only an optimisation
+    int smooth = config.smooth;
+    file.write(reinterpret_cast<const char*>(&spill_magic), sizeof(spill_magic));
+    file.write(reinterpret_cast<const char*>(&config.tile_size), sizeof(int));
+    file.write(reinterpret_cast<const char*>(&config.escape_radius), sizeof(double));
+    file.write(reinterpret_cast<const char*>(&smooth), sizeof(int));
+    file.write(reinterpret_cast<const char*>(&entry.cost), sizeof(double));
+    file.write(reinterpret_cast<const char*>(entry.values.data()), entry.values.size() * sizeof(float));
+    if (file) ++spilled;
+}
+
+bool TileCache::load(const TileKey& key, std::vector<float>& values, double& cost) const {
+    std::ifstream file(spill_path(key), std::ios::binary);
+    if (!file) return false;
+    std::int32_t magic = 0;
+    int tile_size = 0, smooth = 0;
+    double escape_radius = 0.;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    file.read(reinterpret_cast<char*>(&tile_size), sizeof(int));
+    file.read(reinterpret_cast<char*>(&escape_radius), sizeof(double));
+    file.read(reinterpret_cast<char*>(&smooth), sizeof(int));
+    file.read(reinterpret_cast<char*>(&cost), sizeof(double));
+    if (!file || magic != spill_magic || tile_size != config.tile_size || escape_radius != config.escape_radius ||
+        bool(smooth) != config.smooth)
+        return false;
+    values.resize(std::size_t(tile_size) * tile_size);
+    file.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(float));
+    return bool(file);
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+Viewport Viewport::centered(int level, int tile_size, double re, double im, int width, int height) {
+    const double pixel = tile_span(level) / tile_size;
+    return {level, std::llround((re + 2.) / pixel - 0.5 * width), std::llround((im + 2.) / pixel - 0.5 * height),
+            width, height};
+}
+
+Viewport Viewport::zoomed_in() const { return {level + 1, 2 * x0 + width / 2, 2 * y0 + height / 2, width, height}; }
+
+View Viewport::view(int tile_size) const {
+    const double pixel = tile_span(level) / tile_size;
+    return {-2. + x0 * pixel, -2. + y0 * pixel, pixel, pixel};
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+TileRenderer::TileRenderer(const MandelbrotSet& set, TileCache& cache, int preview_depth, int max_ancestor_depth)
+    : set(set), cache(cache), preview_depth(preview_depth), max_ancestor_depth(max_ancestor_depth) {}
+
+void TileRenderer::blit(const TileKey& source, const std::vector<float>& values, const TileKey& target,
+                        const Viewport& viewport, float* frame) const {
+    // Global pixels of the frame level covered by the target tile, inside the frame
+    const std::int64_t size = cache.settings().tile_size;
+    const std::int64_t x_begin = std::max(target.x * size, viewport.x0);
+    const std::int64_t x_end = std::min((target.x + 1) * size, viewport.x0 + viewport.width);
+    const std::int64_t y_begin = std::max(target.y * size, viewport.y0);
+    const std::int64_t y_end = std::min((target.y + 1) * size, viewport.y0 + viewport.height);
+    const int depth = viewport.level - source.level;  // >> is a floor division by 2^depth
+    for (std::int64_t gy = y_begin; gy < y_end; ++gy) {
+        float* out = frame + std::size_t(gy - viewport.y0) * viewport.width;
+        const float* in = values.data() + std::size_t((gy >> depth) - source.y * size) * size;
+        for (std::int64_t gx = x_begin; gx < x_end; ++gx) out[gx - viewport.x0] = in[(gx >> depth) - source.x * size];
+    }
+}
+
+std::vector<float> TileRenderer::compute(const TileKey& key) const {
+    const int size = cache.settings().tile_size;
+    const double pixel = tile_span(key.level) / size;
+    const View view{-2. + key.x * tile_span(key.level), -2. + key.y * tile_span(key.level), pixel, pixel};
+    MandelbrotSet tile_set = set;
+    tile_set.max_iterations = key.max_iterations;
+    std::vector<float> values(std::size_t(size) * size);
+    for (int y = 0; y < size; ++y)
+        convergence_row(tile_set, view, Precision::Double, y, 0, size, cache.settings().smooth,
+                        values.data() + std::size_t(y) * size);
+    return values;
+}
+
+// The tiles are shared among the threads. The cost of a tile is its share of the
+// wall time, in proportion to the time its thread spent on it.
+std::vector<std::vector<float>> TileRenderer::compute_missing(const std::vector<TileKey>& keys,
+                                                              std::vector<double>& costs) {
+    std::vector<std::vector<float>> values(keys.size());
+    costs.assign(keys.size(), 0.);
+    if (keys.empty()) return values;
+    auto start = std::chrono::high_resolution_clock::now();
+#pragma omp parallel for schedule(dynamic)
+    for (std::size_t k = 0; k < keys.size(); ++k) {
+        auto tile_start = std::chrono::high_resolution_clock::now();
+        values[k] = compute(keys[k]);
+        costs[k] = elapsed_since(tile_start);
+    }
+    const double wall = elapsed_since(start);
+    double busy = 0.;
+    for (double cost : costs) busy += cost;
+    if (busy > 0.)
+        for (double& cost : costs) cost *= wall / busy;
+    compute_time += wall;
+    tiles_computed += keys.size();
+    return values;
+}
+
+FrameStats TileRenderer::render(const Viewport& viewport, float* frame,
+                                const std::function<void(const float*)>& on_preview) {
+    auto start = std::chrono::high_resolution_clock::now();
+    FrameStats stats;
+    const int size = cache.settings().tile_size;
+    const std::int64_t tx_begin = floor_div(viewport.x0, size);
+    const std::int64_t tx_end = floor_div(viewport.x0 + viewport.width - 1, size) + 1;
+    const std::int64_t ty_begin = floor_div(viewport.y0, size);
+    const std::int64_t ty_end = floor_div(viewport.y0 + viewport.height - 1, size) + 1;
+
+    std::vector<TileKey> missing;
+    for (std::int64_t ty = ty_begin; ty < ty_end; ++ty) {
+        for (std::int64_t tx = tx_begin; tx < tx_end; ++tx) {
+            TileKey key{viewport.level, tx, ty, set.max_iterations};
+            long long disk_hits = cache.disk_hits;
+            double cost = 0.;
+            const std::vector<float>* values = cache.find(key, &cost);
+            ++stats.tiles;
+            if (!values) {
+                missing.push_back(key);
+                continue;
+            }
+            ++(cache.disk_hits > disk_hits ? stats.disk_hits : stats.memory_hits);
+            stats.saved_time += cost;
+            blit(key, *values, key, viewport, frame);
+        }
+    }
+
+    if (!missing.empty() && (preview_depth > 0 || max_ancestor_depth > 0)) {
+        // Nearest ancestor in memory, else the ancestor preview_depth levels above, computed once
+        std::vector<TileKey> sources(missing.size()), to_compute;
+        std::unordered_set<TileKey, TileKeyHash> planned;
+        for (std::size_t k = 0; k < missing.size(); ++k) {
+            sources[k].level = -1;
+            for (int depth = 1; depth <= std::min(max_ancestor_depth, viewport.level); ++depth) {
+                if (cache.peek(missing[k].ancestor(depth))) {
+                    sources[k] = missing[k].ancestor(depth);
+                    break;
+                }
+            }
+            if (sources[k].level < 0 && preview_depth > 0 && viewport.level >= preview_depth) {
+                sources[k] = missing[k].ancestor(preview_depth);
+                if (planned.insert(sources[k]).second) to_compute.push_back(sources[k]);
+            }
+        }
+        std::vector<double> costs;
+        auto computed = compute_missing(to_compute, costs);
+        for (std::size_t k = 0; k < to_compute.size(); ++k)
+            cache.insert(to_compute[k], std::move(computed[k]), costs[k]);
+        stats.preview_computed = int(to_compute.size());
+        for (std::size_t k = 0; k < missing.size(); ++k) {
+            if (sources[k].level < 0) continue;
+            const std::vector<float>* values = cache.peek(sources[k]);
+            if (!values) continue;  // evicted by the insertions of a too small cache
+            blit(sources[k], *values, missing[k], viewport, frame);
+            ++stats.preview_tiles;
+        }
+        stats.preview_time = elapsed_since(start);
+        if (on_preview && stats.preview_tiles > 0) on_preview(frame);
+    }
+
+    // Full resolution, blitted from the computed values before they may be evicted
+    std::vector<double> costs;
+    auto values = compute_missing(missing, costs);
+    for (std::size_t k = 0; k < missing.size(); ++k) {
+        blit(missing[k], values[k], missing[k], viewport, frame);
+        cache.insert(missing[k], std::move(values[k]), costs[k]);
+    }
+    stats.computed = int(missing.size());
+    stats.total_time = elapsed_since(start);
+    return stats;
+}
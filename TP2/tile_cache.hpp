@@ -0,0 +1,141 @@
+#ifndef _TILE_CACHE_HPP_
+#define _TILE_CACHE_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "mandelbrot_engine.hpp"
+
+// Tiles of a quadtree over the square [-2, 2] x [-2, 2] : at level L the square
+// is cut into 2^L x 2^L tiles of tile_size x tile_size pixels, tile (L, x, y)
+// covering [-2 + x s, -2 + (x+1) s] x [-2 + y s, -2 + (y+1) s] with s = 4 / 2^L.
+// Tile coordinates may lie outside of the square (views near its border).
+struct TileKey {
+    int level;
+    std::int64_t x, y;
+    int max_iterations;
+
+    bool operator==(const TileKey& other) const {
+        return level == other.level && x == other.x && y == other.y && max_iterations == other.max_iterations;
+    }
+    // Tile of level - depth containing this one
+    TileKey ancestor(int depth) const;
+};
+
+struct TileKeyHash {
+    std::size_t operator()(const TileKey& key) const;
+};
+
+// Convergence values of the tiles, least recently used first out. The tiles
+// evicted from memory are written to `spill_directory` (if not empty) and read
+// back on a later miss, also by a later run : a spill directory must hold tiles
+// of a single tile size, escape radius and smoothing (checked in the file header).
+// Every tile keeps the time it took to compute, spilled with it, so that a hit
+// is worth that time even in a run which computed no tile.
+class TileCache {
+public:
+    struct Settings {
+        int tile_size;
+        double escape_radius;
+        bool smooth;
+    };
+
+    TileCache(std::size_t capacity, const Settings& settings, const std::string& spill_directory = "");
+    // The tiles still in memory are spilled too, for the next runs
+    ~TileCache();
+    TileCache(const TileCache&) = delete;
+    TileCache& operator=(const TileCache&) = delete;
+
+    // Values of the tile, looked up in memory then on disk (promoted to memory),
+    // nullptr on a miss. The pointer is valid until the next insertion. `cost`
+    // receives the time it took to compute the tile.
+    const std::vector<float>* find(const TileKey& key, double* cost = nullptr);
+    // Memory only, statistics and order left unchanged
+    const std::vector<float>* peek(const TileKey& key) const;
+    void insert(const TileKey& key, std::vector<float> values, double cost = 0.);
+
+    std::size_t size() const { return order.size(); }
+    const Settings& settings() const { return config; }
+
+    long long memory_hits = 0, disk_hits = 0, misses = 0, spilled = 0;
+
+private:
+    struct Entry {
+        TileKey key;
+        std::vector<float> values;
+        double cost;
+    };
+    std::string spill_path(const TileKey& key) const;
+    bool load(const TileKey& key, std::vector<float>& values, double& cost) const;
+    void spill(const Entry& entry);
+
+    std::size_t capacity;
+    Settings config;
+    std::string spill_directory;
+    std::list<Entry> order;  // most recently used first
+    std::unordered_map<TileKey, std::list<Entry>::iterator, TileKeyHash> index;
+};
+
+// Frame of width x height pixels of level `level`, its corner being the global
+// pixel (x0, y0) of that level (pixel x covers [-2 + x p, -2 + (x+1) p], p = 4 / (2^L tile_size))
+struct Viewport {
+    int level;
+    std::int64_t x0, y0;
+    int width, height;
+
+    // Frame centred on (re, im)
+    static Viewport centered(int level, int tile_size, double re, double im, int width, int height);
+    Viewport panned(int dx, int dy) const { return {level, x0 + dx, y0 + dy, width, height}; }
+    // Twice the resolution around the same centre
+    Viewport zoomed_in() const;
+    // Same region of the complex plane as a View of mandelbrot_engine.hpp
+    View view(int tile_size) const;
+};
+
+struct FrameStats {
+    int tiles = 0, memory_hits = 0, disk_hits = 0, computed = 0;
+    int preview_tiles = 0;      // missing tiles shown upsampled from an ancestor
+    int preview_computed = 0;   // ancestors computed for the preview
+    double preview_time = 0.;   // until the preview is complete
+    double total_time = 0.;
+    double saved_time = 0.;     // time it took to compute the tiles found in the cache
+
+    double hit_rate() const { return tiles ? double(memory_hits + disk_hits) / tiles : 0.; }
+};
+
+// Renders viewports from the tiles of the cache, the missing tiles being computed
+// by the OpenMP threads. Before computing them, the frame is filled with the
+// cached tiles and, for the missing ones, with the nearest cached ancestor
+// (up to max_ancestor_depth levels above) or else an ancestor `preview_depth`
+// levels above, computed first at 1/4^preview_depth of the cost : this preview is
+// passed to the callback, then the missing tiles are computed at full resolution.
+class TileRenderer {
+public:
+    TileRenderer(const MandelbrotSet& set, TileCache& cache, int preview_depth = 2, int max_ancestor_depth = 6);
+
+    FrameStats render(const Viewport& viewport, float* frame,
+                      const std::function<void(const float*)>& on_preview = nullptr);
+
+    // Mean wall time of the computation of one tile in this run
+    double tile_time() const { return tiles_computed ? compute_time / tiles_computed : 0.; }
+
+private:
+    std::vector<float> compute(const TileKey& key) const;
+    // `costs` receives the share of the wall time of each tile
+    std::vector<std::vector<float>> compute_missing(const std::vector<TileKey>& keys, std::vector<double>& costs);
+    // Copies into the frame the part of tile `target` (of the frame level) inside the frame,
+    // taken from tile `source` : the same tile or one of its ancestors, upsampled
+    void blit(const TileKey& source, const std::vector<float>& values, const TileKey& target,
+              const Viewport& viewport, float* frame) const;
+
+    MandelbrotSet set;
+    TileCache& cache;
+    int preview_depth, max_ancestor_depth;
+    double compute_time = 0.;
+    long long tiles_computed = 0;
+};
+
+#endif
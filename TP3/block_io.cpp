@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "block_io.hpp"
+
+namespace {
+// pread/pwrite until the whole range is done
+void read_all(int fd, std::uint64_t* keys, std::size_t n, std::uint64_t offset, const std::string& filename) {
+    char* data = reinterpret_cast<char*>(keys);
+    std::size_t bytes = 8 * n, done = 0;
+    while (done < bytes) {
+        ssize_t r = pread(fd, data + done, bytes - done, off_t(8 * offset + done));
+        if (r <= 0) throw std::runtime_error("Erreur de lecture de " + filename);
+        done += std::size_t(r);
+    }
+}
+
+void write_all(int fd, const std::uint64_t* keys, std::size_t n, std::uint64_t offset, const std::string& filename) {
+    const char* data = reinterpret_cast<const char*>(keys);
+    std::size_t bytes = 8 * n, done = 0;
+    while (done < bytes) {
+        ssize_t w = pwrite(fd, data + done, bytes - done, off_t(8 * offset + done));
+        if (w <= 0) throw std::runtime_error("Erreur d'ecriture de " + filename);
+        done += std::size_t(w);
+    }
+}
+}  // namespace
+
+BlockReader::BlockReader(const std::string& filename, std::uint64_t first, std::uint64_t count,
+                         std::size_t block_keys)
+    : filename(filename), position(first), end(first + count), block(std::max<std::size_t>(block_keys, 1)) {
+    fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Impossible d'ouvrir " + filename);
+    posix_fadvise(fd, off_t(8 * first), off_t(8 * count), POSIX_FADV_SEQUENTIAL);
+    current.reserve(block);
+    ahead.reserve(block);
+    start_read();
+}
+
+BlockReader::~BlockReader() {
+    if (pending.valid()) pending.wait();
+    close(fd);
+}
+
+void BlockReader::start_read() {
+    const std::size_t n = std::size_t(std::min<std::uint64_t>(block, end - position));
+    ahead.resize(n);
+    const std::uint64_t offset = position;
+    position += n;
+    pending = std::async(std::launch::async, [this, n, offset] {
+        read_all(fd, ahead.data(), n, offset, filename);
+        return n;
+    });
+}
+
+std::size_t BlockReader::next(const std::uint64_t*& keys) {
+    const std::size_t n = pending.get();  // rethrows the errors of the read
+    if (n == 0) {
+        keys = nullptr;
+        return 0;
+    }
+    current.swap(ahead);
+    read_keys += n;
+    start_read();  // the following block while the caller uses this one
+    keys = current.data();
+    return n;
+}
+
+BlockWriter::BlockWriter(const std::string& filename, std::uint64_t first, std::size_t block_keys, bool truncate)
+    : filename(filename), position(first), block(std::max<std::size_t>(block_keys, 1)) {
+    fd = open(filename.c_str(), O_WRONLY | O_CREAT | (truncate ? O_TRUNC : 0), 0644);
+    if (fd < 0) throw std::runtime_error("Impossible de creer " + filename);
+    current.reserve(block);
+    in_flight.reserve(block);
+}
+
+BlockWriter::~BlockWriter() {
+    if (pending.valid()) pending.wait();
+    ::close(fd);
+}
+
+void BlockWriter::write(const std::uint64_t* keys, std::size_t n) {
+    while (n > 0) {
+        std::size_t m = std::min(n, block - current.size());
+        current.insert(current.end(), keys, keys + m);
+        keys += m;
+        n -= m;
+        if (current.size() == block) flush_block();
+    }
+}
+
+void BlockWriter::flush_block() {
+    if (pending.valid()) pending.get();  // the previous block is written : its buffer is free
+    in_flight.swap(current);
+    current.clear();
+    const std::uint64_t offset = position;
+    position += in_flight.size();
+    written_keys += in_flight.size();
+    pending = std::async(std::launch::async,
+                         [this, offset] { write_all(fd, in_flight.data(), in_flight.size(), offset, filename); });
+}
+
+void BlockWriter::close() {
+    if (!current.empty()) flush_block();
+    if (pending.valid()) pending.get();
+}
+
+void write_keys(const std::string& filename, const std::uint64_t* keys, std::size_t n) {
+    int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) throw std::runtime_error("Impossible de creer " + filename);
+    try {
+        write_all(fd, keys, n, 0, filename);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+}
+
+std::uint64_t key_count(const std::string& filename) {
+    struct stat info;
+    if (stat(filename.c_str(), &info) != 0) throw std::runtime_error("Impossible d'ouvrir " + filename);
+    return std::uint64_t(info.st_size) / 8;
+}
@@ -0,0 +1,75 @@
+#ifndef _BLOCK_IO_HPP_
+#define _BLOCK_IO_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+// Streaming I/O of 64 bits keys by blocks, double buffered : the next block is
+// read (or the previous one written) by an asynchronous task while the caller
+// works on the current one. Errors throw std::runtime_error.
+
+// Keys [first, first + count) of a binary file of native 64 bits keys
+class BlockReader {
+public:
+    BlockReader(const std::string& filename, std::uint64_t first, std::uint64_t count, std::size_t block_keys);
+    ~BlockReader();
+    BlockReader(const BlockReader&) = delete;
+    BlockReader& operator=(const BlockReader&) = delete;
+
+    // Next block (nullptr and 0 at the end), valid until the next call
+    std::size_t next(const std::uint64_t*& keys);
+
+    std::uint64_t bytes_read() const { return 8 * read_keys; }
+
+private:
+    void start_read();
+
+    int fd;
+    std::string filename;
+    std::uint64_t position, end;
+    std::size_t block;
+    std::vector<std::uint64_t> current, ahead;
+    std::future<std::size_t> pending;
+    std::uint64_t read_keys = 0;
+};
+
+// Keys written one after the other from key `first` of the file (created if needed)
+class BlockWriter {
+public:
+    BlockWriter(const std::string& filename, std::uint64_t first, std::size_t block_keys, bool truncate = false);
+    ~BlockWriter();
+    BlockWriter(const BlockWriter&) = delete;
+    BlockWriter& operator=(const BlockWriter&) = delete;
+
+    void push(std::uint64_t key) {
+        current.push_back(key);
+        if (current.size() == block) flush_block();
+    }
+    void write(const std::uint64_t* keys, std::size_t n);
+    // Writes the remaining keys and waits for the end of the writes
+    void close();
+
+    std::uint64_t bytes_written() const { return 8 * written_keys; }
+
+private:
+    void flush_block();
+
+    int fd;
+    std::string filename;
+    std::uint64_t position;
+    std::size_t block;
+    std::vector<std::uint64_t> current, in_flight;
+    std::future<void> pending;
+    std::uint64_t written_keys = 0;
+};
+
+// Whole file of n keys at once
+void write_keys(const std::string& filename, const std::uint64_t* keys, std::size_t n);
+
+// Number of keys of a file of keys
+std::uint64_t key_count(const std::string& filename);
+
+#endif
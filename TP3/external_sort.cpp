@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <cstdio>
+#include <fcntl.h>
+#include <memory>
+#include <stdexcept>
+#include <unistd.h>
+#include "block_io.hpp"
+#include "external_sort.hpp"
+#include "radix_sort.hpp"
+
+namespace {
+// Smallest read block of a run during the merge (256 KiB) : bounds the number of runs merged at once
+const std::size_t MIN_MERGE_BLOCK = std::size_t(1) << 15;
+
+struct Run {
+    std::string filename;
+    std::uint64_t keys;
+};
+
+// Slice [first, first + count) of the input for process rank
+void input_slice(std::uint64_t n, int rank, int nbp, std::uint64_t& first, std::uint64_t& count) {
+    count = n / nbp + (std::uint64_t(rank) < n % nbp ? 1 : 0);
+    first = rank * (n / nbp) + std::min<std::uint64_t>(rank, n % nbp);
+}
+
+// Samples at regularly spaced positions of the (unsorted) slice : its keys and
+// their position in the file, which breaks the ties
+std::vector<Sample> read_samples(const std::string& filename, std::uint64_t first, std::uint64_t count, int rank,
+                                 int oversampling) {
+    const std::uint64_t s = std::min<std::uint64_t>(oversampling, count);
+    std::vector<Sample> samples(s);
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Impossible d'ouvrir " + filename);
+    for (std::uint64_t j = 0; j < s; ++j) {
+        const std::uint64_t position = first + (2 * j + 1) * count / (2 * s);
+        std::uint64_t key;
+        if (pread(fd, &key, 8, off_t(8 * position)) != 8) {
+            close(fd);
+            throw std::runtime_error("Erreur de lecture de " + filename);
+        }
+        samples[j] = {key, std::uint64_t(rank), position};
+    }
+    close(fd);
+    return samples;
+}
+
+// Merge of the runs by a tree of losers : the leaves are the runs, every inner
+// node keeps the loser of the match between its two subtrees and tree[0] the
+// overall winner. After the winner's run advances, only its path to the root is
+// replayed : log2(k) comparisons per key.
+class LoserTree {
+public:
+    LoserTree(const std::vector<Run>& runs, std::size_t block_keys) : k(int(runs.size())), tree(runs.size(), -1) {
+        for (const auto& run : runs) {
+            cursors.emplace_back();
+            cursors.back().reader.reset(new BlockReader(run.filename, 0, run.keys, block_keys));
+            cursors.back().advance();
+        }
+        for (int leaf = 0; leaf < k; ++leaf) {
+            int winner = leaf;
+            for (int node = (leaf + k) / 2; node > 0; node /= 2) {
+                if (tree[node] < 0) {  // first arrived : waits for the other subtree
+                    tree[node] = winner;
+                    winner = -1;
+                    break;
+                }
+                if (less(tree[node], winner)) std::swap(tree[node], winner);
+            }
+            if (winner >= 0) tree[0] = winner;
+        }
+    }
+
+    bool empty() const { return k == 0 || cursors[tree[0]].done; }
+    std::uint64_t top() const { return cursors[tree[0]].key(); }
+    void pop() {
+        int winner = tree[0];
+        cursors[winner].advance();
+        for (int node = (winner + k) / 2; node > 0; node /= 2)
+            if (less(tree[node], winner)) std::swap(tree[node], winner);
+        tree[0] = winner;
+    }
+    std::uint64_t bytes_read() const {
+        std::uint64_t bytes = 0;
+        for (const auto& c : cursors) bytes += c.reader->bytes_read();
+        return bytes;
+    }
+
+private:
+    struct Cursor {
+        std::unique_ptr<BlockReader> reader;
+        const std::uint64_t* keys = nullptr;
+        std::size_t n = 0, i = 0;
+        bool done = false;
+        std::uint64_t key() const { return keys[i]; }
+        void advance() {
+            if (n > 0 && ++i < n) return;
+            n = reader->next(keys);
+            i = 0;
+            done = n == 0;
+        }
+    };
+    // An exhausted run loses against all the others
+    bool less(int a, int b) const {
+        if (cursors[a].done || cursors[b].done) return !cursors[a].done && cursors[b].done;
+        return cursors[a].key() < cursors[b].key() || (cursors[a].key() == cursors[b].key() && a < b);
+    }
+
+    int k;
+    std::vector<int> tree;
+    std::vector<Cursor> cursors;
+};
+
+void merge_runs(const std::vector<Run>& runs, BlockWriter& out, std::size_t block_keys, std::uint64_t& bytes_read) {
+    LoserTree tree(runs, block_keys);
+    while (!tree.empty()) {
+        out.push(tree.top());
+        tree.pop();
+    }
+    out.close();
+    bytes_read += tree.bytes_read();
+}
+}  // namespace
+
+ExternalStats external_sort(const ExternalOptions& options, MPI_Comm comm) {
+    int rank, nbp;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nbp);
+    ExternalStats stats;
+    double start = MPI_Wtime(), t = start;
+    auto lap = [&t](double& phase) {
+        double now = MPI_Wtime();
+        phase = now - t;
+        t = now;
+    };
+
+    // Memory : run buffer and radix scratch of memory / 2 keys each ; a round
+    // receives at most nbp blocks, which must fit in the run buffer
+    const std::size_t run_capacity = std::max<std::size_t>(options.memory_keys / 2, 2 * nbp);
+    const std::size_t block = std::max<std::size_t>(1, std::min(options.block_keys, run_capacity / (2 * nbp)));
+
+    std::uint64_t first, count;
+    input_slice(key_count(options.input), rank, nbp, first, count);
+    const int oversampling = options.oversampling > 0 ? options.oversampling : std::max(nbp, DEFAULT_OVERSAMPLING);
+    std::vector<Sample> splitters =
+        choose_splitters(read_samples(options.input, first, count, rank, oversampling), count, comm);
+    lap(stats.splitters);
+
+    // Distribution by rounds of one block per process
+    std::uint64_t rounds = (count + block - 1) / block;
+    MPI_Allreduce(MPI_IN_PLACE, &rounds, 1, MPI_UINT64_T, MPI_MAX, comm);
+    BlockReader reader(options.input, first, count, block);
+    std::vector<std::uint64_t> run, scratch, send(block), received;
+    run.reserve(run_capacity);
+    scratch.resize(run_capacity);
+    std::vector<Run> runs;
+    std::future<void> run_write;
+    auto flush_run = [&] {
+        if (run.empty()) return;
+        if (run_write.valid()) run_write.get();  // scratch is free again
+        // After a swap scratch has the size of the previous run : radix_sort writes
+        // run.size() keys into it (the capacity is kept, no reallocation)
+        scratch.resize(run.size());
+        radix_sort(run.data(), run.size(), scratch.data());
+        char name[64];
+        std::snprintf(name, sizeof(name), "/run_%d_%zu.bin", rank, runs.size());
+        runs.push_back({options.temp_directory + name, run.size()});
+        // The sorted run is written from scratch while the next one fills `run`
+        scratch.swap(run);
+        stats.run_bytes += 8 * scratch.size();
+        run_write = std::async(std::launch::async, [&scratch, filename = runs.back().filename] {
+            write_keys(filename, scratch.data(), scratch.size());
+        });
+        run.clear();
+        run.reserve(run_capacity);
+    };
+    std::vector<int> send_counts(nbp), send_displs(nbp), recv_counts(nbp), recv_displs(nbp);
+    std::vector<int> destination(block);
+    std::uint64_t position = first;
+    for (std::uint64_t round = 0; round < rounds; ++round) {
+        const std::uint64_t* keys = nullptr;
+        const std::size_t n = reader.next(keys);
+        stats.input_digest.add(keys, n);
+#pragma omp parallel for
+        for (std::size_t i = 0; i < n; ++i)
+            destination[i] = int(std::upper_bound(splitters.begin(), splitters.end(),
+                                                  Sample{keys[i], std::uint64_t(rank), position + i}) -
+                                 splitters.begin());
+        position += n;
+        std::fill(send_counts.begin(), send_counts.end(), 0);
+        for (std::size_t i = 0; i < n; ++i) ++send_counts[destination[i]];
+        for (int d = 1; d < nbp; ++d) send_displs[d] = send_displs[d - 1] + send_counts[d - 1];
+        std::vector<int> fill = send_displs;
+        for (std::size_t i = 0; i < n; ++i) send[fill[destination[i]]++] = keys[i];
+
+        MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, comm);
+        for (int r = 1; r < nbp; ++r) recv_displs[r] = recv_displs[r - 1] + recv_counts[r - 1];
+        const std::size_t incoming = std::size_t(recv_displs[nbp - 1]) + recv_counts[nbp - 1];
+        if (run.size() + incoming > run_capacity) flush_run();
+        const std::size_t offset = run.size();
+        run.resize(offset + incoming);
+        MPI_Alltoallv(send.data(), send_counts.data(), send_displs.data(), MPI_UINT64_T, run.data() + offset,
+                      recv_counts.data(), recv_displs.data(), MPI_UINT64_T, comm);
+    }
+    flush_run();
+    if (run_write.valid()) run_write.get();
+    stats.input_bytes = reader.bytes_read();
+    stats.runs = int(runs.size());
+    for (const auto& r : runs) stats.keys += r.keys;
+    std::vector<std::uint64_t>().swap(run);
+    std::vector<std::uint64_t>().swap(scratch);
+    lap(stats.distribute);
+
+    // Place of the keys of this process in the output, created at its final size by process 0
+    MPI_Exscan(&stats.keys, &stats.first, 1, MPI_UINT64_T, MPI_SUM, comm);
+    if (rank == 0) stats.first = 0;
+    if (rank == 0) {
+        int fd = open(options.output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || ftruncate(fd, off_t(8 * key_count(options.input))) != 0)
+            throw std::runtime_error("Impossible de creer " + options.output);
+        close(fd);
+    }
+    MPI_Barrier(comm);
+
+    // Merge : each run read and the output need two blocks in memory
+    const std::size_t fan_in = std::max<std::size_t>(2, options.memory_keys / (2 * MIN_MERGE_BLOCK) - 1);
+    auto merge_block = [&](std::size_t inputs) {
+        return std::max(MIN_MERGE_BLOCK, std::min(options.block_keys, options.memory_keys / (2 * (inputs + 1))));
+    };
+    int created = 0;
+    while (runs.size() > fan_in) {
+        std::vector<Run> merged;
+        for (std::size_t begin = 0; begin < runs.size(); begin += fan_in) {
+            std::vector<Run> group(runs.begin() + begin, runs.begin() + std::min(runs.size(), begin + fan_in));
+            if (group.size() == 1) {
+                merged.push_back(group[0]);
+                continue;
+            }
+            char name[64];
+            std::snprintf(name, sizeof(name), "/merge_%d_%d.bin", rank, created++);
+            Run out{options.temp_directory + name, 0};
+            for (const auto& r : group) out.keys += r.keys;
+            BlockWriter writer(out.filename, 0, merge_block(group.size()), true);
+            merge_runs(group, writer, merge_block(group.size()), stats.merge_read);
+            stats.merge_written += writer.bytes_written();
+            for (const auto& r : group) std::remove(r.filename.c_str());
+            merged.push_back(out);
+        }
+        runs.swap(merged);
+        ++stats.merge_passes;
+    }
+    BlockWriter writer(options.output, stats.first, merge_block(runs.size()));
+    merge_runs(runs, writer, merge_block(runs.size()), stats.merge_read);
+    stats.merge_written += writer.bytes_written();
+    ++stats.merge_passes;
+    for (const auto& r : runs) std::remove(r.filename.c_str());
+    lap(stats.merge);
+    stats.total = t - start;
+    return stats;
+}
+
+bool verify_sorted_file(const std::string& filename, std::uint64_t first, std::uint64_t count,
+                        const KeyDigest& before, std::size_t block_keys, MPI_Comm comm) {
+    BlockReader reader(filename, first, count, block_keys);
+    KeyDigest digest;
+    bool sorted = true;
+    std::uint64_t smallest = 0, previous = 0;
+    const std::uint64_t* keys;
+    for (std::size_t n; (n = reader.next(keys)) > 0;) {
+        if (digest.count == 0) smallest = previous = keys[0];
+        sorted = sorted && keys[0] >= previous && std::is_sorted(keys, keys + n);
+        previous = keys[n - 1];
+        digest.add(keys, n);
+    }
+    return verify_sorted(sorted, count == 0, smallest, previous, digest, before, comm);
+}
@@ -0,0 +1,48 @@
+#ifndef _EXTERNAL_SORT_HPP_
+#define _EXTERNAL_SORT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <mpi.h>
+#include "sample_sort.hpp"
+
+// Sort of a file of 64 bits keys larger than the memory of the processes :
+//   1. splitters chosen as in sample_sort from keys read at regularly spaced
+//      positions of the slice of the file of every process,
+//   2. distribution : every process streams its slice by blocks, sends each key
+//      to the process of its bucket (MPI_Alltoallv by rounds of one block) and
+//      gathers the keys received in a run buffer, which is sorted by radix_sort
+//      and written to a temporary file (sorted run) when full,
+//   3. merge : the runs of a process are merged by a loser tree (in several
+//      passes if they are more than the memory allows to read at once) and
+//      written to the output file after the keys of the lower ranks.
+// All the reads and writes are double buffered (block_io.hpp), the run writes
+// overlapping the reception of the next run.
+struct ExternalOptions {
+    std::string input, output;
+    std::string temp_directory = ".";          // sorted runs, deleted after the merge
+    std::size_t memory_keys = std::size_t(1) << 25;  // keys held in memory by a process
+    std::size_t block_keys = std::size_t(1) << 20;   // I/O block and keys read per exchange round
+    int oversampling = 0;                      // samples per process (see sample_sort)
+};
+
+struct ExternalStats {
+    double splitters = 0., distribute = 0., merge = 0., total = 0.;
+    std::uint64_t input_bytes = 0, run_bytes = 0;       // distribution : read, written
+    std::uint64_t merge_read = 0, merge_written = 0;    // merge, all the passes
+    std::uint64_t keys = 0;                             // keys of this process in the output
+    std::uint64_t first = 0;                            // index of its first key in the output
+    int runs = 0, merge_passes = 0;
+    KeyDigest input_digest;                             // of the keys read by this process
+};
+
+// Collective over `comm`. Throws std::runtime_error on I/O errors.
+ExternalStats external_sort(const ExternalOptions& options, MPI_Comm comm);
+
+// Collective : checks keys [first, first + count) of the output of every process
+// as verify_sorted does, against the digest of the whole input
+bool verify_sorted_file(const std::string& filename, std::uint64_t first, std::uint64_t count,
+                        const KeyDigest& before, std::size_t block_keys, MPI_Comm comm);
+
+#endif
@@ -0,0 +1,66 @@
+#include <algorithm>
+#include <array>
+#include <omp.h>
+#include "radix_sort.hpp"
+
+namespace {
+const int RADIX = 256;
+// Below this size a single thread sorts
+const std::size_t PARALLEL_THRESHOLD = 1 << 16;
+}  // namespace
+
+void radix_sort(std::uint64_t* keys, std::size_t n, std::uint64_t* buffer) {
+    if (n < 2) return;
+    const int nthreads = n < PARALLEL_THRESHOLD ? 1 : omp_get_max_threads();
+
+    // Bits that differ between the keys : the other bytes need no pass
+    std::uint64_t all_or = 0, all_and = ~std::uint64_t(0);
+#pragma omp parallel for num_threads(nthreads) reduction(| : all_or) reduction(& : all_and)
+    for (std::size_t i = 0; i < n; ++i) {
+        all_or |= keys[i];
+        all_and &= keys[i];
+    }
+    const std::uint64_t varying = all_or ^ all_and;
+
+    std::vector<std::array<std::size_t, RADIX>> offsets(nthreads);
+    std::uint64_t* src = keys;
+    std::uint64_t* dst = buffer;
+    for (int shift = 0; shift < 64; shift += 8) {
+        if (((varying >> shift) & 0xFF) == 0) continue;
+#pragma omp parallel num_threads(nthreads)
+        {
+            const int t = omp_get_thread_num();
+            const std::size_t begin = n * t / nthreads, end = n * (t + 1) / nthreads;
+            auto& count = offsets[t];
+            count.fill(0);
+            for (std::size_t i = begin; i < end; ++i) ++count[(src[i] >> shift) & 0xFF];
+#pragma omp barrier
+#pragma omp single
+            {
+                // Keys of byte d of thread t go after those of smaller bytes and of byte d of threads < t
+                std::size_t position = 0;
+                for (int d = 0; d < RADIX; ++d) {
+                    for (int u = 0; u < nthreads; ++u) {
+                        std::size_t c = offsets[u][d];
+                        offsets[u][d] = position;
+                        position += c;
+                    }
+                }
+            }
+            for (std::size_t i = begin; i < end; ++i) {
+                const std::uint64_t key = src[i];
+                dst[count[(key >> shift) & 0xFF]++] = key;
+            }
+        }
+        std::swap(src, dst);
+    }
+    if (src != keys) {
+#pragma omp parallel for num_threads(nthreads)
+        for (std::size_t i = 0; i < n; ++i) keys[i] = src[i];
+    }
+}
+
+void radix_sort(std::vector<std::uint64_t>& keys) {
+    std::vector<std::uint64_t> buffer(keys.size());
+    radix_sort(keys.data(), keys.size(), buffer.data());
+}
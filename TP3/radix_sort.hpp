@@ -0,0 +1,16 @@
+#ifndef _RADIX_SORT_HPP_
+#define _RADIX_SORT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// LSD radix sort of 64 bits keys, one byte per pass, the passes shared among
+// the OpenMP threads (histogram of its part of the array by every thread,
+// prefix sum over (byte, thread), then every thread scatters its part). The
+// bytes that are the same for all the keys are skipped : keys in [0, 500) take
+// two passes. `buffer` must hold n keys ; the result is in `keys`.
+void radix_sort(std::uint64_t* keys, std::size_t n, std::uint64_t* buffer);
+void radix_sort(std::vector<std::uint64_t>& keys);
+
+#endif
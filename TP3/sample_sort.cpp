@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <climits>
+#include <numeric>
+#include "radix_sort.hpp"
+#include "sample_sort.hpp"
+
+namespace {
+// Largest number of keys sent to a process by one MPI_Alltoallv call when the
+// counts do not fit in an int
+const std::size_t EXCHANGE_CHUNK = std::size_t(1) << 26;
+
+
+// Number of local keys (of process `rank`) ordered before `splitter`
+std::size_t keys_before(const std::vector<std::uint64_t>& sorted, int rank, const Sample& splitter) {
+    if (std::uint64_t(rank) < splitter.rank)
+        return std::upper_bound(sorted.begin(), sorted.end(), splitter.key) - sorted.begin();
+    if (std::uint64_t(rank) > splitter.rank)
+        return std::lower_bound(sorted.begin(), sorted.end(), splitter.key) - sorted.begin();
+    return splitter.index;
+}
+
+// Buckets of `sorted` (bounds[d] .. bounds[d+1] to process d) exchanged ; the
+// received keys are stored by origin
+std::vector<std::uint64_t> exchange_buckets(const std::vector<std::uint64_t>& sorted,
+                                            const std::vector<std::size_t>& bounds, MPI_Comm comm) {
+    int nbp;
+    MPI_Comm_size(comm, &nbp);
+    std::vector<std::uint64_t> send_counts(nbp), recv_counts(nbp);
+    for (int d = 0; d < nbp; ++d) send_counts[d] = bounds[d + 1] - bounds[d];
+    MPI_Alltoall(send_counts.data(), 1, MPI_UINT64_T, recv_counts.data(), 1, MPI_UINT64_T, comm);
+    std::vector<std::size_t> recv_offsets(nbp + 1, 0);
+    for (int r = 0; r < nbp; ++r) recv_offsets[r + 1] = recv_offsets[r] + recv_counts[r];
+    std::vector<std::uint64_t> received(recv_offsets[nbp]);
+
+    // One call when counts and displacements fit in an int
+    std::uint64_t fits = sorted.size() <= INT_MAX && received.size() <= INT_MAX;
+    MPI_Allreduce(MPI_IN_PLACE, &fits, 1, MPI_UINT64_T, MPI_MIN, comm);
+    if (fits) {
+        std::vector<int> scounts(nbp), sdispls(nbp), rcounts(nbp), rdispls(nbp);
+        for (int r = 0; r < nbp; ++r) {
+            scounts[r] = int(send_counts[r]);
+            sdispls[r] = int(bounds[r]);
+            rcounts[r] = int(recv_counts[r]);
+            rdispls[r] = int(recv_offsets[r]);
+        }
+        MPI_Alltoallv(sorted.data(), scounts.data(), sdispls.data(), MPI_UINT64_T, received.data(), rcounts.data(),
+                      rdispls.data(), MPI_UINT64_T, comm);
+        return received;
+    }
+
+    // Else rounds of at most EXCHANGE_CHUNK keys per pair of processes, through staging buffers
+    const std::size_t chunk = std::max<std::size_t>(1, EXCHANGE_CHUNK / nbp);
+    std::uint64_t rounds = 0;
+    for (int r = 0; r < nbp; ++r)
+        rounds = std::max(rounds, (std::max(send_counts[r], recv_counts[r]) + chunk - 1) / chunk);
+    MPI_Allreduce(MPI_IN_PLACE, &rounds, 1, MPI_UINT64_T, MPI_MAX, comm);
+    std::vector<std::uint64_t> send_stage(chunk * nbp), recv_stage(chunk * nbp);
+    std::vector<int> scounts(nbp), rcounts(nbp), displs(nbp);
+    for (int r = 0; r < nbp; ++r) displs[r] = int(r * chunk);
+    for (std::uint64_t round = 0; round < rounds; ++round) {
+        const std::size_t first = round * chunk;
+        for (int r = 0; r < nbp; ++r) {
+            scounts[r] = int(std::min(chunk, send_counts[r] - std::min<std::size_t>(first, send_counts[r])));
+            rcounts[r] = int(std::min(chunk, recv_counts[r] - std::min<std::size_t>(first, recv_counts[r])));
+            if (scounts[r] > 0)
+                std::copy_n(sorted.begin() + bounds[r] + first, scounts[r], send_stage.begin() + displs[r]);
+        }
+        MPI_Alltoallv(send_stage.data(), scounts.data(), displs.data(), MPI_UINT64_T, recv_stage.data(),
+                      rcounts.data(), displs.data(), MPI_UINT64_T, comm);
+        for (int r = 0; r < nbp; ++r)
+            std::copy_n(recv_stage.begin() + displs[r], rcounts[r], received.begin() + recv_offsets[r] + first);
+    }
+    return received;
+}
+}  // namespace
+
+std::uint64_t splitmix64(std::uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+std::vector<Sample> choose_splitters(const std::vector<Sample>& samples, std::uint64_t local_count, MPI_Comm comm) {
+    int nbp;
+    MPI_Comm_size(comm, &nbp);
+    // Every sample of process r stands for n_r / s_r keys
+    std::uint64_t mine[2] = {local_count, samples.size()};
+    std::vector<std::uint64_t> sizes(2 * nbp);
+    MPI_Allgather(mine, 2, MPI_UINT64_T, sizes.data(), 2, MPI_UINT64_T, comm);
+    std::vector<int> counts(nbp), displs(nbp);
+    for (int r = 0; r < nbp; ++r) counts[r] = 3 * int(sizes[2 * r + 1]);
+    std::partial_sum(counts.begin(), counts.end() - 1, displs.begin() + 1);
+    std::vector<Sample> all((displs.back() + counts.back()) / 3);
+    MPI_Allgatherv(samples.data(), 3 * int(samples.size()), MPI_UINT64_T, all.data(), counts.data(), displs.data(),
+                   MPI_UINT64_T, comm);
+    std::sort(all.begin(), all.end());
+
+    double total = 0.;
+    for (int r = 0; r < nbp; ++r) total += double(sizes[2 * r]);
+    std::vector<Sample> splitters;
+    double cumulated = 0.;
+    for (const auto& sample : all) {
+        // The sample is the middle of the keys it stands for : estimated global rank
+        const double weight = double(sizes[2 * sample.rank]) / sizes[2 * sample.rank + 1];
+        const double position = cumulated + 0.5 * weight;
+        cumulated += weight;
+        // Several splitters on one sample when it stands for more than N / nbp keys
+        while (int(splitters.size()) < nbp - 1 && position >= (splitters.size() + 1) * total / nbp)
+            splitters.push_back(sample);
+    }
+    // Empty buckets at the end when there are fewer samples than processes
+    const Sample last{~std::uint64_t(0), std::uint64_t(nbp), 0};
+    splitters.resize(nbp - 1, last);
+    return splitters;
+}
+
+SortTimes sample_sort(std::vector<std::uint64_t>& keys, MPI_Comm comm, int oversampling) {
+    int rank, nbp;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nbp);
+    if (oversampling <= 0) oversampling = std::max(nbp, DEFAULT_OVERSAMPLING);
+    SortTimes times;
+    double start = MPI_Wtime(), t = start;
+    auto lap = [&t](double& phase) {
+        double now = MPI_Wtime();
+        phase = now - t;
+        t = now;
+    };
+
+    radix_sort(keys);
+    lap(times.local_sort);
+    if (nbp == 1) {
+        times.total = t - start;
+        return times;
+    }
+    // Samples in the middle of oversampling equal parts of the sorted keys
+    const std::uint64_t n = keys.size(), s = std::min<std::uint64_t>(oversampling, n);
+    std::vector<Sample> samples(s);
+    for (std::uint64_t j = 0; j < s; ++j) {
+        std::uint64_t index = (2 * j + 1) * n / (2 * s);
+        samples[j] = {keys[index], std::uint64_t(rank), index};
+    }
+    std::vector<Sample> splitters = choose_splitters(samples, n, comm);
+    lap(times.splitters);
+    std::vector<std::size_t> bounds(nbp + 1);
+    bounds[0] = 0;
+    bounds[nbp] = keys.size();
+    for (int d = 1; d < nbp; ++d) bounds[d] = keys_before(keys, rank, splitters[d - 1]);
+    lap(times.partition);
+    std::vector<std::uint64_t> received = exchange_buckets(keys, bounds, comm);
+    keys = std::vector<std::uint64_t>();  // frees the memory before the final sort
+    lap(times.exchange);
+    radix_sort(received);
+    keys.swap(received);
+    lap(times.final_sort);
+    times.total = t - start;
+    return times;
+}
+
+void KeyDigest::add(const std::uint64_t* keys, std::size_t n) {
+    count += n;
+    for (std::size_t i = 0; i < n; ++i) {
+        sum += keys[i];
+        hash_sum += splitmix64(keys[i]);
+    }
+}
+
+KeyDigest KeyDigest::reduced(MPI_Comm comm) const {
+    std::uint64_t local[3] = {count, sum, hash_sum}, global[3];
+    MPI_Allreduce(local, global, 3, MPI_UINT64_T, MPI_SUM, comm);
+    return {global[0], global[1], global[2]};
+}
+
+KeyDigest global_digest(const std::vector<std::uint64_t>& keys, MPI_Comm comm) {
+    KeyDigest digest;
+    digest.add(keys.data(), keys.size());
+    return digest.reduced(comm);
+}
+
+bool verify_sorted(bool local_sorted, bool empty, std::uint64_t first, std::uint64_t last,
+                   const KeyDigest& after, const KeyDigest& before, MPI_Comm comm) {
+    int ok = local_sorted;
+    // Largest key of the previous processes (0 if they hold none) against our smallest
+    std::uint64_t largest = empty ? 0 : last, previous_max = 0;
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Exscan(&largest, &previous_max, 1, MPI_UINT64_T, MPI_MAX, comm);
+    if (rank > 0 && !empty && first < previous_max) ok = 0;
+    MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, comm);
+    return ok && after.reduced(comm) == before;
+}
+
+bool verify_sorted(const std::vector<std::uint64_t>& keys, const KeyDigest& before, MPI_Comm comm) {
+    KeyDigest digest;
+    digest.add(keys.data(), keys.size());
+    return verify_sorted(std::is_sorted(keys.begin(), keys.end()), keys.empty(), keys.empty() ? 0 : keys.front(),
+                         keys.empty() ? 0 : keys.back(), digest, before, comm);
+}
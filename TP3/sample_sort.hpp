@@ -0,0 +1,76 @@
+#ifndef _SAMPLE_SORT_HPP_
+#define _SAMPLE_SORT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <mpi.h>
+
+// Distributed sort of 64 bits keys by regular sampling (sample sort) :
+//   1. every process sorts its keys (radix_sort.hpp) and takes `oversampling`
+//      regularly spaced samples of them,
+//   2. the samples of all the processes are gathered and sorted, the nbp - 1
+//      splitters being taken at regular steps of the number of keys they stand for,
+//   3. the bounds of the buckets in the sorted local keys are found by binary
+//      search and the buckets exchanged with MPI_Alltoallv,
+//   4. every process sorts the keys it received.
+// Keys, samples and splitters are ordered by (key, process, local index) so that
+// equal keys may be split between processes : many duplicates do not unbalance
+// the result. The keys stay distributed : at the end every key of process r is
+// lower or equal to the keys of process r + 1, each process holding about N / nbp keys.
+struct SortTimes {
+    double local_sort = 0.;  // radix sort of the initial keys
+    double splitters = 0.;   // sampling, gathering and choice of the splitters
+    double partition = 0.;   // binary search of the bucket bounds
+    double exchange = 0.;    // MPI_Alltoallv
+    double final_sort = 0.;  // radix sort of the received keys
+    double total = 0.;
+};
+
+// Samples per process : the largest bucket exceeds N / nbp by about N / oversampling
+const int DEFAULT_OVERSAMPLING = 256;
+
+// Collective over `comm`. oversampling <= 0 : max(nbp, DEFAULT_OVERSAMPLING) samples per process.
+SortTimes sample_sort(std::vector<std::uint64_t>& keys, MPI_Comm comm, int oversampling = 0);
+
+// Total order of the keys used to split them : ties broken by process, then by
+// an index (position in the sorted local keys, or in the input file)
+struct Sample {
+    std::uint64_t key, rank, index;
+    bool operator<(const Sample& other) const {
+        if (key != other.key) return key < other.key;
+        if (rank != other.rank) return rank < other.rank;
+        return index < other.index;
+    }
+};
+
+// Collective : nbp - 1 splitters chosen among the samples of all the processes,
+// each sample of a process standing for local_count / (its number of samples) keys.
+// Bucket d holds the keys between splitters d - 1 and d.
+std::vector<Sample> choose_splitters(const std::vector<Sample>& samples, std::uint64_t local_count, MPI_Comm comm);
+
+// Count, sum and sum of a hash of keys : equal before and after the sort if the
+// keys were only moved
+struct KeyDigest {
+    std::uint64_t count = 0, sum = 0, hash_sum = 0;
+    bool operator==(const KeyDigest& other) const {
+        return count == other.count && sum == other.sum && hash_sum == other.hash_sum;
+    }
+    void add(const std::uint64_t* keys, std::size_t n);
+    // Sum over the processes of `comm` (collective)
+    KeyDigest reduced(MPI_Comm comm) const;
+};
+KeyDigest global_digest(const std::vector<std::uint64_t>& keys, MPI_Comm comm);
+
+// Collective : true on every process if the keys are sorted locally, in order
+// from a process to the next and have the digest `before`
+bool verify_sorted(const std::vector<std::uint64_t>& keys, const KeyDigest& before, MPI_Comm comm);
+// Same check of pieces of the sorted sequence : `local_sorted` tells whether the
+// local keys are sorted, `first` and `last` are the smallest and largest of them
+bool verify_sorted(bool local_sorted, bool empty, std::uint64_t first, std::uint64_t last,
+                   const KeyDigest& after, const KeyDigest& before, MPI_Comm comm);
+
+// splitmix64 : pseudo-random generator and hash of the keys
+std::uint64_t splitmix64(std::uint64_t x);
+
+#endif
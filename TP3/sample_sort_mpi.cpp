@@ -0,0 +1,251 @@
+// Tri distribué de clés de 64 bits (sample sort), version C++ de bucket_sort_mpi.py
+// sans rassemblement final : chaque processus génère sa part des N clés (N
+// quelconque), le tri les laisse réparties entre les processus dans l'ordre des
+// rangs, puis une vérification globale contrôle l'ordre et que les clés n'ont
+// été que déplacées (nombre, somme et somme d'un hachage des clés).
+//
+//   mpirun -np 4 ./sample_sort_mpi.exe [options]
+//     --n N                    number of keys (1200000, 1.2e9 accepted)
+//     --distribution uniform|small|skewed
+//                              uniform on 64 bits, [0, 500) as bucket_sort_mpi.py,
+//                              or x >> (x % 64) (many small keys) (uniform)
+//     --oversampling S         samples per process (max(nbp, 256))
+//     --seed S                 (0)
+//     --repeat R               best of R sorts (1)
+//
+//   Tri externe d'un fichier de clés (binaire, 8 octets par clé) plus gros que la mémoire :
+//     --external file          file to sort (the N keys are generated in memory otherwise)
+//     --generate               first write the N keys of --distribution to the file
+//     --output file            sorted keys (file.sorted)
+//     --temp dir               directory of the sorted runs (directory of the output)
+//     --memory M               keys in memory per process (3.3e7 : 256 MiB)
+//     --block B                keys per I/O block and per exchange round (1048576)
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <mpi.h>
+#include <omp.h>
+#include "block_io.hpp"
+#include "external_sort.hpp"
+#include "sample_sort.hpp"
+
+namespace {
+enum class Distribution { Uniform, Small, Skewed };
+
+// Keys of global indices first .. first+count-1 : the same keys whatever nbp
+std::vector<std::uint64_t> generate(std::uint64_t first, std::uint64_t count, Distribution distribution,
+                                    std::uint64_t seed) {
+    std::vector<std::uint64_t> keys(count);
+#pragma omp parallel for
+    for (std::uint64_t i = 0; i < count; ++i) {
+        std::uint64_t x = splitmix64(seed * 0x632be59bd9b4e019ULL + first + i);
+        if (distribution == Distribution::Small) x %= 500;
+        if (distribution == Distribution::Skewed) x >>= x % 64;
+        keys[i] = x;
+    }
+    return keys;
+}
+
+// Slice of the N keys of process rank : N / nbp keys, one more for the N % nbp first processes
+void slice(std::uint64_t n, int rank, int nbp, std::uint64_t& first, std::uint64_t& count) {
+    count = n / nbp + (std::uint64_t(rank) < n % nbp ? 1 : 0);
+    first = rank * (n / nbp) + std::min<std::uint64_t>(rank, n % nbp);
+}
+
+// Every process writes its slice, by blocks of the generated keys
+void generate_file(const std::string& filename, std::uint64_t n, Distribution distribution, std::uint64_t seed,
+                   std::size_t block, MPI_Comm comm) {
+    int rank, nbp;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nbp);
+    if (rank == 0) BlockWriter(filename, 0, 1, true).close();
+    MPI_Barrier(comm);
+    std::uint64_t first, count;
+    slice(n, rank, nbp, first, count);
+    BlockWriter writer(filename, first, block);
+    for (std::uint64_t done = 0; done < count; done += block) {
+        auto keys = generate(first + done, std::min<std::uint64_t>(block, count - done), distribution, seed);
+        writer.write(keys.data(), keys.size());
+    }
+    writer.close();
+    MPI_Barrier(comm);
+}
+
+// Sum of `bytes` over the processes per second of the slowest one, in MB/s
+double bandwidth(std::uint64_t bytes, double seconds, MPI_Comm comm) {
+    MPI_Allreduce(MPI_IN_PLACE, &bytes, 1, MPI_UINT64_T, MPI_SUM, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &seconds, 1, MPI_DOUBLE, MPI_MAX, comm);
+    return seconds > 0. ? bytes / seconds / 1.E6 : 0.;
+}
+
+int run_external(const ExternalOptions& options, MPI_Comm comm) {
+    int rank, nbp;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nbp);
+    ExternalStats stats = external_sort(options, comm);
+    KeyDigest input = stats.input_digest.reduced(comm);
+    double verify_start = MPI_Wtime();
+    bool ok = verify_sorted_file(options.output, stats.first, stats.keys, input, options.block_keys, comm);
+    double verify_time = MPI_Wtime() - verify_start;
+
+    const double distribute_bw = bandwidth(stats.input_bytes + stats.run_bytes, stats.distribute, comm);
+    const double merge_bw = bandwidth(stats.merge_read + stats.merge_written, stats.merge, comm);
+    const double merge_keys = bandwidth(stats.merge_written / 8, stats.merge, comm);  // millions of keys/s
+    const double total_bw =
+        bandwidth(stats.input_bytes + stats.run_bytes + stats.merge_read + stats.merge_written, stats.total, comm);
+    double times[3] = {stats.splitters, stats.distribute, stats.merge};
+    MPI_Allreduce(MPI_IN_PLACE, times, 3, MPI_DOUBLE, MPI_MAX, comm);
+    int counts[2] = {stats.runs, stats.merge_passes};
+    MPI_Allreduce(MPI_IN_PLACE, counts, 2, MPI_INT, MPI_MAX, comm);
+    double total = stats.total;
+    MPI_Allreduce(MPI_IN_PLACE, &total, 1, MPI_DOUBLE, MPI_MAX, comm);
+    if (rank == 0) {
+        std::printf("Tri externe de %llu cles (%.1f Mo) sur %d processus x %d threads, %zu cles en memoire "
+                    "par processus\n\n",
+                    (unsigned long long)input.count, 8. * input.count / 1.E6, nbp, omp_get_max_threads(),
+                    options.memory_keys);
+        std::printf("Phase                        | Temps max (s) | Debit E/S (Mo/s) | Debit (millions de cles/s)\n");
+        std::printf("-----------------------------|---------------|------------------|---------------------------\n");
+        std::printf("separateurs                  | %13.4f | -                | -\n", times[0]);
+        std::printf("repartition (%3d sequences)  | %13.4f | %16.1f | %.1f\n", counts[0], times[1], distribute_bw,
+                    input.count / times[1] / 1.E6);
+        std::printf("fusion (%d passe%s)            | %13.4f | %16.1f | %.1f\n", counts[1], counts[1] > 1 ? "s" : " ",
+                    times[2], merge_bw, merge_keys);
+        std::printf("total                        | %13.4f | %16.1f | %.1f\n", total, total_bw,
+                    input.count / total / 1.E6);
+        std::printf("\nVerification de %s (%.4f s) : %s\n", options.output.c_str(), verify_time, ok ? "OK" : "ECHEC");
+    }
+    return ok ? 0 : 2;
+}
+
+std::uint64_t parse_count(const std::string& text) {
+    std::size_t used = 0;
+    double value = std::stod(text, &used);
+    if (used != text.size() || value < 0) throw std::invalid_argument("n " + text);
+    return std::uint64_t(value);
+}
+}  // namespace
+
+int main(int nargs, char* argv[]) {
+    MPI_Init(&nargs, &argv);
+    MPI_Comm comm = MPI_COMM_WORLD;
+    int rank, nbp;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nbp);
+
+    std::uint64_t n = 1200000, seed = 0;
+    Distribution distribution = Distribution::Uniform;
+    int oversampling = 0, repeat = 1;
+    ExternalOptions external;
+    bool generate_input = false;
+    try {
+        for (int a = 1; a < nargs; ++a) {
+            std::string arg = argv[a];
+            bool has_value = a + 1 < nargs;
+            if (arg == "--n" && has_value) {
+                n = parse_count(argv[++a]);
+            } else if (arg == "--distribution" && has_value) {
+                std::string value = argv[++a];
+                if (value == "uniform")
+                    distribution = Distribution::Uniform;
+                else if (value == "small")
+                    distribution = Distribution::Small;
+                else if (value == "skewed")
+                    distribution = Distribution::Skewed;
+                else
+                    throw std::invalid_argument("distribution " + value);
+            } else if (arg == "--oversampling" && has_value) {
+                oversampling = std::stoi(argv[++a]);
+            } else if (arg == "--seed" && has_value) {
+                seed = std::stoull(argv[++a]);
+            } else if (arg == "--external" && has_value) {
+                external.input = argv[++a];
+            } else if (arg == "--generate") {
+                generate_input = true;
+            } else if (arg == "--output" && has_value) {
+                external.output = argv[++a];
+            } else if (arg == "--temp" && has_value) {
+                external.temp_directory = argv[++a];
+            } else if (arg == "--memory" && has_value) {
+                external.memory_keys = parse_count(argv[++a]);
+            } else if (arg == "--block" && has_value) {
+                external.block_keys = parse_count(argv[++a]);
+            } else if (arg == "--repeat" && has_value) {
+                repeat = std::max(1, std::stoi(argv[++a]));
+            } else {
+                throw std::invalid_argument(arg);
+            }
+        }
+    } catch (const std::logic_error& e) {
+        if (rank == 0) std::cerr << "Argument invalide : " << e.what() << std::endl;
+        MPI_Finalize();
+        return 1;
+    }
+
+    if (!external.input.empty()) {
+        if (external.output.empty()) external.output = external.input + ".sorted";
+        if (external.temp_directory == ".") {
+            auto slash = external.output.rfind('/');
+            if (slash != std::string::npos) external.temp_directory = external.output.substr(0, slash);
+        }
+        external.oversampling = oversampling;
+        int status = 0;
+        try {
+            if (generate_input) generate_file(external.input, n, distribution, seed, external.block_keys, comm);
+            status = run_external(external, comm);
+        } catch (const std::runtime_error& e) {
+            std::cerr << e.what() << std::endl;
+            MPI_Abort(comm, 1);
+        }
+        MPI_Finalize();
+        return status;
+    }
+
+    std::uint64_t first, count;
+    slice(n, rank, nbp, first, count);
+
+    SortTimes best;
+    best.total = 1.E30;
+    std::vector<std::uint64_t> keys;
+    bool ok = true;
+    for (int r = 0; r < repeat; ++r) {
+        keys = generate(first, count, distribution, seed);
+        KeyDigest before = global_digest(keys, comm);
+        MPI_Barrier(comm);
+        SortTimes times = sample_sort(keys, comm, oversampling);
+        // Slowest process for every phase
+        double phases[6] = {times.local_sort, times.splitters, times.partition, times.exchange, times.final_sort,
+                            times.total};
+        MPI_Allreduce(MPI_IN_PLACE, phases, 6, MPI_DOUBLE, MPI_MAX, comm);
+        if (phases[5] < best.total)
+            best = {phases[0], phases[1], phases[2], phases[3], phases[4], phases[5]};
+        ok = verify_sorted(keys, before, comm) && ok;
+    }
+
+    double verify_start = MPI_Wtime();
+    KeyDigest digest = global_digest(keys, comm);
+    double verify_time = MPI_Wtime() - verify_start;
+    std::uint64_t local = keys.size(), largest;
+    MPI_Reduce(&local, &largest, 1, MPI_UINT64_T, MPI_MAX, 0, comm);
+    if (rank == 0) {
+        std::printf("Tri de %llu cles sur %d processus x %d threads\n\n", (unsigned long long)n, nbp,
+                    omp_get_max_threads());
+        std::printf("Phase                 | Temps max (secondes)\n");
+        std::printf("----------------------|---------------------\n");
+        const char* names[] = {"tri local (radix)", "separateurs", "bornes des paquets", "echange (Alltoallv)",
+                               "tri final (radix)", "total"};
+        double values[] = {best.local_sort, best.splitters, best.partition, best.exchange, best.final_sort,
+                           best.total};
+        for (int p = 0; p < 6; ++p) std::printf("%-21s | %20.4f\n", names[p], values[p]);
+        std::printf("\nDebit : %.1f millions de cles/s\n", n / best.total / 1.E6);
+        std::printf("Desequilibre (max / moyenne des cles par processus) : %.3f\n",
+                    n ? double(largest) * nbp / n : 1.);
+        std::printf("Verification (ordre, nombre, somme et hachage des %llu cles, %.4f s) : %s\n",
+                    (unsigned long long)digest.count, verify_time, ok ? "OK" : "ECHEC");
+    }
+    MPI_Finalize();
+    return ok ? 0 : 2;
+}
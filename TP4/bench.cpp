@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <vector>
+#include "bench.hpp"
+
+namespace {
+const int nb_phases = 6;
+const char* phase_names[nb_phases] = {"compute", "idle", "balance", "halo", "gather", "total"};
+}  // namespace
+
+PhaseTimes run_bench(Grille& grid, const BenchOptions& options, MPI_Comm comm) {
+    int rank, nbp;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nbp);
+
+    // Gather buffers, as for the display (set again when the stripes move)
+    std::vector<int> counts(nbp), displs(nbp, 0);
+    std::vector<unsigned char> flat_cells;
+    auto setup_gather = [&]() {
+        int local_count = grid.dimensions_loc.first * grid.dimensions_loc.second;
+        MPI_Allgather(&local_count, 1, MPI_INT, counts.data(), 1, MPI_INT, comm);
+        for (int p = 1; p < nbp; ++p) displs[p] = displs[p - 1] + counts[p - 1];
+        flat_cells.resize(local_count);
+    };
+    setup_gather();
+    LoadBalancer balancer(options.balance);
+    std::vector<unsigned char> grid_glob(rank == 0 ? size_t(grid.dimensions.first) * grid.dimensions.second : 0);
+
+    grid.update_ghost_cells(comm);
+    MPI_Barrier(comm);
+    const HaloTimes halo_start = grid.halo_times();
+
+    PhaseTimes times;
+    double start = MPI_Wtime();
+    for (long long generation = 1; generation <= options.generations; ++generation) {
+        double t0 = MPI_Wtime();
+        grid.compute_next_iteration();
+        double t1 = MPI_Wtime();
+        // The barrier separates waiting for slower processes from the exchange itself
+        INSTR_BEGIN("attente");
+        MPI_Barrier(comm);
+        INSTR_END("attente");
+        double t2 = MPI_Wtime();
+        if (balancer.update(grid, t1 - t0, generation, comm)) setup_gather();
+        double tb = MPI_Wtime();
+        grid.update_ghost_cells(comm);
+        double t3 = MPI_Wtime();
+        if (options.gather_every > 0 && generation % options.gather_every == 0) {
+            INSTR_SCOPE("gather");
+            for (int i = 0; i < grid.dimensions_loc.first; ++i) {
+                std::copy_n(grid.row(i), grid.dimensions_loc.second,
+                            flat_cells.begin() + size_t(i) * grid.dimensions_loc.second);
+            }
+            MPI_Gatherv(flat_cells.data(), counts[rank], MPI_UNSIGNED_CHAR, grid_glob.data(),
+                        counts.data(), displs.data(), MPI_UNSIGNED_CHAR, 0, comm);
+        }
+        double t4 = MPI_Wtime();
+        times.compute += t1 - t0;
+        times.idle += t2 - t1;
+        times.balance += tb - t2;
+        times.halo += t3 - tb;
+        times.gather += t4 - t3;
+    }
+    times.total = MPI_Wtime() - start;
+
+    // Halo time per generation by path, over the processes using it : the shared
+    // path in the shared mode, the message path with at least one message link
+    int links[3] = {0, 0, 0};  // message, shared copy, in place
+    for (int side = 0; side < 2; ++side) ++links[int(grid.halo_link(side))];
+    const bool shared_mode = links[1] + links[2] > 0;
+    const HaloTimes& halo_end = grid.halo_times();
+    const long long exchanges = std::max(1LL, halo_end.exchanges - halo_start.exchanges);
+    double per_generation[2] = {(halo_end.shared - halo_start.shared) / exchanges,
+                                (halo_end.message - halo_start.message) / exchanges};
+    const bool uses[2] = {shared_mode, links[0] > 0};
+    double path_min[2], path_max[2], path_sum[2], path_count[2];
+    for (int k = 0; k < 2; ++k) {
+        double value = uses[k] ? per_generation[k] : DBL_MAX, count = uses[k] ? 1. : 0.;
+        MPI_Reduce(&value, &path_min[k], 1, MPI_DOUBLE, MPI_MIN, 0, comm);
+        value = uses[k] ? per_generation[k] : 0.;
+        MPI_Reduce(&value, &path_max[k], 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+        MPI_Reduce(&value, &path_sum[k], 1, MPI_DOUBLE, MPI_SUM, 0, comm);
+        MPI_Reduce(&count, &path_count[k], 1, MPI_DOUBLE, MPI_SUM, 0, comm);
+    }
+    int links_sum[3];
+    MPI_Reduce(links, links_sum, 3, MPI_INT, MPI_SUM, 0, comm);
+    const char* path_names[2] = {"shared", "message"};
+
+    double mine[nb_phases] = {times.compute, times.idle, times.balance, times.halo, times.gather, times.total};
+    double tmin[nb_phases], tmax[nb_phases], tsum[nb_phases];
+    MPI_Reduce(mine, tmin, nb_phases, MPI_DOUBLE, MPI_MIN, 0, comm);
+    MPI_Reduce(mine, tmax, nb_phases, MPI_DOUBLE, MPI_MAX, 0, comm);
+    MPI_Reduce(mine, tsum, nb_phases, MPI_DOUBLE, MPI_SUM, 0, comm);
+    if (rank != 0) return times;
+
+    double cells = double(grid.dimensions.first) * grid.dimensions.second;
+    double updates_per_second = cells * options.generations / tmax[nb_phases - 1];
+    double mean_compute = tsum[0] / nbp;
+    double imbalance = mean_compute > 0. ? tmax[0] / mean_compute : 1.;
+
+    if (options.json) {
+        std::printf("{\"processes\": %d, \"rows\": %d, \"cols\": %d, \"generations\": %lld, \"phases\": {",
+                    nbp, grid.dimensions.first, grid.dimensions.second, options.generations);
+        for (int k = 0; k < nb_phases; ++k) {
+            std::printf("%s\"%s\": {\"min\": %.6e, \"mean\": %.6e, \"max\": %.6e}", k ? ", " : "",
+                        phase_names[k], tmin[k], tsum[k] / nbp, tmax[k]);
+        }
+        std::printf("}, \"halo_per_generation\": {");
+        for (int k = 0; k < 2; ++k) {
+            std::printf("%s\"%s\": {\"processes\": %d", k ? ", " : "", path_names[k], int(path_count[k]));
+            if (path_count[k] > 0) {
+                std::printf(", \"min\": %.6e, \"mean\": %.6e, \"max\": %.6e", path_min[k],
+                            path_sum[k] / path_count[k], path_max[k]);
+            }
+            std::printf("}");
+        }
+        std::printf("}, \"halo_links\": {\"message\": %d, \"shared_copy\": %d, \"in_place\": %d}",
+                    links_sum[0], links_sum[1], links_sum[2]);
+        std::printf(", \"cell_updates_per_second\": %.6e, \"load_imbalance\": %.4f, \"rebalances\": %d}\n",
+                    updates_per_second, imbalance, balancer.rebalances());
+    } else {
+        std::printf("Benchmark : %d processus, grille %dx%d, %lld generations\n",
+                    nbp, grid.dimensions.first, grid.dimensions.second, options.generations);
+        std::printf("%-8s %12s %12s %12s\n", "phase", "min (s)", "moyenne (s)", "max (s)");
+        for (int k = 0; k < nb_phases; ++k) {
+            std::printf("%-8s %12.6f %12.6f %12.6f\n", phase_names[k], tmin[k], tsum[k] / nbp, tmax[k]);
+        }
+        std::printf("Halo par generation (us) : %d lien(s) en place, %d copie(s) en memoire partagee, %d par messages\n",
+                    links_sum[2], links_sum[1], links_sum[0]);
+        const char* path_labels[2] = {"partage", "messages"};
+        for (int k = 0; k < 2; ++k) {
+            if (path_count[k] == 0) continue;
+            std::printf("%-8s %12.3f %12.3f %12.3f  (%d processus)\n", path_labels[k], 1.E6 * path_min[k],
+                        1.E6 * path_sum[k] / path_count[k], 1.E6 * path_max[k], int(path_count[k]));
+        }
+        std::printf("Cellules mises a jour par seconde : %.4e\n", updates_per_second);
+        std::printf("Desequilibre de charge (max/moyenne du calcul) : %.3f\n", imbalance);
+        if (options.balance.every > 0) {
+            std::printf("Reequilibrages : %d, dernier desequilibre mesure : %.3f\n", balancer.rebalances(),
+                        balancer.last_imbalance());
+        }
+    }
+    std::fflush(stdout);
+    return times;
+}
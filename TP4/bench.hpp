@@ -0,0 +1,31 @@
+#ifndef _BENCH_HPP_
+#define _BENCH_HPP_
+
+#include <mpi.h>
+#include "grille.hpp"
+#include "load_balance.hpp"
+
+// Headless benchmark : every process of `comm` is a worker, nothing is
+// printed while iterating.
+struct BenchOptions {
+    long long generations = 100;
+    long long gather_every = 1;  // gather the grid on process 0 every N generations (0 : never)
+    bool json = false;
+    BalanceOptions balance;      // dynamic load balancing of the stripes
+};
+
+// Time spent in each phase of a generation, summed over the run
+struct PhaseTimes {
+    double compute = 0.;  // compute_next_iteration
+    double idle = 0.;     // waiting for the slowest process before the halo exchange
+    double balance = 0.;  // load measurement and migration of rows
+    double halo = 0.;     // update_ghost_cells
+    double gather = 0.;   // MPI_Gatherv of the grid on process 0
+    double total = 0.;    // whole loop
+};
+
+// Collective over `comm`. Runs the generations, then reduces the phase times
+// (min/mean/max over the processes) and prints the report on process 0.
+PhaseTimes run_bench(Grille& grid, const BenchOptions& options, MPI_Comm comm);
+
+#endif
@@ -0,0 +1,146 @@
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "checkpoint.hpp"
+
+namespace {
+const char magic[8] = {'G', 'O', 'L', 'C', 'K', 'P', 'T', '2'};
+
+// On-disk header, 64 bytes
+struct FileHeader {
+    char magic[8];
+    long long rows;
+    long long cols;
+    long long generation;
+    long long rule_length;
+    char reserved[24];
+};
+static_assert(sizeof(FileHeader) == 64, "checkpoint header must be 64 bytes");
+
+// One row of the file, so that counts stay small and the file view is one
+// contiguous block of rows per process.
+MPI_Datatype make_row_type(int row_bytes) {
+    MPI_Datatype row_type;
+    MPI_Type_contiguous(row_bytes, MPI_BYTE, &row_type);
+    MPI_Type_commit(&row_type);
+    return row_type;
+}
+
+// Longest rule name accepted when reading, against corrupted headers
+const long long max_rule_length = 4096;
+
+void set_stripe_view(MPI_File fh, MPI_Offset data_offset, const Grille& grid, int row_bytes,
+                     MPI_Datatype row_type) {
+    MPI_Offset disp = data_offset + MPI_Offset(grid.start_loc) * row_bytes;
+    MPI_File_set_view(fh, disp, row_type, row_type, "native", MPI_INFO_NULL);
+}
+}  // namespace
+
+double write_checkpoint(const std::string& filename, const Grille& grid, long long generation,
+                        const std::string& rule, MPI_Comm comm) {
+    INSTR_SCOPE("checkpoint");
+    double start = MPI_Wtime();
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    const int cols = grid.dimensions.second;
+    const int row_bytes = (cols + 7) / 8;
+    const int rows_loc = grid.dimensions_loc.first;
+
+    // Pack my stripe, one bit per cell
+    std::vector<unsigned char> packed(size_t(rows_loc) * row_bytes, 0);
+    for (int i = 0; i < rows_loc; ++i) {
+        const unsigned char* row = grid.row(i);
+        unsigned char* out = packed.data() + size_t(i) * row_bytes;
+        for (int b = 0; b < row_bytes; ++b) {
+            unsigned char byte = 0;
+            for (int k = 0; k < 8 && 8 * b + k < cols; ++k)
+                byte |= (row[8 * b + k] != 0) << k;
+            out[b] = byte;
+        }
+    }
+
+    std::string tmp_name = filename + ".tmp";
+    MPI_File fh;
+    if (MPI_File_open(comm, tmp_name.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS)
+        throw std::runtime_error("cannot create checkpoint file " + tmp_name);
+    const MPI_Offset data_offset = sizeof(FileHeader) + MPI_Offset(rule.size());
+    MPI_File_set_size(fh, data_offset + MPI_Offset(grid.dimensions.first) * row_bytes);
+
+    if (rank == 0) {
+        FileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.rows = grid.dimensions.first;
+        header.cols = cols;
+        header.generation = generation;
+        header.rule_length = (long long)rule.size();
+        MPI_File_write_at(fh, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+        MPI_File_write_at(fh, sizeof(header), rule.data(), int(rule.size()), MPI_BYTE, MPI_STATUS_IGNORE);
+    }
+
+    MPI_Datatype row_type = make_row_type(row_bytes);
+    set_stripe_view(fh, data_offset, grid, row_bytes, row_type);
+    MPI_File_write_at_all(fh, 0, packed.data(), rows_loc, row_type, MPI_STATUS_IGNORE);
+    MPI_File_close(&fh);
+    MPI_Type_free(&row_type);
+
+    // Only replace the previous checkpoint once the new one is complete
+    if (rank == 0) std::rename(tmp_name.c_str(), filename.c_str());
+    MPI_Barrier(comm);
+    return MPI_Wtime() - start;
+}
+
+CheckpointHeader read_checkpoint_header(const std::string& filename, MPI_Comm comm) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::vector<char> rule;
+    if (rank == 0) {
+        FILE* f = std::fopen(filename.c_str(), "rb");
+        if (f != nullptr) {
+            bool ok = std::fread(&header, sizeof(header), 1, f) == 1 && header.rule_length >= 0 &&
+                      header.rule_length <= max_rule_length;
+            if (ok) {
+                rule.resize(size_t(header.rule_length));
+                ok = std::fread(rule.data(), 1, rule.size(), f) == rule.size();
+            }
+            if (!ok) std::memset(&header, 0, sizeof(header));
+            std::fclose(f);
+        }
+    }
+    MPI_Bcast(&header, sizeof(header), MPI_BYTE, 0, comm);
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0)
+        throw std::runtime_error(filename + " is not a game of life checkpoint");
+    rule.resize(size_t(header.rule_length));
+    MPI_Bcast(rule.data(), int(rule.size()), MPI_CHAR, 0, comm);
+    return {header.rows, header.cols, header.generation, std::string(rule.begin(), rule.end()),
+            (long long)sizeof(header) + header.rule_length};
+}
+
+void read_checkpoint(const std::string& filename, Grille& grid, MPI_Comm comm) {
+    const CheckpointHeader header = read_checkpoint_header(filename, comm);
+    const int cols = grid.dimensions.second;
+    const int row_bytes = (cols + 7) / 8;
+    const int rows_loc = grid.dimensions_loc.first;
+
+    MPI_File fh;
+    if (MPI_File_open(comm, filename.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS)
+        throw std::runtime_error("cannot open checkpoint file " + filename);
+    MPI_Datatype row_type = make_row_type(row_bytes);
+    set_stripe_view(fh, header.data_offset, grid, row_bytes, row_type);
+    std::vector<unsigned char> packed(size_t(rows_loc) * row_bytes);
+    MPI_File_read_at_all(fh, 0, packed.data(), rows_loc, row_type, MPI_STATUS_IGNORE);
+    MPI_File_close(&fh);
+    MPI_Type_free(&row_type);
+
+    for (int i = 0; i < rows_loc; ++i) {
+        const unsigned char* in = packed.data() + size_t(i) * row_bytes;
+        unsigned char* row = grid.row(i);
+        for (int j = 0; j < cols; ++j)
+            row[j] = (in[j / 8] >> (j % 8)) & 1;
+    }
+    grid.cells_changed();
+}
@@ -0,0 +1,37 @@
+#ifndef _CHECKPOINT_HPP_
+#define _CHECKPOINT_HPP_
+
+#include <string>
+#include <utility>
+#include <mpi.h>
+#include "grille.hpp"
+
+// Checkpoint file layout :
+//   - a 64 bytes header (magic, dimensions, generation, length of the rule)
+//   - the rule name, without terminating zero (any length)
+//   - the grid, row after row, one bit per cell (bit j%8 of byte j/8 of the row),
+//     each row padded to a whole number of bytes.
+// Every row stripe is thus a contiguous range of the file, so a run may restart
+// on any number of processes.
+struct CheckpointHeader {
+    long long rows;
+    long long cols;
+    long long generation;
+    std::string rule;
+    long long data_offset;  // position of the first row in the file
+};
+
+// Collective over `comm` : every process writes its stripe of `grid` with
+// MPI_File_write_at_all. The file is written under a temporary name and renamed
+// once complete. Returns the elapsed time.
+double write_checkpoint(const std::string& filename, const Grille& grid, long long generation,
+                        const std::string& rule, MPI_Comm comm);
+
+// Collective over `comm`. Throws std::runtime_error if the file is not a checkpoint.
+CheckpointHeader read_checkpoint_header(const std::string& filename, MPI_Comm comm);
+
+// Collective over `comm` : fills the stripe of `grid` (already built with the
+// dimensions of the header) from the checkpoint.
+void read_checkpoint(const std::string& filename, Grille& grid, MPI_Comm comm);
+
+#endif
@@ -28,208 +28,194 @@
 #include <string>
 #include <random>
 #include <algorithm>
-#include <chrono>
 #include <tuple>
+#include <stdexcept>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <memory>
 #include <mpi.h>
+#if !defined(NO_SDL)
 #include <SDL2/SDL.h>
+#endif
+#include "grille.hpp"
+#include "pattern_io.hpp"
+#include "checkpoint.hpp"
+#include "bench.hpp"
+#include "instrument_mpi.h"
+#include "load_balance.hpp"
+#include "rules.hpp"
 
-// Type for a cell position
-using Position = std::pair<int, int>;
-// Type for a pattern (list of positions)
-using Pattern = std::vector<Position>;
-
-class Grille {
-public:
-    Grille(int rank, int nbp, std::pair<int, int> dim, const Pattern* init_pattern = nullptr,
-           SDL_Color color_life = {0, 0, 0, 255}, SDL_Color color_dead = {255, 255, 255, 255}) 
-        : dimensions(dim), col_life(color_life), col_dead(color_dead) {
-        
-        // Calculate local dimensions for this process
-        dimensions_loc.first = dim.first / nbp + (rank < dim.first % nbp ? 1 : 0);
-        dimensions_loc.second = dim.second;
-        
-        // Calculate starting position for this process
-        start_loc = rank * (dim.first / nbp) + (rank >= dim.first % nbp ? dim.first % nbp : rank);
-        
-        // Initialize cells with ghost cells (+2 in first dimension)
-        cells.resize(dimensions_loc.first + 2);
-        for (auto& row : cells) {
-            row.resize(dimensions_loc.second, 0);
-        }
-        
-        if (init_pattern != nullptr) {
-            // Set initial pattern
-            for (const auto& pos : *init_pattern) {
-                int i = pos.first - start_loc + 1;
-                int j = pos.second;
-                if (i >= 1 && i <= dimensions_loc.first) {
-                    cells[i][j] = 1;
-                }
-            }
-        } else {
-            // Random initialization
-            std::random_device rd;
-            std::mt19937 gen(rd());
-            std::uniform_int_distribution<> distrib(0, 1);
-            for (int i = 1; i <= dimensions_loc.first; ++i) {
-                for (int j = 0; j < dimensions_loc.second; ++j) {
-                    cells[i][j] = distrib(gen);
-                }
-            }
-        }
-    }
-    
-    void compute_next_iteration() {
-        std::vector<std::vector<unsigned char>> next_cells = cells;
-        
-        // For each cell in the grid (excluding ghost cells)
-        for (int i = 1; i <= dimensions_loc.first; ++i) {
-            for (int j = 0; j < dimensions_loc.second; ++j) {
-                int neighbors_count = 0;
-                
-                // Count neighbors (including wraparound)
-                for (int di = -1; di <= 1; ++di) {
-                    for (int dj = -1; dj <= 1; ++dj) {
-                        if (di == 0 && dj == 0) continue;
-                        
-                        int ni = i + di;
-                        int nj = (j + dj + dimensions_loc.second) % dimensions_loc.second;
-                        
-                        if (ni >= 0 && ni < cells.size()) {
-                            neighbors_count += cells[ni][nj];
-                        }
-                    }
-                }
-                
-                // Apply Game of Life rules
-                if (cells[i][j] == 1) {
-                    if (neighbors_count < 2 || neighbors_count > 3) {
-                        next_cells[i][j] = 0;  // Death
-                    }
-                } else {
-                    if (neighbors_count == 3) {
-                        next_cells[i][j] = 1;  // Birth
-                    }
-                }
-            }
-        }
-        
-        cells = next_cells;
-    }
-    
-    void update_ghost_cells(MPI_Comm comm) {
-        int rank = 0, size = 0;
-        MPI_Comm_rank(comm, &rank);
-        MPI_Comm_size(comm, &size);
-        
-        // Send bottom row to next process, receive into top ghost row
-        MPI_Request req1, req2;
-        MPI_Irecv(&cells[0][0], dimensions_loc.second, MPI_UNSIGNED_CHAR, 
-                 (rank + size - 1) % size, 102, comm, &req1);
-        MPI_Irecv(&cells[dimensions_loc.first + 1][0], dimensions_loc.second, MPI_UNSIGNED_CHAR, 
-                 (rank + 1) % size, 101, comm, &req2);
-        
-        MPI_Send(&cells[1][0], dimensions_loc.second, MPI_UNSIGNED_CHAR, 
-                (rank + size - 1) % size, 101, comm);
-        MPI_Send(&cells[dimensions_loc.first][0], dimensions_loc.second, MPI_UNSIGNED_CHAR, 
-                (rank + 1) % size, 102, comm);
-        
-        MPI_Wait(&req1, MPI_STATUS_IGNORE);
-        MPI_Wait(&req2, MPI_STATUS_IGNORE);
-    }
-    
-    // Public members
-    std::pair<int, int> dimensions;
-    std::pair<int, int> dimensions_loc;
-    int start_loc;
-    std::vector<std::vector<unsigned char>> cells;
-    SDL_Color col_life;
-    SDL_Color col_dead;
-};
-
+#if !defined(NO_SDL)
 class App {
 public:
-    App(std::pair<int, int> geometry, Grille& grid) : grid(grid) {
-        // Calculate cell size
-        size_x = geometry.second / grid.dimensions.second;
-        size_y = geometry.first / grid.dimensions.first;
+    // A grid larger than the window is downsampled : every texel covers a block of
+    // cells and is shaded with the density of live cells in the block.
+    // An offscreen App opens no window : frames are rendered into frame() and, if
+    // frame_prefix is not empty, saved as <frame_prefix>NNNNN.ppm.
+    App(std::pair<int, int> geometry, Grille& grid, bool offscreen = false, const std::string& frame_prefix = "")
+        : grid(grid), offscreen(offscreen), frame_prefix(frame_prefix) {
+        // Cells per texel, then texel size on screen
+        block_x = std::max(1, (grid.dimensions.second + geometry.second - 1) / geometry.second);
+        block_y = std::max(1, (grid.dimensions.first + geometry.first - 1) / geometry.first);
+        tex_w = (grid.dimensions.second + block_x - 1) / block_x;
+        tex_h = (grid.dimensions.first + block_y - 1) / block_y;
+        size_x = geometry.second / tex_w;
+        size_y = geometry.first / tex_h;
         
         // Adjust window size to fit grid
-        width = grid.dimensions.second * size_x;
-        height = grid.dimensions.first * size_y;
+        width = tex_w * size_x;
+        height = tex_h * size_y;
         
         // Set draw color based on cell size
-        if (size_x > 4 && size_y > 4) {
+        if (size_x > 4 && size_y > 4 && block_x == 1 && block_y == 1) {
             draw_color = {192, 192, 192, 255}; // lightgrey
         } else {
             draw_color = {0, 0, 0, 0}; // transparent
         }
         
+        // Colors for a density of 0 to 255 live cells out of 255
+        for (int k = 0; k < 256; ++k) {
+            auto mix = [k](Uint8 dead, Uint8 life) { return Uint32((dead * (255 - k) + life * k) / 255); };
+            palette[k] = 0xFF000000u | (mix(grid.col_dead.r, grid.col_life.r) << 16)
+                       | (mix(grid.col_dead.g, grid.col_life.g) << 8) | mix(grid.col_dead.b, grid.col_life.b);
+        }
+        pixels.resize(size_t(tex_w) * tex_h);
+        counts.resize(tex_w);
+        if (offscreen) return;
+        
         // Initialize SDL
         SDL_Init(SDL_INIT_VIDEO);
         window = SDL_CreateWindow("Conway's Game of Life", 
                                   SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 
                                   width, height, SDL_WINDOW_SHOWN);
         renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+        texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, tex_w, tex_h);
+        
+        // Grid lines never change : draw them once in a transparent overlay
+        if (draw_color.a != 0) {
+            Uint32 line_color = 0xFF000000u | (draw_color.r << 16) | (draw_color.g << 8) | draw_color.b;
+            std::vector<Uint32> overlay(size_t(width) * height, 0);
+            for (int y = 0; y < height; y += size_y) {
+                std::fill_n(overlay.begin() + size_t(y) * width, width, line_color);
+            }
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; x += size_x) {
+                    overlay[size_t(y) * width + x] = line_color;
+                }
+            }
+            grid_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, width, height);
+            SDL_UpdateTexture(grid_texture, nullptr, overlay.data(), width * sizeof(Uint32));
+            SDL_SetTextureBlendMode(grid_texture, SDL_BLENDMODE_BLEND);
+        }
     }
     
     ~App() {
+        if (offscreen) return;
+        if (grid_texture != nullptr) SDL_DestroyTexture(grid_texture);
+        SDL_DestroyTexture(texture);
         SDL_DestroyRenderer(renderer);
         SDL_DestroyWindow(window);
         SDL_Quit();
     }
     
     void draw() {
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
-        
-        // Draw cells
-        for (int i = 1; i <= grid.dimensions_loc.first; ++i) {
-            for (int j = 0; j < grid.dimensions_loc.second; ++j) {
-                SDL_Rect rect = {
-                    j * size_x, 
-                    (i - 1 + grid.start_loc) * size_y, 
-                    size_x, 
-                    size_y
-                };
-                
-                if (grid.cells[i][j] == 1) {
-                    SDL_SetRenderDrawColor(renderer, grid.col_life.r, grid.col_life.g, grid.col_life.b, grid.col_life.a);
-                } else {
-                    SDL_SetRenderDrawColor(renderer, grid.col_dead.r, grid.col_dead.g, grid.col_dead.b, grid.col_dead.a);
-                }
-                
-                SDL_RenderFillRect(renderer, &rect);
-            }
+        if (offscreen) {
+            rasterize(pixels.data(), tex_w);
+            if (!frame_prefix.empty()) save_frame();
+            ++frame_count;
+            return;
         }
         
-        // Draw grid lines
-        if (draw_color.a != 0) {
-            SDL_SetRenderDrawColor(renderer, draw_color.r, draw_color.g, draw_color.b, draw_color.a);
-            
-            // Horizontal lines
-            for (int i = 0; i <= grid.dimensions.first; ++i) {
-                SDL_RenderDrawLine(renderer, 0, i * size_y, width, i * size_y);
-            }
-            
-            // Vertical lines
-            for (int j = 0; j <= grid.dimensions.second; ++j) {
-                SDL_RenderDrawLine(renderer, j * size_x, 0, j * size_x, height);
-            }
+        // Write the texels straight into the streaming texture
+        void* texels;
+        int pitch;
+        if (SDL_LockTexture(texture, nullptr, &texels, &pitch) == 0) {
+            rasterize(static_cast<Uint32*>(texels), pitch / int(sizeof(Uint32)));
+            SDL_UnlockTexture(texture);
+        } else {
+            rasterize(pixels.data(), tex_w);
+            SDL_UpdateTexture(texture, nullptr, pixels.data(), tex_w * sizeof(Uint32));
         }
         
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        SDL_RenderClear(renderer);
+        SDL_Rect dst = {0, 0, width, height};
+        SDL_RenderCopy(renderer, texture, nullptr, &dst);
+        if (grid_texture != nullptr) {
+            SDL_RenderCopy(renderer, grid_texture, nullptr, &dst);
+        }
         SDL_RenderPresent(renderer);
+        ++frame_count;
     }
     
+    // Last frame rendered offscreen, tex_w x tex_h ARGB pixels
+    const std::vector<Uint32>& frame() const { return pixels; }
+    
     Grille& grid;
+    bool offscreen;
+    std::string frame_prefix;
+    long long frame_count = 0;
+    int block_x, block_y;
+    int tex_w, tex_h;
     int size_x;
     int size_y;
     int width;
     int height;
     SDL_Color draw_color;
-    SDL_Window* window;
-    SDL_Renderer* renderer;
+    SDL_Window* window = nullptr;
+    SDL_Renderer* renderer = nullptr;
+    SDL_Texture* texture = nullptr;
+    SDL_Texture* grid_texture = nullptr;
+
+private:
+    // One texel per block_y x block_x cells, `stride` texels between two texel rows
+    void rasterize(Uint32* out, int stride) {
+        const int rows = grid.dimensions_loc.first;
+        const int cols = grid.dimensions_loc.second;
+        for (int ty = 0; ty < tex_h; ++ty) {
+            std::fill(counts.begin(), counts.end(), 0);
+            int i_end = std::min(rows, (ty + 1) * block_y);
+            for (int i = ty * block_y; i < i_end; ++i) {
+                const unsigned char* row = grid.row(i);
+                if (block_x == 1) {
+                    for (int j = 0; j < cols; ++j) counts[j] += row[j];
+                } else {
+                    for (int tx = 0; tx < tex_w; ++tx) {
+                        int j_end = std::min(cols, (tx + 1) * block_x), sum = 0;
+                        for (int j = tx * block_x; j < j_end; ++j) sum += row[j];
+                        counts[tx] += sum;
+                    }
+                }
+            }
+            int area_y = i_end - ty * block_y;
+            Uint32* line = out + size_t(ty) * stride;
+            for (int tx = 0; tx < tex_w; ++tx) {
+                int area = area_y * (std::min(cols, (tx + 1) * block_x) - tx * block_x);
+                line[tx] = palette[counts[tx] * 255 / area];
+            }
+        }
+    }
+    
+    void save_frame() const {
+        std::ostringstream name;
+        name << frame_prefix << std::setfill('0') << std::setw(5) << frame_count << ".ppm";
+        std::ofstream out(name.str(), std::ios::binary);
+        out << "P6\n" << tex_w << " " << tex_h << "\n255\n";
+        std::vector<unsigned char> rgb(3 * pixels.size());
+        for (size_t k = 0; k < pixels.size(); ++k) {
+            rgb[3 * k] = (pixels[k] >> 16) & 0xFF;
+            rgb[3 * k + 1] = (pixels[k] >> 8) & 0xFF;
+            rgb[3 * k + 2] = pixels[k] & 0xFF;
+        }
+        out.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+    }
+    
+    Uint32 palette[256];
+    std::vector<Uint32> pixels;
+    std::vector<int> counts;
 };
+#endif
 
 int main(int argc, char* argv[]) {
     MPI_Init(&argc, &argv);
@@ -241,18 +227,6 @@ int main(int argc, char* argv[]) {
     MPI_Comm_rank(globCom, &rank);
     MPI_Comm_size(globCom, &nbp);
     
-    // Split communicator for worker processes
-    int color = (rank != 0) ? 1 : 0;
-    MPI_Comm newCom;
-    MPI_Comm_split(globCom, color, rank, &newCom);
-    
-    int local_rank = 0, local_size = 0;
-    MPI_Comm_rank(newCom, &local_rank);
-    MPI_Comm_size(newCom, &local_size);
-    
-    std::cout << "rang global : " << rank << ", rang local : " << local_rank 
-              << ", nb de processus locaux : " << local_size << std::endl;
-    
     // Define patterns
     std::map<std::string, std::pair<std::pair<int, int>, std::vector<std::pair<int, int>>>> dico_patterns = {
         {"blinker", {std::make_pair(5, 5), {{2, 1}, {2, 2}, {2, 3}}}},
@@ -276,160 +250,355 @@ int main(int argc, char* argv[]) {
         {"flat", {std::make_pair(200, 400), {{80, 200}, {81, 200}, {82, 200}, {83, 200}, {84, 200}, {85, 200}, {86, 200}, {87, 200}, {89, 200}, {90, 200}, {91, 200}, {92, 200}, {93, 200}, {97, 200}, {98, 200}, {99, 200}, {106, 200}, {107, 200}, {108, 200}, {109, 200}, {110, 200}, {111, 200}, {112, 200}, {114, 200}, {115, 200}, {116, 200}, {117, 200}, {118, 200}}}}
     };
     
-    // Parse command line arguments
-    std::string choice = "glider";
-    if (argc > 1) {
-        choice = argv[1];
-    }
     
+    // Parse command line arguments :
+    //   game_of_life.exe [pattern | file.rle | file.cells] [resx resy] [options]
+    //     --grid RxC             grid dimensions when loading a pattern file
+    //     --restart file         restart from a checkpoint (possibly written with another number of processes)
+    //     --checkpoint file      checkpoint written during the run and when leaving
+    //     --checkpoint-every N   generations between two checkpoints
+    //     --frames N             stop after N displayed frames
+    //     --offscreen            render without window (display timing only)
+    //     --frames-out prefix    offscreen, and save every frame as prefixNNNNN.ppm
+    //     --random RxC           random grid of R rows and C columns
+    //     --rule rule            B/S rule ("B36/S23") or Larger than Life rule ("R5,C0,M1,S34..58,B34..45,NM")
+    //     --bench N              headless benchmark of N generations, every process is a worker
+    //     --gather-every K       benchmark : gather the grid every K generations (0 : never)
+    //     --json                 benchmark : JSON report
+    //     --balance-every K      measure the load every K generations and move the stripe boundaries
+    //     --balance-threshold x  rebalance when max/mean of the compute time exceeds x (default 1.1)
+    //     --row-blocks N         compute the stripe by blocks of N rows shared among the OpenMP threads
+    //     --pool                 ... among the workers of a work-stealing thread pool (POOL_NUM_THREADS)
+    //     --shared-halo          processes of a node share their stripes (MPI shared windows) instead of
+    //                            exchanging messages for the ghost rows
+    std::string choice = "glider";
     int resx = 800;
     int resy = 800;
-    if (argc > 3) {
-        resx = std::stoi(argv[2]);
-        resy = std::stoi(argv[3]);
+    std::pair<int, int> grid_dims = {0, 0};
+    std::string restart_file, checkpoint_file;
+    long long checkpoint_every = 0;
+    long long max_frames = 0;
+    bool offscreen = false;
+    std::string frame_prefix;
+    std::pair<int, int> random_dims = {0, 0};
+    std::string rule_option;
+    bool bench = false;
+    int row_blocks = 0;
+    bool use_pool = false;
+    bool shared_halo = false;
+    BenchOptions bench_options;
+    std::vector<std::string> positional;
+    auto parse_dims = [](const std::string& value) {
+        auto x = value.find('x');
+        return std::make_pair(std::stoi(value.substr(0, x)), std::stoi(value.substr(x + 1)));
+    };
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a];
+        if (arg == "--grid" && a + 1 < argc) {
+            grid_dims = parse_dims(argv[++a]);
+        } else if (arg == "--rule" && a + 1 < argc) {
+            rule_option = argv[++a];
+        } else if (arg == "--random" && a + 1 < argc) {
+            random_dims = parse_dims(argv[++a]);
+        } else if (arg == "--bench" && a + 1 < argc) {
+            bench = true;
+            bench_options.generations = std::stoll(argv[++a]);
+        } else if (arg == "--gather-every" && a + 1 < argc) {
+            bench_options.gather_every = std::stoll(argv[++a]);
+        } else if (arg == "--json") {
+            bench_options.json = true;
+            bench_options.balance.log = false;
+        } else if (arg == "--balance-every" && a + 1 < argc) {
+            bench_options.balance.every = std::stoll(argv[++a]);
+        } else if (arg == "--balance-threshold" && a + 1 < argc) {
+            bench_options.balance.threshold = std::stod(argv[++a]);
+        } else if (arg == "--row-blocks" && a + 1 < argc) {
+            row_blocks = std::stoi(argv[++a]);
+        } else if (arg == "--pool") {
+            use_pool = true;
+        } else if (arg == "--shared-halo") {
+            shared_halo = true;
+        } else if (arg == "--restart" && a + 1 < argc) {
+            restart_file = argv[++a];
+        } else if (arg == "--checkpoint" && a + 1 < argc) {
+            checkpoint_file = argv[++a];
+        } else if (arg == "--checkpoint-every" && a + 1 < argc) {
+            checkpoint_every = std::stoll(argv[++a]);
+        } else if (arg == "--frames" && a + 1 < argc) {
+            max_frames = std::stoll(argv[++a]);
+        } else if (arg == "--offscreen") {
+            offscreen = true;
+        } else if (arg == "--frames-out" && a + 1 < argc) {
+            offscreen = true;
+            frame_prefix = argv[++a];
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.size() > 0) {
+        choice = positional[0];
+    }
+    if (positional.size() > 2) {
+        resx = std::stoi(positional[1]);
+        resy = std::stoi(positional[2]);
     }
     
-    if (rank == 0) {
-        std::cout << "Pattern initial choisi : " << choice << std::endl;
+#if defined(NO_SDL)
+    (void)max_frames;
+    (void)offscreen;
+    if (!bench) {
+        if (rank == 0) {
+            std::cout << "Compiled without SDL : only the benchmark mode (--bench N) is available" << std::endl;
+        }
+        MPI_Finalize();
+        return 1;
+    }
+#endif
+    
+    // Split communicator for worker processes (the benchmark has no display process)
+    bool display = (rank == 0 && !bench);
+    int color = display ? 0 : 1;
+    MPI_Comm newCom;
+    MPI_Comm_split(globCom, color, rank, &newCom);
+    
+    int local_rank = 0, local_size = 0;
+    MPI_Comm_rank(newCom, &local_rank);
+    MPI_Comm_size(newCom, &local_size);
+    
+    if (!bench) {
+        std::cout << "rang global : " << rank << ", rang local : " << local_rank 
+                  << ", nb de processus locaux : " << local_size << std::endl;
+    }
+    
+    if (rank == 0 && !bench) {
+        std::cout << "Pattern initial choisi : " << (restart_file.empty() ? choice : restart_file) << std::endl;
         std::cout << "resolution ecran : " << resx << ", " << resy << std::endl;
     }
     
-    // Check if pattern exists
-    if (dico_patterns.find(choice) == dico_patterns.end()) {
-        if (rank == 0) {
-            std::cout << "No such pattern. Available ones are: ";
+    // Initial state : checkpoint, pattern file (read by the workers) or built-in pattern
+    std::pair<int, int> dims = {0, 0};
+    Pattern init_cells;
+    long long generation = 0;
+    std::string rule = "B3/S23";
+    Rule parsed_rule;
+    std::string error;
+    try {
+        if (random_dims.first > 0 && random_dims.second > 0) {
+            dims = random_dims;
+        } else if (!restart_file.empty()) {
+            CheckpointHeader header = read_checkpoint_header(restart_file, globCom);
+            dims = {int(header.rows), int(header.cols)};
+            generation = header.generation;
+            rule = header.rule;
+        } else if (is_pattern_file(choice)) {
+            if (!display) {
+                LoadedPattern loaded = load_pattern(choice, newCom, grid_dims);
+                dims = loaded.dimensions;
+                rule = loaded.rule;
+                init_cells = std::move(loaded.local_cells);
+            }
+        } else if (dico_patterns.find(choice) != dico_patterns.end()) {
+            dims = dico_patterns[choice].first;
+            init_cells = dico_patterns[choice].second;
+        } else {
+            error = "No such pattern. Available ones are: ";
             for (const auto& p : dico_patterns) {
-                std::cout << p.first << " ";
+                error += p.first + " ";
             }
-            std::cout << std::endl;
+        }
+        // The rule given on the command line wins over the one of the file
+        if (!rule_option.empty()) {
+            rule = rule_option;
+        }
+        parsed_rule = parse_rule(rule);
+        rule = parsed_rule.name();
+        // Ghost rows only come from the direct neighbours
+        if (error.empty() && !display) {
+            if (stripe_size(local_size - 1, local_size, dims.first) < parsed_rule.radius) {
+                error = "Too many processes for rule " + rule + " : every stripe needs at least "
+                      + std::to_string(parsed_rule.radius) + " rows";
+            } else if (dims.second <= 2 * parsed_rule.radius) {
+                error = "Grid too narrow for rule " + rule;
+            }
+        }
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    
+    // The display process only needs the dimensions (0 when the workers failed)
+    int first_worker = bench ? 0 : 1;
+    int dims_glob[2] = {error.empty() ? dims.first : 0, error.empty() ? dims.second : 0};
+    MPI_Bcast(dims_glob, 2, MPI_INT, first_worker, globCom);
+    if (dims_glob[0] <= 0) {
+        if (rank == first_worker) {
+            std::cout << error << std::endl;
         }
         MPI_Finalize();
         return 1;
     }
+    dims = {dims_glob[0], dims_glob[1]};
     
-    auto pattern = dico_patterns[choice];
-    
-    if (rank == 0) {
+    if (display) {
+#if !defined(NO_SDL)
         // Display process
-        SDL_Init(SDL_INIT_VIDEO);
-        Grille grid(0, 1, pattern.first, &pattern.second);
-        App app(std::make_pair(resx, resy), grid);
+        Pattern no_cells;
+        Grille grid(0, 1, dims, &no_cells);
+        App app(std::make_pair(resx, resy), grid, offscreen, frame_prefix);
         
         bool loop = true;
         while (loop) {
             int signal = 1;
             MPI_Send(&signal, 1, MPI_INT, 1, 0, globCom);
             
-            std::vector<unsigned char> global_cells(pattern.first.first * pattern.first.second);
+            std::vector<unsigned char> global_cells(dims.first * dims.second);
             MPI_Recv(global_cells.data(), global_cells.size(), MPI_UNSIGNED_CHAR, 1, 0, globCom, MPI_STATUS_IGNORE);
             
             // Convert received data to 2D array
-            for (int i = 0; i < pattern.first.first; ++i) {
-                for (int j = 0; j < pattern.first.second; ++j) {
-                    grid.cells[i+1][j] = global_cells[i * pattern.first.second + j];
-                }
+            for (int i = 0; i < dims.first; ++i) {
+                std::copy_n(global_cells.data() + size_t(i) * dims.second, dims.second, grid.row(i));
             }
             
-            auto t2 = std::chrono::high_resolution_clock::now();
+            // Reported in the "affichage" region at the end, not per frame
+            INSTR_BEGIN("affichage");
             app.draw();
-            auto t3 = std::chrono::high_resolution_clock::now();
+            INSTR_END("affichage");
             
+            bool quit = (max_frames > 0 && app.frame_count >= max_frames);
             SDL_Event event;
-            while (SDL_PollEvent(&event)) {
+            while (!offscreen && SDL_PollEvent(&event)) {
                 if (event.type == SDL_QUIT) {
-                    loop = false;
-                    signal = -1;
-                    MPI_Send(&signal, 1, MPI_INT, 1, 0, globCom);
+                    quit = true;
                 }
             }
-            
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count() / 1000000.0;
-            std::cout << "Temps affichage : " << duration << " secondes" << std::endl;
+            if (quit) {
+                loop = false;
+                signal = -1;
+                MPI_Send(&signal, 1, MPI_INT, 1, 0, globCom);
+            }
         }
-        
-        SDL_Quit();
+#endif
     } else {
-        // Worker process
-        Grille grid(local_rank, local_size, pattern.first, &pattern.second);
+        // Worker process (random_dims : random initialization)
+        Grille grid(local_rank, local_size, dims, random_dims.first > 0 ? nullptr : &init_cells, parsed_rule);
+        std::unique_ptr<ThreadPool> pool;
+        if (use_pool) {
+            pool.reset(new ThreadPool);
+            if (row_blocks <= 0) row_blocks = 64;
+        }
+        grid.set_row_blocks(row_blocks, pool.get());
+        if (shared_halo) {
+            grid.use_shared_halo(newCom);
+        }
+        if (!restart_file.empty()) {
+            read_checkpoint(restart_file, grid, newCom);
+        }
+        if (bench) {
+            run_bench(grid, bench_options, newCom);
+            grid.free_halo();
+            INSTR_REPORT_MPI(globCom);
+            MPI_Finalize();
+            return 0;
+        }
         grid.update_ghost_cells(newCom);
         
-        if (local_rank == 0) {
+        if (local_rank == 0 && dims.second <= 100) {
             std::cout << "rank loc : " << local_rank << ", cells locales : " << std::endl;
-            for (int i = 0; i < grid.cells.size(); ++i) {
-                for (int j = 0; j < grid.cells[0].size(); ++j) {
-                    std::cout << (int)grid.cells[i][j] << " ";
+            for (int i = -grid.halo; i < grid.dimensions_loc.first + grid.halo; ++i) {
+                for (int j = 0; j < grid.dimensions_loc.second; ++j) {
+                    std::cout << (int)grid.row(i)[j] << " ";
                 }
                 std::cout << std::endl;
             }
         }
         
-        // Gather the cell counts from all processes
-        std::vector<int> sendcounts;
-        if (local_rank == 0) {
-            sendcounts.resize(local_size);
-        }
-        
-        int local_cell_count = grid.cells.size() * grid.cells[0].size() - 2 * grid.cells[0].size(); // Exclude ghost cells
-        MPI_Gather(&local_cell_count, 1, MPI_INT, sendcounts.data(), 1, MPI_INT, 0, newCom);
-        
         // Create global grid buffer for rank 0 of newCom
         std::vector<unsigned char> grid_glob;
         if (local_rank == 0) {
-            grid_glob.resize(pattern.first.first * pattern.first.second);
+            grid_glob.resize(dims.first * dims.second);
         }
         
-        // Create flattened cell array (excluding ghost cells) for gathering
+        // Gather the cell counts from all processes, prepare the displacements for
+        // MPI_Gatherv and the flattened cell array (excluding ghost cells).
+        // Done again each time the load balancer moves the stripes.
+        std::vector<int> sendcounts, displs;
         std::vector<unsigned char> flat_cells;
-        for (int i = 1; i <= grid.dimensions_loc.first; ++i) {
-            for (int j = 0; j < grid.dimensions_loc.second; ++j) {
-                flat_cells.push_back(grid.cells[i][j]);
+        auto setup_gather = [&]() {
+            if (local_rank == 0) {
+                sendcounts.resize(local_size);
+                displs.resize(local_size);
             }
-        }
-        
-        // Prepare displacement array for MPI_Gatherv
-        std::vector<int> displs;
-        if (local_rank == 0) {
-            displs.resize(local_size);
-            int disp = 0;
-            for (int i = 0; i < local_size; ++i) {
-                displs[i] = disp;
-                disp += sendcounts[i];
+            int local_cell_count = grid.dimensions_loc.first * grid.dimensions_loc.second;
+            MPI_Gather(&local_cell_count, 1, MPI_INT, sendcounts.data(), 1, MPI_INT, 0, newCom);
+            if (local_rank == 0) {
+                int disp = 0;
+                for (int i = 0; i < local_size; ++i) {
+                    displs[i] = disp;
+                    disp += sendcounts[i];
+                }
             }
-        }
+            flat_cells.resize(local_cell_count);
+        };
+        setup_gather();
         
-        bool loop = true;
+        LoadBalancer balancer(bench_options.balance);
+        double compute_since_checkpoint = 0.;
+        int loop = 1;
         while (loop) {
             // Optional sleep to limit frame rate
             // std::this_thread::sleep_for(std::chrono::milliseconds(100));
             
-            auto t1 = std::chrono::high_resolution_clock::now();
+            // Per generation times go to the "calcul" and "halo" regions, reported at the end
+            double t1 = instr_wtime();
             grid.compute_next_iteration();
+            ++generation;
+            double step_time = instr_wtime() - t1;
+            if (balancer.update(grid, step_time, generation, newCom)) {
+                setup_gather();
+            }
             grid.update_ghost_cells(newCom);
-            auto t2 = std::chrono::high_resolution_clock::now();
+            compute_since_checkpoint += instr_wtime() - t1;
             
             // Gather data from all processes to rank 0 of newCom
+            INSTR_BEGIN("gather");
+            for (int i = 0; i < grid.dimensions_loc.first; ++i) {
+                std::copy_n(grid.row(i), grid.dimensions_loc.second,
+                            flat_cells.begin() + size_t(i) * grid.dimensions_loc.second);
+            }
             MPI_Gatherv(flat_cells.data(), flat_cells.size(), MPI_UNSIGNED_CHAR,
                       grid_glob.data(), sendcounts.data(), displs.data(),
                       MPI_UNSIGNED_CHAR, 0, newCom);
+            INSTR_END("gather");
             
             // Process 0 of newCom communicates with display process
             if (local_rank == 0) {
-                int signal = 0;
-                if (MPI_Iprobe(0, 0, globCom, &signal, MPI_STATUS_IGNORE) && signal) {
+                int flag = 0, signal = 0;
+                MPI_Iprobe(0, 0, globCom, &flag, MPI_STATUS_IGNORE);
+                if (flag) {
                     MPI_Recv(&signal, 1, MPI_INT, 0, 0, globCom, MPI_STATUS_IGNORE);
                     if (signal == -1) {
-                        loop = false;
+                        loop = 0;
                     } else {
                         MPI_Send(grid_glob.data(), grid_glob.size(), MPI_UNSIGNED_CHAR, 0, 0, globCom);
                     }
                 }
             }
+            // Every worker must leave the loop together (collective checkpoints)
+            MPI_Bcast(&loop, 1, MPI_INT, 0, newCom);
             
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() / 1000000.0;
-            std::cout << "Temps calcul prochaine generation : " << duration << " secondes" << std::endl;
+            bool checkpoint_due = (checkpoint_every > 0 && generation % checkpoint_every == 0) || !loop;
+            if (!checkpoint_file.empty() && checkpoint_due) {
+                double t_ckpt = write_checkpoint(checkpoint_file, grid, generation, rule, newCom);
+                if (local_rank == 0) {
+                    std::cout << "Checkpoint generation " << generation << " : " << t_ckpt << " secondes ("
+                              << 100. * t_ckpt / std::max(compute_since_checkpoint, 1.E-9)
+                              << "% du temps de calcul)" << std::endl;
+                }
+                compute_since_checkpoint = 0.;
+            }
         }
     }
     
+    INSTR_REPORT_MPI(globCom);
     MPI_Finalize();
     return 0;
-}
\ No newline at end of file
+}
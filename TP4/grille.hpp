@@ -0,0 +1,527 @@
+#ifndef _GRILLE_HPP_
+#define _GRILLE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <mpi.h>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+#include "instrument.h"
+#include "thread_pool.hpp"
+#include "rules.hpp"
+
+// Type for a cell position
+using Position = std::pair<int, int>;
+// Type for a pattern (list of positions)
+using Pattern = std::vector<Position>;
+
+// RGBA color of the cells (same layout as SDL_Color, without depending on SDL)
+struct Color {
+    std::uint8_t r, g, b, a;
+};
+
+// Row-stripe decomposition of `nrows` rows over `nbp` processes: the first
+// `nrows % nbp` processes get one extra row.
+inline int stripe_size(int rank, int nbp, int nrows) {
+    return nrows / nbp + (rank < nrows % nbp ? 1 : 0);
+}
+
+inline int stripe_start(int rank, int nbp, int nrows) {
+    return rank * (nrows / nbp) + (rank >= nrows % nbp ? nrows % nbp : rank);
+}
+
+// Rank owning global row `row` in the decomposition above
+inline int stripe_owner(int row, int nbp, int nrows) {
+    int q = nrows / nbp, rem = nrows % nbp;
+    if (row < rem * (q + 1)) return row / (q + 1);
+    return rem + (row - rem * (q + 1)) / q;
+}
+
+// How a stripe gets the ghost rows of one side from its neighbour
+enum class HaloLink {
+    message,      // persistent MPI requests (other node, or shared mode off)
+    shared_copy,  // same node : copied from the neighbour's shared segment
+    in_place      // same node, adjacent segments : the ghost rows are the neighbour's rows
+};
+
+// Time spent in update_ghost_cells, by path, summed over the exchanges
+struct HaloTimes {
+    double shared = 0.;   // ghost columns, flags and copies of the shared mode
+    double message = 0.;  // start and completion of the persistent requests
+    long long exchanges = 0;
+};
+
+// Stripe of the torus owned by a process. The cells are stored row after row with
+// `halo` ghost rows above and below (copies of the neighbours' boundary rows) and
+// `halo` ghost columns on both sides (periodic copies of the row ends), `halo`
+// being the radius of the rule. Two buffers hold the current and the next generation.
+//
+// In the shared mode (use_shared_halo) the buffers of the processes of a node are
+// segments of MPI shared windows, laid out in rank order. A stripe whose neighbour
+// is the previous (next) rank on the same node has no ghost rows on that side : its
+// row -1 (rows) is the neighbour's last (first) row, read in place by the kernel.
+// Readiness is published through a counter per process, the windows staying in a
+// passive epoch (MPI_Win_lock_all) synchronised with MPI_Win_sync.
+class Grille {
+public:
+    Grille(int rank, int nbp, std::pair<int, int> dim, const Pattern* init_pattern = nullptr,
+           const Rule& rule = Rule(),
+           Color color_life = {0, 0, 0, 255}, Color color_dead = {255, 255, 255, 255})
+        : dimensions(dim), rule(rule), halo(rule.radius), col_life(color_life), col_dead(color_dead) {
+
+        // Calculate local dimensions for this process
+        dimensions_loc.first = stripe_size(rank, nbp, dim.first);
+        dimensions_loc.second = dim.second;
+
+        // Calculate starting position for this process
+        start_loc = stripe_start(rank, nbp, dim.first);
+
+        // Initialize cells with ghost cells on every side
+        stride = dimensions_loc.second + 2 * halo;
+        allocate(dimensions_loc.first);
+        step = select_step(rule);
+        row_live.assign(dimensions_loc.first + 2 * halo, 0);
+        row_activity.assign(dimensions_loc.first, 0);
+
+        if (init_pattern != nullptr) {
+            // Set initial pattern
+            for (const auto& pos : *init_pattern) {
+                int i = pos.first - start_loc;
+                int j = pos.second;
+                if (i >= 0 && i < dimensions_loc.first) {
+                    row(i)[j] = 1;
+                }
+            }
+        } else {
+            // Random initialization
+            std::random_device rd;
+            std::mt19937 gen(rd());
+            std::uniform_int_distribution<> distrib(0, 1);
+            for (int i = 0; i < dimensions_loc.first; ++i) {
+                for (int j = 0; j < dimensions_loc.second; ++j) {
+                    row(i)[j] = distrib(gen);
+                }
+            }
+        }
+    }
+
+    Grille(const Grille&) = delete;
+    Grille& operator=(const Grille&) = delete;
+
+    ~Grille() {
+        int finalized = 0;
+        MPI_Finalized(&finalized);
+        if (!finalized) free_halo();
+    }
+
+    // Local row i, 0 <= i < dimensions_loc.first (ghost rows for -halo <= i < 0
+    // and dimensions_loc.first <= i < dimensions_loc.first + halo)
+    unsigned char* row(int i) { return origin[current] + std::ptrdiff_t(i) * stride + halo; }
+    const unsigned char* row(int i) const { return origin[current] + std::ptrdiff_t(i) * stride + halo; }
+
+    void compute_next_iteration() {
+        INSTR_SCOPE("calcul");
+        const int rows = dimensions_loc.first;
+        // Periodic ghost columns of every row, ghost rows included. In the shared
+        // mode update_ghost_cells did it : the rows read in place are the neighbours'.
+        if (node_comm == MPI_COMM_NULL) fill_ghost_columns(-halo, rows + halo);
+        // Rows with no live cell within the radius stay empty : the kernel skips them.
+        // The liveness of the interior rows comes from the previous step.
+        const unsigned char* active_rows = nullptr;
+        if (rule.empty_stays_empty()) {
+            if (!live_valid) {
+                for (int i = 0; i < rows; ++i) row_live[i + halo] = any_live(i);
+                live_valid = true;
+            }
+            for (int k = 1; k <= halo; ++k) {
+                row_live[halo - k] = any_live(-k);
+                row_live[halo + rows - 1 + k] = any_live(rows - 1 + k);
+            }
+            active.resize(rows);
+            for (int i = 0; i < rows; ++i) {
+                unsigned char a = 0;
+                for (int k = 0; k <= 2 * halo; ++k) a |= row_live[i + k];
+                active[i] = a;
+                row_activity[i] += a;
+            }
+            active_rows = active.data();
+        } else {
+            for (int i = 0; i < rows; ++i) ++row_activity[i];
+        }
+        unsigned char* out = origin[1 - current] + halo;
+        if (block_rows <= 0) {
+            step(rule, row(0), out, rows, dimensions_loc.second, stride, active_rows, row_live.data() + halo, work);
+        } else {
+            const int nb_blocks = (rows + block_rows - 1) / block_rows;
+            auto compute_block = [&](int b, std::vector<int>& scratch) {
+                const int first = b * block_rows;
+                step(rule, row(first), out + size_t(first) * stride, std::min(block_rows, rows - first),
+                     dimensions_loc.second, stride, active_rows ? active_rows + first : nullptr,
+                     row_live.data() + halo + first, scratch);
+            };
+            if (pool != nullptr) {
+                block_work.resize(pool->size());
+                pool->parallel_for(0, nb_blocks, [&](long b, long e) {
+                    for (long k = b; k < e; ++k) compute_block(int(k), block_work[pool->worker_index()]);
+                }, 1);
+            } else {
+#if defined(_OPENMP)
+                block_work.resize(omp_get_max_threads());
+#pragma omp parallel for schedule(dynamic)
+                for (int k = 0; k < nb_blocks; ++k) compute_block(k, block_work[omp_get_thread_num()]);
+#else
+                block_work.resize(1);
+                for (int k = 0; k < nb_blocks; ++k) compute_block(k, block_work[0]);
+#endif
+            }
+        }
+        current = 1 - current;
+    }
+
+    // The stripe is then computed by blocks of `rows` rows (0 : in one piece) shared
+    // among the workers of `thread_pool`, or among the OpenMP threads if it is null
+    void set_row_blocks(int rows, ThreadPool* thread_pool = nullptr) {
+        block_rows = rows;
+        pool = thread_pool;
+    }
+
+    // To call when the cells were written from outside (restart, ...)
+    void cells_changed() { live_valid = false; }
+
+    // Moves the stripe boundaries : process p now owns the global rows
+    // [starts[p], starts[p+1]). Rows are sent point-to-point from their old owner
+    // to their new one (the neighbours when the boundaries move by less than a
+    // stripe). Collective over `comm`. The ghost rows must be exchanged again.
+    void redistribute(const std::vector<int>& starts, MPI_Comm comm) {
+        INSTR_SCOPE("migration");
+        int rank = 0, size = 0;
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+        std::vector<int> old_starts(size + 1);
+        MPI_Allgather(&start_loc, 1, MPI_INT, old_starts.data(), 1, MPI_INT, comm);
+        old_starts[size] = dimensions.first;
+
+        const int new_start = starts[rank], new_rows = starts[rank + 1] - starts[rank];
+        std::vector<unsigned char> moved(size_t(new_rows + 2 * halo) * stride, 0);
+        auto old_row = [&](int g) { return row(g - start_loc) - halo; };
+        auto new_row = [&](int g) { return moved.data() + size_t(g - new_start + halo) * stride; };
+
+        MPI_Datatype row_type;
+        MPI_Type_contiguous(stride, MPI_UNSIGNED_CHAR, &row_type);
+        MPI_Type_commit(&row_type);
+        std::vector<MPI_Request> requests;
+        for (int p = 0; p < size; ++p) {
+            // Rows I receive from p, rows I send to p
+            int recv_lo = std::max(new_start, old_starts[p]);
+            int recv_hi = std::min(new_start + new_rows, old_starts[p + 1]);
+            int send_lo = std::max(start_loc, starts[p]);
+            int send_hi = std::min(start_loc + dimensions_loc.first, starts[p + 1]);
+            if (p == rank) {
+                if (recv_hi > recv_lo)
+                    std::copy_n(old_row(recv_lo), size_t(recv_hi - recv_lo) * stride, new_row(recv_lo));
+                continue;
+            }
+            if (recv_hi > recv_lo) {
+                requests.emplace_back();
+                MPI_Irecv(new_row(recv_lo), recv_hi - recv_lo, row_type, p, 201, comm, &requests.back());
+            }
+            if (send_hi > send_lo) {
+                requests.emplace_back();
+                MPI_Isend(old_row(send_lo), send_hi - send_lo, row_type, p, 201, comm, &requests.back());
+            }
+        }
+        MPI_Waitall(int(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+        MPI_Type_free(&row_type);
+
+        start_loc = new_start;
+        dimensions_loc.first = new_rows;
+        allocate(new_rows);
+        std::copy_n(moved.data() + size_t(halo) * stride, size_t(new_rows) * stride, row(0) - halo);
+        if (request_comm != MPI_COMM_NULL) setup_requests();
+        row_live.assign(new_rows + 2 * halo, 0);
+        row_activity.assign(new_rows, 0);
+        live_valid = false;
+    }
+
+    // Collective over `comm` : fills the ghost rows from the neighbours, in place or
+    // by copy from the shared segments of the node in the shared mode, through
+    // persistent requests for the other neighbours.
+    void update_ghost_cells(MPI_Comm comm) {
+        INSTR_SCOPE("halo");
+        if (comm != request_comm) connect(comm);
+        const bool shared = node_comm != MPI_COMM_NULL;
+        std::vector<MPI_Request>& pending = requests[current];
+        double t0 = MPI_Wtime();
+        if (shared) {
+            // My rows are complete : publish them to the neighbours of the node
+            fill_ghost_columns(0, dimensions_loc.first);
+            ++exchange_count;
+            MPI_Win_sync(windows[current]);
+            my_flag->store(exchange_count, std::memory_order_release);
+            MPI_Win_sync(flag_window);
+        }
+        double t1 = MPI_Wtime();
+        if (!pending.empty()) MPI_Startall(int(pending.size()), pending.data());
+        double t2 = MPI_Wtime();
+        if (shared) {
+            for (int side = 0; side < 2; ++side) {
+                if (links[side] != HaloLink::message) wait_flag(*neighbour_flags[side]);
+            }
+            MPI_Win_sync(windows[current]);
+            const size_t count = size_t(halo) * stride;
+            if (links[0] == HaloLink::shared_copy) std::memcpy(row(-halo) - halo, neighbour_rows[0][current], count);
+            if (links[1] == HaloLink::shared_copy) {
+                std::memcpy(row(dimensions_loc.first) - halo, neighbour_rows[1][current], count);
+            }
+        }
+        double t3 = MPI_Wtime();
+        if (!pending.empty()) MPI_Waitall(int(pending.size()), pending.data(), MPI_STATUSES_IGNORE);
+        double t4 = MPI_Wtime();
+        timing.shared += (t1 - t0) + (t3 - t2);
+        timing.message += (t2 - t1) + (t4 - t3);
+        ++timing.exchanges;
+    }
+
+    // Collective over `comm` (the communicator of update_ghost_cells) : switches to
+    // the shared mode. The processes of a node (MPI_COMM_TYPE_SHARED) move their
+    // stripes into shared windows; messages remain between nodes.
+    void use_shared_halo(MPI_Comm comm) {
+        if (node_comm != MPI_COMM_NULL) return;
+        connect(comm);
+        int rank = 0, size = 0;
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+        MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node_comm);
+        MPI_Group group, node_group;
+        MPI_Comm_group(comm, &group);
+        MPI_Comm_group(node_comm, &node_group);
+        MPI_Group_translate_ranks(group, 2, neighbours, node_group, node_neighbours);
+        MPI_Group_free(&group);
+        MPI_Group_free(&node_group);
+        // The node ranks follow the ranks of comm : a neighbour of the node is the
+        // adjacent segment, except across the wrap of the torus
+        if (node_neighbours[0] != MPI_UNDEFINED) links[0] = rank > 0 ? HaloLink::in_place : HaloLink::shared_copy;
+        if (node_neighbours[1] != MPI_UNDEFINED) {
+            links[1] = rank < size - 1 ? HaloLink::in_place : HaloLink::shared_copy;
+        }
+
+        // One counter per process, on its own cache line
+        void* flag_memory;
+        MPI_Win_allocate_shared(64, 1, MPI_INFO_NULL, node_comm, &flag_memory, &flag_window);
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, flag_window);
+        my_flag = new (flag_memory) std::atomic<long long>(0);
+        exchange_count = 0;
+        MPI_Win_sync(flag_window);
+        MPI_Barrier(node_comm);
+        for (int side = 0; side < 2; ++side) {
+            if (links[side] == HaloLink::message) continue;
+            MPI_Aint bytes;
+            int unit;
+            void* base;
+            MPI_Win_shared_query(flag_window, node_neighbours[side], &bytes, &unit, &base);
+            neighbour_flags[side] = static_cast<std::atomic<long long>*>(base);
+        }
+
+        std::vector<unsigned char> saved(row(0) - halo, row(dimensions_loc.first) - halo);
+        allocate(dimensions_loc.first);
+        std::copy(saved.begin(), saved.end(), row(0) - halo);
+        setup_requests();
+    }
+
+    // Frees the persistent requests and the shared windows (collective over the
+    // communicator of update_ghost_cells in the shared mode) : to call before
+    // MPI_Finalize if the grid outlives it. The grid is then private again.
+    void free_halo() {
+        free_requests();
+        request_comm = MPI_COMM_NULL;
+        if (node_comm == MPI_COMM_NULL) return;
+        std::vector<unsigned char> saved(row(0) - halo, row(dimensions_loc.first) - halo);
+        free_windows();
+        MPI_Win_unlock_all(flag_window);
+        MPI_Win_free(&flag_window);
+        MPI_Comm_free(&node_comm);
+        links[0] = links[1] = HaloLink::message;
+        allocate(dimensions_loc.first);
+        std::copy(saved.begin(), saved.end(), row(0) - halo);
+    }
+
+    // Side 0 : rows above the stripe, side 1 : rows below
+    HaloLink halo_link(int side) const { return links[side]; }
+    const HaloTimes& halo_times() const { return timing; }
+
+    // Public members
+    std::pair<int, int> dimensions;
+    std::pair<int, int> dimensions_loc;
+    int start_loc;
+    Rule rule;
+    int halo;
+    int stride;
+    Color col_life;
+    Color col_dead;
+    // Number of generations each local row was computed (not skipped) since the
+    // last reset, the load balancer's estimate of the cost of the rows
+    std::vector<int> row_activity;
+
+private:
+    // Both buffers for `rows` local rows, zeroed, the current one being buffer 0.
+    // Collective over the node in the shared mode.
+    void allocate(int rows) {
+        current = 0;
+        if (node_comm == MPI_COMM_NULL) {
+            for (int b = 0; b < 2; ++b) {
+                storage[b].assign(size_t(rows + 2 * halo) * stride, 0);
+                origin[b] = storage[b].data() + size_t(halo) * stride;
+            }
+            return;
+        }
+        free_windows();
+        const int top = links[0] == HaloLink::in_place ? 0 : halo;
+        const int bottom = links[1] == HaloLink::in_place ? 0 : halo;
+        const MPI_Aint bytes = MPI_Aint(top + rows + bottom) * stride;
+        for (int b = 0; b < 2; ++b) {
+            unsigned char* base;
+            MPI_Win_allocate_shared(bytes, 1, MPI_INFO_NULL, node_comm, &base, &windows[b]);
+            MPI_Win_lock_all(MPI_MODE_NOCHECK, windows[b]);
+            std::fill_n(base, bytes, 0);
+            origin[b] = base + size_t(top) * stride;
+            // The segments are contiguous in the order of the node ranks. A copy
+            // neighbour has ghost rows on our side (the links are symmetric).
+            for (int side = 0; side < 2; ++side) {
+                if (links[side] == HaloLink::message) continue;
+                MPI_Aint neighbour_bytes;
+                int unit;
+                unsigned char* neighbour;
+                MPI_Win_shared_query(windows[b], node_neighbours[side], &neighbour_bytes, &unit, &neighbour);
+                if (links[side] == HaloLink::in_place) {
+                    unsigned char* adjacent = side == 0 ? neighbour + neighbour_bytes : neighbour;
+                    if (adjacent != (side == 0 ? base : base + bytes)) {
+                        throw std::runtime_error("Grille : shared segments of the node are not contiguous");
+                    }
+                } else {
+                    neighbour_rows[side][b] = side == 0 ? neighbour + neighbour_bytes - size_t(2 * halo) * stride
+                                                        : neighbour + size_t(halo) * stride;
+                }
+            }
+        }
+        storage[0].clear();
+        storage[1].clear();
+        MPI_Barrier(node_comm);  // every segment zeroed before the first exchange
+    }
+
+    void free_windows() {
+        for (MPI_Win& window : windows) {
+            if (window == MPI_WIN_NULL) continue;
+            MPI_Win_unlock_all(window);
+            MPI_Win_free(&window);
+        }
+    }
+
+    // Neighbours in `comm`, every link through messages
+    void connect(MPI_Comm comm) {
+        free_requests();
+        int rank = 0, size = 0;
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+        neighbours[0] = (rank + size - 1) % size;
+        neighbours[1] = (rank + 1) % size;
+        request_comm = comm;
+        setup_requests();
+    }
+
+    // Persistent requests of the message links, for both buffers : my first rows
+    // go to the previous process, my last rows to the next one, their boundary
+    // rows come into my ghost rows
+    void setup_requests() {
+        free_requests();
+        const int count = halo * stride;
+        const int rows = dimensions_loc.first;
+        for (int b = 0; b < 2; ++b) {
+            unsigned char* first = origin[b];
+            auto add = [&](bool send, unsigned char* buffer, int neighbour, int tag) {
+                requests[b].emplace_back();
+                if (send) {
+                    MPI_Send_init(buffer, count, MPI_UNSIGNED_CHAR, neighbour, tag, request_comm, &requests[b].back());
+                } else {
+                    MPI_Recv_init(buffer, count, MPI_UNSIGNED_CHAR, neighbour, tag, request_comm, &requests[b].back());
+                }
+            };
+            if (links[0] == HaloLink::message) add(false, first - size_t(halo) * stride, neighbours[0], 102);
+            if (links[1] == HaloLink::message) add(false, first + size_t(rows) * stride, neighbours[1], 101);
+            if (links[0] == HaloLink::message) add(true, first, neighbours[0], 101);
+            if (links[1] == HaloLink::message) add(true, first + size_t(rows - halo) * stride, neighbours[1], 102);
+        }
+    }
+
+    void free_requests() {
+        for (auto& buffer_requests : requests) {
+            for (MPI_Request& request : buffer_requests) MPI_Request_free(&request);
+            buffer_requests.clear();
+        }
+    }
+
+    // Spins a little, then yields the processor : the node may be oversubscribed
+    void wait_flag(const std::atomic<long long>& flag) const {
+        for (int spins = 0; flag.load(std::memory_order_acquire) < exchange_count; ++spins) {
+            MPI_Win_sync(flag_window);
+            if (spins >= 64) std::this_thread::yield();
+        }
+    }
+
+    // Periodic ghost columns of the rows [first, last)
+    void fill_ghost_columns(int first, int last) {
+        for (int i = first; i < last; ++i) {
+            unsigned char* r = row(i);
+            for (int k = 1; k <= halo; ++k) {
+                r[-k] = r[dimensions_loc.second - k];
+                r[dimensions_loc.second - 1 + k] = r[k - 1];
+            }
+        }
+    }
+
+    bool any_live(int i) const {
+        const unsigned char* r = row(i);
+        unsigned char any = 0;
+        for (int j = 0; j < dimensions_loc.second; ++j) any |= r[j];
+        return any != 0;
+    }
+
+    // Buffers of the current and next generations : cell (0, -halo) of both, the
+    // rows being in `storage` or, in the shared mode, in `windows`
+    unsigned char* origin[2] = {nullptr, nullptr};
+    int current = 0;
+    std::vector<unsigned char> storage[2];
+    // Halo exchange : neighbours above and below in request_comm, and how their
+    // rows come (node_neighbours : their ranks in node_comm)
+    MPI_Comm request_comm = MPI_COMM_NULL;
+    int neighbours[2] = {0, 0};
+    HaloLink links[2] = {HaloLink::message, HaloLink::message};
+    std::vector<MPI_Request> requests[2];  // persistent requests for each buffer
+    MPI_Comm node_comm = MPI_COMM_NULL;
+    int node_neighbours[2] = {MPI_UNDEFINED, MPI_UNDEFINED};
+    MPI_Win windows[2] = {MPI_WIN_NULL, MPI_WIN_NULL};
+    const unsigned char* neighbour_rows[2][2] = {{nullptr, nullptr}, {nullptr, nullptr}};  // [side][buffer]
+    MPI_Win flag_window = MPI_WIN_NULL;
+    std::atomic<long long>* my_flag = nullptr;  // number of my published exchanges
+    const std::atomic<long long>* neighbour_flags[2] = {nullptr, nullptr};
+    long long exchange_count = 0;
+    HaloTimes timing;
+    std::vector<int> work;
+    int block_rows = 0;
+    ThreadPool* pool = nullptr;
+    std::vector<std::vector<int>> block_work;  // scratch of every thread
+    StepFunction step;
+    std::vector<unsigned char> row_live;  // row i + halo has a live cell, ghost rows included
+    std::vector<unsigned char> active;
+    bool live_valid = false;
+};
+
+#endif
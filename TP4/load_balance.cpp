@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <cstdio>
+#include "load_balance.hpp"
+
+std::vector<int> balanced_starts(const std::vector<double>& costs, int nbp, int min_rows) {
+    const int nrows = int(costs.size());
+    std::vector<double> prefix(nrows + 1, 0.);
+    for (int i = 0; i < nrows; ++i) prefix[i + 1] = prefix[i] + costs[i];
+
+    std::vector<int> starts(nbp + 1);
+    starts[0] = 0;
+    starts[nbp] = nrows;
+    for (int p = 1; p < nbp; ++p) {
+        // Row boundary whose prefix sum is the nearest to p/nbp of the total
+        double target = prefix[nrows] * p / nbp;
+        int r = int(std::lower_bound(prefix.begin(), prefix.end(), target) - prefix.begin());
+        if (r > 0 && target - prefix[r - 1] < prefix[r] - target) --r;
+        r = std::max(r, starts[p - 1] + min_rows);
+        r = std::min(r, nrows - (nbp - p) * min_rows);
+        starts[p] = r;
+    }
+    return starts;
+}
+
+bool LoadBalancer::update(Grille& grid, double compute_time, long long generation, MPI_Comm comm) {
+    accumulated += compute_time;
+    ++measured_generations;
+    if (options.every <= 0 || generation % options.every != 0) return false;
+    INSTR_SCOPE("equilibrage");
+
+    int rank, nbp;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nbp);
+
+    double tmax, tsum;
+    MPI_Allreduce(&accumulated, &tmax, 1, MPI_DOUBLE, MPI_MAX, comm);
+    MPI_Allreduce(&accumulated, &tsum, 1, MPI_DOUBLE, MPI_SUM, comm);
+    imbalance = tsum > 0. ? tmax * nbp / tsum : 1.;
+    if (just_rebalanced && options.log && rank == 0) {
+        std::printf("Desequilibre apres reequilibrage (generation %lld) : %.3f\n", generation, imbalance);
+        std::fflush(stdout);
+    }
+    just_rebalanced = false;
+
+    bool moved = false;
+    if (nbp > 1 && imbalance > options.threshold) {
+        // Cost of my rows : my compute time shared in proportion of the row activity
+        const int rows_loc = grid.dimensions_loc.first;
+        std::vector<double> local_costs(rows_loc);
+        double weight_sum = 0.;
+        for (int i = 0; i < rows_loc; ++i) {
+            local_costs[i] = grid.row_activity[i] + options.idle_row_cost * measured_generations;
+            weight_sum += local_costs[i];
+        }
+        for (double& c : local_costs) c *= accumulated / weight_sum;
+
+        std::vector<int> counts(nbp), displs(nbp, 0);
+        MPI_Allgather(&rows_loc, 1, MPI_INT, counts.data(), 1, MPI_INT, comm);
+        for (int p = 1; p < nbp; ++p) displs[p] = displs[p - 1] + counts[p - 1];
+        std::vector<double> costs(grid.dimensions.first);
+        MPI_Allgatherv(local_costs.data(), rows_loc, MPI_DOUBLE, costs.data(), counts.data(), displs.data(),
+                       MPI_DOUBLE, comm);
+
+        // Every process computes the same boundaries
+        std::vector<int> starts = balanced_starts(costs, nbp, grid.halo);
+        double predicted_max = 0.;
+        for (int p = 0; p < nbp; ++p) {
+            double sum = 0.;
+            for (int i = starts[p]; i < starts[p + 1]; ++i) sum += costs[i];
+            predicted_max = std::max(predicted_max, sum);
+        }
+        // Hysteresis : moving rows costs communications, only do it for a real gain
+        if (predicted_max < (1. - options.min_gain) * tmax) {
+            grid.redistribute(starts, comm);
+            moved = true;
+            just_rebalanced = true;
+            ++nb_rebalances;
+            if (options.log && rank == 0) {
+                std::printf("Reequilibrage generation %lld : desequilibre %.3f -> %.3f (prevu), lignes par processus :",
+                            generation, imbalance, predicted_max * nbp / tsum);
+                for (int p = 0; p < nbp; ++p) std::printf(" %d", starts[p + 1] - starts[p]);
+                std::printf("\n");
+                std::fflush(stdout);
+            }
+        }
+    }
+
+    accumulated = 0.;
+    measured_generations = 0;
+    std::fill(grid.row_activity.begin(), grid.row_activity.end(), 0);
+    return moved;
+}
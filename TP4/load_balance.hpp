@@ -0,0 +1,46 @@
+#ifndef _LOAD_BALANCE_HPP_
+#define _LOAD_BALANCE_HPP_
+
+#include <vector>
+#include <mpi.h>
+#include "grille.hpp"
+
+// Dynamic load balancing of the row stripes : the compute time of every process
+// is measured over `every` generations and spread over its rows in proportion
+// of their activity (rows far from any live cell are skipped by the kernel).
+// The new boundaries cut the prefix sums of these row costs in equal parts.
+struct BalanceOptions {
+    long long every = 0;          // generations between two measurements (0 : no balancing)
+    double threshold = 1.10;      // rebalance only if max/mean of the compute time exceeds it
+    double min_gain = 0.05;       // ... and if the predicted max time drops by this fraction
+    double idle_row_cost = 0.05;  // cost of a skipped row relative to a computed one
+    bool log = true;              // print the rebalance events on process 0
+};
+
+class LoadBalancer {
+public:
+    explicit LoadBalancer(const BalanceOptions& options) : options(options) {}
+
+    // To call by every process of `comm` after each generation with its compute
+    // time. Collective every options.every generations. Returns true if the stripes
+    // moved : the ghost rows and the gather counts must then be updated.
+    bool update(Grille& grid, double compute_time, long long generation, MPI_Comm comm);
+
+    double last_imbalance() const { return imbalance; }  // max/mean of the last measurement
+    int rebalances() const { return nb_rebalances; }
+
+private:
+    BalanceOptions options;
+    double accumulated = 0.;
+    long long measured_generations = 0;
+    double imbalance = 1.;
+    int nb_rebalances = 0;
+    bool just_rebalanced = false;
+};
+
+// Boundaries cutting `costs` (one per global row) in `nbp` parts of about equal
+// sum, each part having at least `min_rows` rows. starts[p] is the first row of
+// part p, starts[nbp] the number of rows.
+std::vector<int> balanced_starts(const std::vector<double>& costs, int nbp, int min_rows);
+
+#endif
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "pattern_io.hpp"
+
+namespace {
+enum class Format { rle, plaintext };
+
+// Header read by process 0 and broadcast to the others
+struct Header {
+    int ok;
+    int format;
+    long long body_offset;
+    int box_rows, box_cols;  // from the RLE "x = .., y = .." line, 0 for plaintext
+    char rule[64];
+    char error[192];
+};
+
+// A run count never needs more than this many digits: the last token starting
+// in my byte range is decoded by reading at most that far past the range.
+const long long lookahead = 32;
+
+bool ends_with(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+Header read_header(const std::string& filename) {
+    Header h;
+    std::memset(&h, 0, sizeof(h));
+    std::strcpy(h.rule, "B3/S23");
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+        std::snprintf(h.error, sizeof(h.error), "cannot open pattern file %s", filename.c_str());
+        return h;
+    }
+    h.format = int(ends_with(filename, ".rle") ? Format::rle : Format::plaintext);
+    std::string line;
+    long long offset = 0;
+    while (std::getline(in, line)) {
+        long long next = offset + line.size() + 1;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#' || line[0] == '!') {
+            offset = next;
+            continue;
+        }
+        std::string trimmed = line;
+        trimmed.erase(std::remove_if(trimmed.begin(), trimmed.end(), ::isspace), trimmed.end());
+        if (trimmed.compare(0, 2, "x=") == 0) {
+            // RLE header line : x = <cols>, y = <rows>[, rule = <rule>]
+            h.format = int(Format::rle);
+            std::stringstream fields(trimmed);
+            std::string field;
+            while (std::getline(fields, field, ',')) {
+                auto eq = field.find('=');
+                if (eq == std::string::npos) continue;
+                std::string key = field.substr(0, eq), value = field.substr(eq + 1);
+                if (key == "x") h.box_cols = std::stoi(value);
+                else if (key == "y") h.box_rows = std::stoi(value);
+                else if (key == "rule") std::snprintf(h.rule, sizeof(h.rule), "%s", value.c_str());
+            }
+            offset = next;
+        }
+        break;
+    }
+    if (Format(h.format) == Format::rle && (h.box_rows <= 0 || h.box_cols <= 0)) {
+        std::snprintf(h.error, sizeof(h.error), "%s : missing or invalid RLE header line", filename.c_str());
+        return h;
+    }
+    h.body_offset = offset;
+    h.ok = 1;
+    return h;
+}
+
+// Effect of a piece of the body on the (row, column) cursor. Pieces compose
+// left to right, which lets MPI_Exscan give every process its starting cursor.
+struct ScanSummary {
+    long long dy;       // rows advanced
+    long long dx;       // column reached since the last end of row (or advance if newline == 0)
+    long long newline;  // the piece contains an end of row
+    long long ended;    // the piece contains the RLE terminator '!'
+};
+
+void compose_summaries(void* invec, void* inoutvec, int* len, MPI_Datatype*) {
+    auto* left = static_cast<ScanSummary*>(invec);
+    auto* right = static_cast<ScanSummary*>(inoutvec);
+    for (int i = 0; i < *len; ++i) {
+        ScanSummary r = right[i];
+        if (left[i].ended) {
+            right[i] = left[i];
+        } else if (r.newline) {
+            right[i] = {left[i].dy + r.dy, r.dx, 1, r.ended};
+        } else {
+            right[i] = {left[i].dy, left[i].dx + r.dx, left[i].newline, r.ended};
+        }
+    }
+}
+
+// Walks the tokens *starting* in [begin, end) of buf (which holds [lo, hi) of the file).
+// Calls run(alive, count) for cell runs and newline(count) for ends of rows.
+// Returns true if the terminator '!' was met.
+template <class Run, class Newline>
+bool walk_tokens(Format format, const std::vector<char>& buf, long long begin, long long end,
+                 bool has_previous, Run run, Newline newline) {
+    long long p = begin;
+    long long hi = buf.size();
+    if (format == Format::plaintext) {
+        for (; p < end; ++p) {
+            char c = buf[p];
+            if (c == '\n') newline(1);
+            else if (c == '.') run(false, 1);
+            else if (c == 'O' || c == 'o' || c == '*') run(true, 1);
+        }
+        return false;
+    }
+    // A token is [count] tag. If my range starts inside a token, it belongs to the previous process.
+    if (has_previous && std::isdigit(static_cast<unsigned char>(buf[p - 1]))) {
+        while (p < hi && std::isdigit(static_cast<unsigned char>(buf[p]))) ++p;
+        ++p;
+    }
+    while (p < end) {
+        char c = buf[p];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            ++p;
+            continue;
+        }
+        long long count = 1;
+        if (std::isdigit(static_cast<unsigned char>(c))) {
+            count = 0;
+            while (p < hi && std::isdigit(static_cast<unsigned char>(buf[p]))) count = 10 * count + (buf[p++] - '0');
+            if (p >= hi) break;
+            c = buf[p];
+        }
+        ++p;
+        if (c == '!') return true;
+        if (c == '$') newline(count);
+        else if (c == 'b' || c == '.') run(false, count);
+        else if (std::isalpha(static_cast<unsigned char>(c))) run(true, count);
+    }
+    return false;
+}
+}  // namespace
+
+bool is_pattern_file(const std::string& name) {
+    return ends_with(name, ".rle") || ends_with(name, ".cells") || ends_with(name, ".txt");
+}
+
+LoadedPattern load_pattern(const std::string& filename, MPI_Comm comm, std::pair<int, int> grid_dims) {
+    int rank, nbp;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nbp);
+
+    // The header is tiny : process 0 parses it, everybody gets the body offset.
+    Header header;
+    if (rank == 0) header = read_header(filename);
+    MPI_Bcast(&header, sizeof(Header), MPI_BYTE, 0, comm);
+    if (!header.ok) throw std::runtime_error(header.error);
+    Format format = Format(header.format);
+
+    MPI_File fh;
+    if (MPI_File_open(comm, filename.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS)
+        throw std::runtime_error("cannot open pattern file " + filename);
+    MPI_Offset file_size;
+    MPI_File_get_size(fh, &file_size);
+
+    // My byte range of the body, plus one byte before and a few bytes after
+    long long body = file_size - header.body_offset;
+    long long begin = header.body_offset + body * rank / nbp;
+    long long end = header.body_offset + body * (rank + 1) / nbp;
+    long long lo = std::max(begin - 1, header.body_offset);
+    long long hi = std::min<long long>(end + lookahead, file_size);
+    std::vector<char> buf(hi - lo);
+    for (long long done = 0; done < hi - lo;) {
+        int count = int(std::min<long long>(hi - lo - done, 1 << 30));
+        MPI_File_read_at(fh, lo + done, buf.data() + done, count, MPI_CHAR, MPI_STATUS_IGNORE);
+        done += count;
+    }
+    MPI_File_close(&fh);
+
+    // Pass 1 : effect of my range on the cursor, then prefix over the processes
+    ScanSummary mine = {0, 0, 0, 0};
+    mine.ended = walk_tokens(format, buf, begin - lo, end - lo, begin > lo,
+        [&](bool, long long count) { mine.dx += count; },
+        [&](long long count) { mine.dy += count; mine.dx = 0; mine.newline = 1; });
+
+    MPI_Datatype summary_type;
+    MPI_Type_contiguous(4, MPI_LONG_LONG, &summary_type);
+    MPI_Type_commit(&summary_type);
+    MPI_Op compose;
+    MPI_Op_create(&compose_summaries, 0, &compose);
+    ScanSummary prefix = {0, 0, 0, 0};
+    MPI_Exscan(&mine, &prefix, 1, summary_type, compose, comm);
+    if (rank == 0) prefix = {0, 0, 0, 0};
+    MPI_Op_free(&compose);
+    MPI_Type_free(&summary_type);
+
+    // Pass 2 : decode my range from the cursor given by the prefix
+    std::vector<std::pair<long long, long long>> cells;
+    long long row = prefix.dy, col = prefix.dx;
+    long long extent[2] = {-1, -1};
+    if (!prefix.ended) {
+        walk_tokens(format, buf, begin - lo, end - lo, begin > lo,
+            [&](bool alive, long long count) {
+                if (alive)
+                    for (long long k = 0; k < count; ++k) cells.emplace_back(row, col + k);
+                col += count;
+                extent[0] = std::max(extent[0], row);
+                extent[1] = std::max(extent[1], col - 1);
+            },
+            [&](long long count) { row += count; col = 0; });
+    }
+    buf.clear();
+    buf.shrink_to_fit();
+
+    LoadedPattern pattern;
+    pattern.rule = header.rule;
+    if (format == Format::rle) {
+        pattern.bounding_box = {header.box_rows, header.box_cols};
+    } else {
+        long long global_extent[2];
+        MPI_Allreduce(extent, global_extent, 2, MPI_LONG_LONG, MPI_MAX, comm);
+        pattern.bounding_box = {int(global_extent[0] + 1), int(global_extent[1] + 1)};
+    }
+    if (grid_dims.first <= 0 || grid_dims.second <= 0)
+        grid_dims = {2 * pattern.bounding_box.first, 2 * pattern.bounding_box.second};
+    if (grid_dims.first < pattern.bounding_box.first || grid_dims.second < pattern.bounding_box.second)
+        throw std::runtime_error(filename + " : pattern larger than the grid");
+    pattern.dimensions = grid_dims;
+    int offset_row = (grid_dims.first - pattern.bounding_box.first) / 2;
+    int offset_col = (grid_dims.second - pattern.bounding_box.second) / 2;
+
+    // Route the live cells to the processes owning their row
+    std::vector<int> send_counts(nbp, 0), send_displs(nbp, 0), recv_counts(nbp), recv_displs(nbp, 0);
+    std::vector<int> owners(cells.size());
+    for (size_t k = 0; k < cells.size(); ++k) {
+        if (cells[k].first >= pattern.bounding_box.first || cells[k].second >= pattern.bounding_box.second) {
+            owners[k] = -1;  // outside of the declared bounding box
+            continue;
+        }
+        owners[k] = stripe_owner(int(cells[k].first) + offset_row, nbp, grid_dims.first);
+        send_counts[owners[k]] += 2;
+    }
+    for (int p = 1; p < nbp; ++p) send_displs[p] = send_displs[p - 1] + send_counts[p - 1];
+    std::vector<int> send_buf(send_displs[nbp - 1] + send_counts[nbp - 1]);
+    std::vector<int> fill = send_displs;
+    for (size_t k = 0; k < cells.size(); ++k) {
+        if (owners[k] < 0) continue;
+        send_buf[fill[owners[k]]++] = int(cells[k].first) + offset_row;
+        send_buf[fill[owners[k]]++] = int(cells[k].second) + offset_col;
+    }
+    cells.clear();
+    cells.shrink_to_fit();
+
+    MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, comm);
+    for (int p = 1; p < nbp; ++p) recv_displs[p] = recv_displs[p - 1] + recv_counts[p - 1];
+    std::vector<int> recv_buf(recv_displs[nbp - 1] + recv_counts[nbp - 1]);
+    MPI_Alltoallv(send_buf.data(), send_counts.data(), send_displs.data(), MPI_INT,
+                  recv_buf.data(), recv_counts.data(), recv_displs.data(), MPI_INT, comm);
+
+    pattern.local_cells.reserve(recv_buf.size() / 2);
+    for (size_t k = 0; k < recv_buf.size(); k += 2)
+        pattern.local_cells.emplace_back(recv_buf[k], recv_buf[k + 1]);
+    return pattern;
+}
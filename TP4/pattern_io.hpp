@@ -0,0 +1,28 @@
+#ifndef _PATTERN_IO_HPP_
+#define _PATTERN_IO_HPP_
+
+#include <string>
+#include <utility>
+#include <mpi.h>
+#include "grille.hpp"
+
+// Pattern read from an RLE (.rle) or plaintext (.cells, .txt) file.
+// The file body is split in byte ranges, one per process, decoded in parallel
+// and the live cells are routed to the processes owning their row stripe.
+struct LoadedPattern {
+    std::pair<int, int> dimensions;    // grid (rows, columns)
+    std::pair<int, int> bounding_box;  // pattern (rows, columns) as read in the file
+    std::string rule;                  // rule of the RLE header, "B3/S23" otherwise
+    Pattern local_cells;               // live cells (global coordinates) of my stripe
+};
+
+// True if `name` looks like a pattern file rather than a built-in pattern name
+bool is_pattern_file(const std::string& name);
+
+// Collective over `comm`. The pattern is centred in a grid of `grid_dims` cells;
+// when `grid_dims` is {0, 0} the grid is twice the pattern bounding box.
+// Throws std::runtime_error (on every process) if the file cannot be read.
+LoadedPattern load_pattern(const std::string& filename, MPI_Comm comm,
+                           std::pair<int, int> grid_dims = {0, 0});
+
+#endif
@@ -0,0 +1,225 @@
+#include <cctype>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include "rules.hpp"
+
+namespace {
+constexpr unsigned mask(const char* digits) {
+    unsigned m = 0;
+    for (; *digits != '\0'; ++digits) m |= 1u << (*digits - '0');
+    return m;
+}
+
+unsigned parse_digits(const std::string& digits, const std::string& text) {
+    unsigned m = 0;
+    for (char c : digits) {
+        if (c < '0' || c > '8') throw std::invalid_argument("invalid rule " + text);
+        m |= 1u << (c - '0');
+    }
+    return m;
+}
+
+// "34..58" or "3"
+void parse_range(const std::string& value, int& lo, int& hi, const std::string& text) {
+    auto dots = value.find("..");
+    try {
+        lo = std::stoi(value.substr(0, dots));
+        hi = dots == std::string::npos ? lo : std::stoi(value.substr(dots + 2));
+    } catch (const std::logic_error&) {
+        throw std::invalid_argument("invalid rule " + text);
+    }
+}
+
+// Golly Larger than Life syntax : Rr,Cc,Mm,Ssmin..smax,Bbmin..bmax,Nn
+Rule parse_larger_than_life(const std::string& rule_string, const std::string& text) {
+    Rule rule;
+    std::stringstream fields(rule_string);
+    std::string field;
+    while (std::getline(fields, field, ',')) {
+        if (field.empty()) continue;
+        std::string value = field.substr(1);
+        switch (field[0]) {
+        case 'R': rule.radius = std::stoi(value); break;
+        case 'C':
+            if (std::stoi(value) > 2) throw std::invalid_argument("only two states rules are supported : " + text);
+            break;
+        case 'M': rule.include_center = (value == "1"); break;
+        case 'S': parse_range(value, rule.survival_min, rule.survival_max, text); break;
+        case 'B': parse_range(value, rule.birth_min, rule.birth_max, text); break;
+        case 'N':
+            if (value != "M") throw std::invalid_argument("only the Moore neighbourhood is supported : " + text);
+            break;
+        default: throw std::invalid_argument("invalid rule " + text);
+        }
+    }
+    if (rule.radius < 1) throw std::invalid_argument("invalid rule radius : " + text);
+    if (rule.radius == 1) {
+        // Same automaton in B/S notation, the count of a live cell excluding itself
+        rule.birth = rule.survival = 0;
+        for (int k = 0; k <= 8; ++k) {
+            if (k >= rule.birth_min && k <= rule.birth_max) rule.birth |= 1u << k;
+            int alive = k + (rule.include_center ? 1 : 0);
+            if (alive >= rule.survival_min && alive <= rule.survival_max) rule.survival |= 1u << k;
+        }
+        rule.include_center = false;
+    }
+    return rule;
+}
+
+// Sums the three cells of every column, then the three column sums, minus the cell itself
+template <class Policy>
+void step_life_like(const Policy& policy, const unsigned char* in, unsigned char* out,
+                    int rows, int cols, std::ptrdiff_t stride, const unsigned char* active,
+                    unsigned char* live, std::vector<int>& work) {
+    work.resize((cols + 2) / sizeof(int) + 2);
+    unsigned char* colsum = reinterpret_cast<unsigned char*>(work.data()) + 1;
+    for (int i = 0; i < rows; ++i) {
+        unsigned char* next = out + i * stride;
+        if (active != nullptr && !active[i]) {
+            std::memset(next, 0, cols);
+            live[i] = 0;
+            continue;
+        }
+        const unsigned char* up = in + (i - 1) * stride;
+        const unsigned char* mid = in + i * stride;
+        const unsigned char* down = in + (i + 1) * stride;
+        for (int j = -1; j <= cols; ++j) {
+            colsum[j] = up[j] + mid[j] + down[j];
+        }
+        unsigned char any = 0;
+        for (int j = 0; j < cols; ++j) {
+            unsigned char count = colsum[j - 1] + colsum[j] + colsum[j + 1] - mid[j];
+            unsigned char cell = policy.apply(mid[j], count);
+            next[j] = cell;
+            any |= cell;
+        }
+        live[i] = any;
+    }
+}
+
+template <class Policy>
+void step_fixed(const Rule&, const unsigned char* in, unsigned char* out, int rows, int cols,
+                std::ptrdiff_t stride, const unsigned char* active, unsigned char* live, std::vector<int>& work) {
+    step_life_like(Policy(), in, out, rows, cols, stride, active, live, work);
+}
+
+void step_runtime(const Rule& rule, const unsigned char* in, unsigned char* out, int rows, int cols,
+                  std::ptrdiff_t stride, const unsigned char* active, unsigned char* live, std::vector<int>& work) {
+    step_life_like(rule_policy::RuntimeLifeLike(rule), in, out, rows, cols, stride, active, live, work);
+}
+
+// Box sums with a sliding window : vertical sums over 2r+1 rows, updated by
+// one row in and one row out from a row to the next, then prefix sums along the row.
+void step_larger_than_life(const Rule& rule, const unsigned char* in, unsigned char* out, int rows, int cols,
+                           std::ptrdiff_t stride, const unsigned char* active, unsigned char* live,
+                           std::vector<int>& work) {
+    const int r = rule.radius;
+    const int width = cols + 2 * r;
+    const int center = rule.include_center ? 0 : 1;
+    rule_policy::LargerThanLife policy(rule);
+    work.assign(2 * width + 1, 0);
+    int* vsum = work.data();       // columns -r .. cols+r-1
+    int* prefix = vsum + width;    // prefix[k] = vsum[0] + ... + vsum[k-1]
+    for (int di = -r; di <= r; ++di) {
+        const unsigned char* src = in + di * stride - r;
+        for (int k = 0; k < width; ++k) vsum[k] += src[k];
+    }
+    for (int i = 0; i < rows; ++i) {
+        if (i > 0) {
+            const unsigned char* enter = in + (i + r) * stride - r;
+            const unsigned char* leave = in + (i - r - 1) * stride - r;
+            for (int k = 0; k < width; ++k) vsum[k] += enter[k] - leave[k];
+        }
+        unsigned char* next = out + i * stride;
+        if (active != nullptr && !active[i]) {
+            std::memset(next, 0, cols);
+            live[i] = 0;
+            continue;
+        }
+        prefix[0] = 0;
+        for (int k = 0; k < width; ++k) prefix[k + 1] = prefix[k] + vsum[k];
+        const unsigned char* mid = in + i * stride;
+        unsigned char any = 0;
+        for (int j = 0; j < cols; ++j) {
+            int count = prefix[j + 2 * r + 1] - prefix[j] - center * mid[j];
+            unsigned char cell = policy.apply(mid[j], count);
+            next[j] = cell;
+            any |= cell;
+        }
+        live[i] = any;
+    }
+}
+
+struct KnownRule {
+    unsigned birth, survival;
+    StepFunction step;
+};
+
+#define KNOWN_RULE(B, S) {mask(B), mask(S), &step_fixed<rule_policy::LifeLike<mask(B), mask(S)>>}
+const KnownRule known_rules[] = {
+    KNOWN_RULE("3", "23"),             // Conway
+    KNOWN_RULE("36", "23"),            // HighLife
+    KNOWN_RULE("3678", "34678"),       // Day & Night
+    KNOWN_RULE("2", ""),               // Seeds
+    KNOWN_RULE("3", "012345678"),      // Life without death
+    KNOWN_RULE("34", "34"),            // 34 Life
+    KNOWN_RULE("1357", "1357"),        // Replicator
+    KNOWN_RULE("36", "125"),           // 2x2
+    KNOWN_RULE("368", "245"),          // Morley
+    KNOWN_RULE("35678", "5678"),       // Diamoeba
+    KNOWN_RULE("3", "12345"),          // Maze
+};
+#undef KNOWN_RULE
+}  // namespace
+
+std::string Rule::name() const {
+    std::ostringstream out;
+    if (radius == 1) {
+        out << "B";
+        for (int k = 0; k <= 8; ++k) if (birth & (1u << k)) out << k;
+        out << "/S";
+        for (int k = 0; k <= 8; ++k) if (survival & (1u << k)) out << k;
+    } else {
+        out << "R" << radius << ",C0,M" << (include_center ? 1 : 0) << ",S" << survival_min << ".."
+            << survival_max << ",B" << birth_min << ".." << birth_max << ",NM";
+    }
+    return out.str();
+}
+
+Rule parse_rule(const std::string& text) {
+    std::string t;
+    for (char c : text) {
+        if (!std::isspace(static_cast<unsigned char>(c))) t += std::toupper(static_cast<unsigned char>(c));
+    }
+    if (t.empty()) throw std::invalid_argument("empty rule");
+    if (t[0] == 'R' && t.find(',') != std::string::npos) return parse_larger_than_life(t, text);
+
+    Rule rule;
+    auto b = t.find('B'), s = t.find('S');
+    if (b != std::string::npos || s != std::string::npos) {
+        // B.../S... in any order, the slash being optional
+        auto digits_after = [&](std::string::size_type pos) {
+            if (pos == std::string::npos) return std::string();
+            auto end = t.find_first_not_of("0123456789", pos + 1);
+            return t.substr(pos + 1, end == std::string::npos ? std::string::npos : end - pos - 1);
+        };
+        rule.birth = parse_digits(digits_after(b), text);
+        rule.survival = parse_digits(digits_after(s), text);
+    } else {
+        // Old S/B notation : "23/3"
+        auto slash = t.find('/');
+        if (slash == std::string::npos) throw std::invalid_argument("invalid rule " + text);
+        rule.survival = parse_digits(t.substr(0, slash), text);
+        rule.birth = parse_digits(t.substr(slash + 1), text);
+    }
+    return rule;
+}
+
+StepFunction select_step(const Rule& rule) {
+    if (rule.radius > 1) return &step_larger_than_life;
+    for (const auto& known : known_rules) {
+        if (known.birth == rule.birth && known.survival == rule.survival) return known.step;
+    }
+    return &step_runtime;
+}
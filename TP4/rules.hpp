@@ -0,0 +1,110 @@
+#ifndef _RULES_HPP_
+#define _RULES_HPP_
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Rule of a two states totalistic automaton on a Moore neighbourhood.
+//   - radius 1 (Life-like) : "B3/S23", "b36s23", "23/3" (S/B notation), ...
+//   - radius > 1 (Larger than Life, Golly syntax) : "R5,C0,M1,S34..58,B34..45,NM"
+struct Rule {
+    int radius = 1;
+    // radius 1 : bit k set if k live neighbours give a birth / let a live cell survive
+    unsigned birth = 1u << 3;
+    unsigned survival = (1u << 2) | (1u << 3);
+    // radius > 1 : inclusive ranges on the number of live cells of the (2r+1)^2 box,
+    // the cell itself counted if include_center (M1)
+    bool include_center = false;
+    int birth_min = 0, birth_max = -1;
+    int survival_min = 0, survival_max = -1;
+
+    // Canonical rule string (B/S notation for radius 1, Golly LtL syntax otherwise)
+    std::string name() const;
+
+    // True if a cell with no live cell around stays dead (no birth on 0), so that
+    // rows far from any live cell can be skipped
+    bool empty_stays_empty() const { return radius == 1 ? (birth & 1u) == 0 : birth_min > 0; }
+};
+
+// Throws std::invalid_argument if `text` is not a supported rule.
+Rule parse_rule(const std::string& text);
+
+// Policies giving the next state of a cell from its state and its number of live
+// neighbours. apply() has no data dependent branch so that the stencil loops vectorize.
+namespace rule_policy {
+constexpr std::array<unsigned char, 9> mask_table(unsigned mask) {
+    std::array<unsigned char, 9> table{};
+    for (int k = 0; k < 9; ++k) table[k] = (mask >> k) & 1;
+    return table;
+}
+
+// Life-like rule known at compile time : the tables are constants, so the
+// compiler keeps only the comparisons of the counts that matter.
+template <unsigned Birth, unsigned Survival>
+struct LifeLike {
+    static constexpr int radius = 1;
+    static constexpr std::array<unsigned char, 9> birth = mask_table(Birth);
+    static constexpr std::array<unsigned char, 9> survival = mask_table(Survival);
+
+    unsigned char apply(unsigned char cell, unsigned char count) const {
+        unsigned char born = 0, survives = 0;
+        for (int k = 0; k < 9; ++k) {
+            born |= (count == k) & birth[k];
+            survives |= (count == k) & survival[k];
+        }
+        return (born & (cell ^ 1)) | (survives & cell);
+    }
+};
+
+// Any other Life-like rule : same evaluation with runtime tables
+struct RuntimeLifeLike {
+    static constexpr int radius = 1;
+    std::array<unsigned char, 9> birth, survival;
+
+    explicit RuntimeLifeLike(const Rule& rule)
+        : birth(mask_table(rule.birth)), survival(mask_table(rule.survival)) {}
+
+    unsigned char apply(unsigned char cell, unsigned char count) const {
+        unsigned char born = 0, survives = 0;
+        for (int k = 0; k < 9; ++k) {
+            born |= (count == k) & birth[k];
+            survives |= (count == k) & survival[k];
+        }
+        return (born & (cell ^ 1)) | (survives & cell);
+    }
+};
+
+// Larger than Life : the count is the number of live cells in the box
+struct LargerThanLife {
+    int birth_min, birth_max, survival_min, survival_max;
+
+    explicit LargerThanLife(const Rule& rule)
+        : birth_min(rule.birth_min), birth_max(rule.birth_max),
+          survival_min(rule.survival_min), survival_max(rule.survival_max) {}
+
+    unsigned char apply(unsigned char cell, int count) const {
+        unsigned char born = (count >= birth_min) & (count <= birth_max);
+        unsigned char survives = (count >= survival_min) & (count <= survival_max);
+        return (born & (cell ^ 1)) | (survives & cell);
+    }
+};
+
+using Conway = LifeLike<(1u << 3), (1u << 2) | (1u << 3)>;
+}  // namespace rule_policy
+
+// Computes the next generation of a block of `rows` x `cols` cells. `in` and `out`
+// point to the first interior cell, rows are `stride` cells apart, and `in` has
+// `rule.radius` rows and columns of ghost cells on every side.
+// If `active` is not null, the rows i with active[i] == 0 have no live cell within
+// the radius and are only cleared. live[i] is set to 1 if output row i has a live cell.
+using StepFunction = void (*)(const Rule& rule, const unsigned char* in, unsigned char* out,
+                              int rows, int cols, std::ptrdiff_t stride, const unsigned char* active,
+                              unsigned char* live, std::vector<int>& work);
+
+// Kernel specialized for the rule when it is one of the usual Life-like rules,
+// generic kernel (runtime tables) otherwise.
+StepFunction select_step(const Rule& rule);
+
+#endif
@@ -0,0 +1,79 @@
+// Écriture puis relecture d'un point de reprise, comme --checkpoint puis --restart,
+// pour une règle de Conway et des règles Larger than Life au nom long, la relecture
+// se faisant sur un découpage en bandes différent (moitié des processus).
+//   mpirun -np 4 ./test_checkpoint.exe [fichier]
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <mpi.h>
+#include "checkpoint.hpp"
+#include "grille.hpp"
+#include "rules.hpp"
+
+namespace {
+// Writes a random grid on every process of `comm`, reads it back on the first half
+// of them, returns false if the rule, the generation or a cell differs.
+bool write_then_restart(const std::string& filename, const std::string& text, MPI_Comm comm) {
+    int rank, nbp;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nbp);
+    const Rule rule = parse_rule(text);
+    const std::pair<int, int> dims = {61, 45};
+    const long long generation = 1234;
+
+    // Whole grid on every process, to check the stripes read back
+    Grille written(rank, nbp, dims, nullptr, rule);
+    std::vector<unsigned char> cells(size_t(dims.first) * dims.second, 0);
+    for (int i = 0; i < written.dimensions_loc.first; ++i)
+        for (int j = 0; j < dims.second; ++j)
+            cells[size_t(written.start_loc + i) * dims.second + j] = written.row(i)[j];
+    MPI_Allreduce(MPI_IN_PLACE, cells.data(), int(cells.size()), MPI_UNSIGNED_CHAR, MPI_MAX, comm);
+    write_checkpoint(filename, written, generation, rule.name(), comm);
+
+    const int readers = (nbp + 1) / 2;
+    MPI_Comm restart_comm;
+    MPI_Comm_split(comm, rank < readers ? 0 : MPI_UNDEFINED, rank, &restart_comm);
+    int errors = 0;
+    if (restart_comm != MPI_COMM_NULL) {
+        try {
+            CheckpointHeader header = read_checkpoint_header(filename, restart_comm);
+            const Rule restarted_rule = parse_rule(header.rule);
+            if (header.rule != rule.name() || restarted_rule.name() != rule.name() ||
+                header.generation != generation || header.rows != dims.first || header.cols != dims.second)
+                ++errors;
+            Grille read(rank, readers, dims, nullptr, restarted_rule);
+            read_checkpoint(filename, read, restart_comm);
+            for (int i = 0; i < read.dimensions_loc.first; ++i)
+                for (int j = 0; j < dims.second; ++j)
+                    if (read.row(i)[j] != cells[size_t(read.start_loc + i) * dims.second + j]) ++errors;
+        } catch (const std::exception& e) {
+            std::cerr << text << " : " << e.what() << std::endl;
+            ++errors;
+        }
+        MPI_Comm_free(&restart_comm);
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &errors, 1, MPI_INT, MPI_SUM, comm);
+    if (rank == 0)
+        std::cout << rule.name() << " (" << rule.name().size() << " caracteres) : " << errors << " erreur(s)"
+                  << std::endl;
+    return errors == 0;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    MPI_Init(&argc, &argv);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    const std::string filename = argc > 1 ? argv[1] : "test_checkpoint.ckpt";
+
+    bool passed = write_then_restart(filename, "B3/S23", MPI_COMM_WORLD);
+    passed = write_then_restart(filename, "R5,C0,M1,S34..58,B34..45,NM", MPI_COMM_WORLD) && passed;
+    passed = write_then_restart(filename, "R10,C0,M1,S100..200,B100..200,NM", MPI_COMM_WORLD) && passed;
+    if (rank == 0) {
+        std::remove(filename.c_str());
+        std::cout << (passed ? "Test passed" : "Test failed") << std::endl;
+    }
+    MPI_Finalize();
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
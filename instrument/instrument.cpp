@@ -0,0 +1,531 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "instrument.h"
+
+using namespace instrument;
+
+namespace {
+// Trace events kept per thread (64 bytes each), the next ones are dropped
+const std::size_t max_events = 1 << 18;
+
+long long now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+struct Config {
+    bool report = false, perf = false;
+    std::string json, trace;
+    long long origin = now_ns();
+
+    Config() {
+        const char* value = std::getenv("INSTRUMENT_REPORT");
+        report = value && *value && std::strcmp(value, "0") != 0;
+        value = std::getenv("INSTRUMENT_PERF");
+        perf = value && *value && std::strcmp(value, "0") != 0;
+        if ((value = std::getenv("INSTRUMENT_JSON"))) json = value;
+        if ((value = std::getenv("INSTRUMENT_TRACE"))) trace = value;
+    }
+};
+
+const Config& config() {
+    static const Config instance;
+    return instance;
+}
+
+// Hardware counters of the calling thread, in two groups read at once each :
+// cycles, instructions and cache misses (generic events), then on Intel the
+// retired double precision arithmetic instructions by vector width
+// (FP_ARITH_INST_RETIRED, an FMA counting twice) giving the flops.
+class HardwareCounters {
+public:
+    ~HardwareCounters() {
+        for (int fd : fds) close(fd);
+    }
+
+    bool open() {
+        cache_group = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+        if (cache_group < 0) return false;
+        if (open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, cache_group) < 0 ||
+            open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, cache_group) < 0)
+            return false;
+        if (intel()) {
+            // Scalar, 128, 256 and 512 bits packed double : 1, 2, 4, 8 flops
+            const std::uint64_t umasks[4] = {0x01, 0x04, 0x10, 0x40};
+            fp_group = open_event(PERF_TYPE_RAW, (umasks[0] << 8) | 0xC7, -1);
+            for (int k = 1; k < 4 && fp_group >= 0; ++k) {
+                if (open_event(PERF_TYPE_RAW, (umasks[k] << 8) | 0xC7, fp_group) < 0) fp_group = -1;
+            }
+        }
+        return true;
+    }
+
+    // Counts since the opening, scaled when the groups were multiplexed
+    void read(double values[NB_HARDWARE]) const {
+        double counts[4];
+        read_group(cache_group, 3, counts);
+        values[CYCLES] = counts[0];
+        values[INSTRUCTIONS] = counts[1];
+        values[CACHE_MISSES] = counts[2];
+        values[FLOPS] = 0.;
+        if (fp_group >= 0) {
+            read_group(fp_group, 4, counts);
+            values[FLOPS] = counts[0] + 2. * counts[1] + 4. * counts[2] + 8. * counts[3];
+        }
+    }
+
+private:
+    int open_event(std::uint32_t type, std::uint64_t event, int group) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = event;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+        if (fd >= 0) fds.push_back(fd);
+        return fd;
+    }
+
+    static void read_group(int fd, int size, double* counts) {
+        std::uint64_t buffer[3 + 4] = {};
+        std::fill(counts, counts + size, 0.);
+        if (::read(fd, buffer, sizeof(buffer)) < ssize_t((3 + size) * sizeof(std::uint64_t))) return;
+        double scale = buffer[2] > 0 ? double(buffer[1]) / double(buffer[2]) : 0.;
+        for (int k = 0; k < size; ++k) counts[k] = double(buffer[3 + k]) * scale;
+    }
+
+    static bool intel() {
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(cpuinfo, line)) {
+            if (line.compare(0, 9, "vendor_id") == 0) return line.find("GenuineIntel") != std::string::npos;
+        }
+        return false;
+    }
+
+    std::vector<int> fds;
+    int cache_group = -1, fp_group = -1;
+};
+
+struct Stats {
+    long long calls = 0, time = 0, counts = 0;
+    double value = 0.;
+    double hardware[NB_HARDWARE] = {};
+};
+
+struct Open {
+    int id;
+    long long start;
+    double hardware[NB_HARDWARE];
+};
+
+// Region closed or value counted, for the trace
+struct Event {
+    int id;
+    bool counter;
+    long long start, duration;
+    double value;  // running sum for a counter
+    double hardware[NB_HARDWARE];
+};
+
+struct ThreadState {
+    int tid;
+    std::vector<Stats> stats;  // indexed by id
+    std::vector<Open> open;
+    std::vector<Event> events;
+    long long dropped = 0;
+    std::unique_ptr<HardwareCounters> counters;
+    std::unordered_map<const char*, int> ids;  // cache of instr_id
+
+    Stats& at(int id) {
+        if (std::size_t(id) >= stats.size()) stats.resize(id + 1);
+        return stats[id];
+    }
+};
+
+// Region names and the states of all the threads which recorded something
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::string> names;
+    std::unordered_map<std::string, int> ids;
+    std::vector<std::unique_ptr<ThreadState>> threads;
+    bool hardware = false;
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+ThreadState& thread_state() {
+    static thread_local ThreadState* state = nullptr;
+    if (state) return *state;
+    const Config& conf = config();
+    Registry& reg = registry();
+    std::unique_ptr<ThreadState> created(new ThreadState);
+    if (conf.perf) {
+        created->counters.reset(new HardwareCounters);
+        if (!created->counters->open()) created->counters.reset();
+    }
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    created->tid = int(reg.threads.size());
+    if (created->counters) {
+        reg.hardware = true;
+    } else if (conf.perf && created->tid == 0) {
+        std::fprintf(stderr, "INSTRUMENT_PERF : compteurs materiels indisponibles (perf_event_open)\n");
+    }
+    state = created.get();
+    reg.threads.push_back(std::move(created));
+    return *state;
+}
+
+void close_region(ThreadState& state, const Open& open, long long end, const double* hardware) {
+    Stats& stats = state.at(open.id);
+    ++stats.calls;
+    stats.time += end - open.start;
+    for (int k = 0; k < NB_HARDWARE; ++k) stats.hardware[k] += hardware[k] - open.hardware[k];
+    if (config().trace.empty()) return;
+    if (state.events.size() >= max_events) {
+        ++state.dropped;
+        return;
+    }
+    Event event{open.id, false, open.start, end - open.start, 0., {}};
+    for (int k = 0; k < NB_HARDWARE; ++k) event.hardware[k] = hardware[k] - open.hardware[k];
+    state.events.push_back(event);
+}
+
+std::string json_string(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", c);
+            out += code;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+std::string format(const char* pattern, double a, double b = 0., double c = 0.) {
+    char buffer[256];
+    std::snprintf(buffer, sizeof(buffer), pattern, a, b, c);
+    return buffer;
+}
+
+// Entries of the same name in every process (nullptr where absent)
+struct Merged {
+    std::string name;
+    std::vector<const Entry*> per_process;
+    double calls = 0., counts = 0., value = 0., min = 0., mean = 0., max = 0.;
+    double thread_imbalance = 1.;
+    double hardware[NB_HARDWARE] = {};
+
+    double process_imbalance() const { return mean > 0. ? max / mean : 1.; }
+};
+
+std::vector<Merged> merge(const std::vector<Summary>& processes) {
+    std::vector<Merged> merged;
+    std::map<std::string, std::size_t> index;
+    const std::size_t nbp = processes.size();
+    for (std::size_t p = 0; p < nbp; ++p) {
+        for (const Entry& entry : processes[p].entries) {
+            auto found = index.find(entry.name);
+            if (found == index.end()) {
+                found = index.emplace(entry.name, merged.size()).first;
+                merged.emplace_back();
+                merged.back().name = entry.name;
+                merged.back().per_process.assign(nbp, nullptr);
+            }
+            merged[found->second].per_process[p] = &entry;
+        }
+    }
+    for (Merged& m : merged) {
+        m.min = 1.E300;
+        for (const Entry* entry : m.per_process) {
+            double time = entry ? entry->time : 0.;
+            m.min = std::min(m.min, time);
+            m.max = std::max(m.max, time);
+            m.mean += time / nbp;
+            if (!entry) continue;
+            m.calls += entry->calls;
+            m.counts += entry->counts;
+            m.value += entry->value;
+            if (entry->thread_mean > 0.) m.thread_imbalance = std::max(m.thread_imbalance, entry->time / entry->thread_mean);
+            for (int k = 0; k < NB_HARDWARE; ++k) m.hardware[k] += entry->hardware[k];
+        }
+    }
+    return merged;
+}
+
+void print_table(const std::vector<Merged>& merged, std::size_t nbp, bool hardware, long long dropped) {
+    std::printf("Instrumentation : %zu processus\n", nbp);
+    std::printf("%-24s %10s %12s %12s %12s %14s", "region", "appels", "moyenne (s)", "max (s)", "deseq. proc",
+                "deseq. threads");
+    if (hardware) std::printf(" %8s %12s %10s", "IPC", "LLC/kinstr", "GFlop/s");
+    std::printf("\n");
+    for (const Merged& m : merged) {
+        if (m.calls == 0.) continue;
+        std::printf("%-24s %10.0f %12.6f %12.6f %12.3f %14.3f", m.name.c_str(), m.calls, m.mean, m.max,
+                    m.process_imbalance(), m.thread_imbalance);
+        if (hardware) {
+            const double* h = m.hardware;
+            std::printf(" %8.3f %12.3f %10.3f", h[CYCLES] > 0. ? h[INSTRUCTIONS] / h[CYCLES] : 0.,
+                        h[INSTRUCTIONS] > 0. ? 1000. * h[CACHE_MISSES] / h[INSTRUCTIONS] : 0.,
+                        m.max > 0. ? h[FLOPS] / m.max * 1.E-9 : 0.);
+        }
+        std::printf("\n");
+    }
+    bool header = false;
+    for (const Merged& m : merged) {
+        if (m.counts == 0.) continue;
+        if (!header) std::printf("%-24s %16s %16s %16s\n", "compteur", "total", "min/proc", "max/proc");
+        header = true;
+        double low = 1.E300, high = -1.E300;
+        for (const Entry* entry : m.per_process) {
+            double value = entry ? entry->value : 0.;
+            low = std::min(low, value);
+            high = std::max(high, value);
+        }
+        std::printf("%-24s %16.6g %16.6g %16.6g\n", m.name.c_str(), m.value, low, high);
+    }
+    if (dropped > 0) std::printf("Evenements de trace perdus : %lld\n", dropped);
+    std::fflush(stdout);
+}
+
+void write_json(const std::string& path, const std::vector<Merged>& merged, std::size_t nbp, bool hardware,
+                long long dropped) {
+    static const char* hardware_names[NB_HARDWARE] = {"cycles", "instructions", "cache_misses", "flops"};
+    std::ofstream out(path);
+    if (!out) {
+        std::fprintf(stderr, "INSTRUMENT_JSON : impossible d'ecrire %s\n", path.c_str());
+        return;
+    }
+    out << "{\"processes\": " << nbp << ", \"hardware_counters\": " << (hardware ? "true" : "false")
+        << ", \"dropped_events\": " << dropped << ",\n \"regions\": {";
+    bool first = true;
+    for (const Merged& m : merged) {
+        if (m.calls == 0.) continue;
+        out << (first ? "\n" : ",\n") << "  " << json_string(m.name) << ": {\"calls\": " << format("%.0f", m.calls)
+            << ", \"time\": {\"min\": " << format("%.6e", m.min) << ", \"mean\": " << format("%.6e", m.mean)
+            << ", \"max\": " << format("%.6e", m.max) << "}, \"process_imbalance\": "
+            << format("%.4f", m.process_imbalance()) << ", \"thread_imbalance\": " << format("%.4f", m.thread_imbalance);
+        if (hardware) {
+            for (int k = 0; k < NB_HARDWARE; ++k)
+                out << ", \"" << hardware_names[k] << "\": " << format("%.6e", m.hardware[k]);
+        }
+        out << ", \"per_process\": [";
+        for (std::size_t p = 0; p < nbp; ++p) {
+            const Entry* entry = m.per_process[p];
+            Entry none;
+            if (!entry) entry = &none;
+            out << (p ? ", " : "") << "{\"calls\": " << format("%.0f", entry->calls)
+                << ", \"time\": " << format("%.6e", entry->time)
+                << ", \"thread_mean\": " << format("%.6e", entry->thread_mean)
+                << ", \"threads\": " << format("%.0f", entry->threads) << "}";
+        }
+        out << "]}";
+        first = false;
+    }
+    out << "},\n \"counters\": {";
+    first = true;
+    for (const Merged& m : merged) {
+        if (m.counts == 0.) continue;
+        out << (first ? "\n" : ",\n") << "  " << json_string(m.name) << ": {\"total\": " << format("%.6e", m.value)
+            << ", \"per_process\": [";
+        for (std::size_t p = 0; p < nbp; ++p)
+            out << (p ? ", " : "") << format("%.6e", m.per_process[p] ? m.per_process[p]->value : 0.);
+        out << "]}";
+        first = false;
+    }
+    out << "}}\n";
+}
+}  // namespace
+
+// ---------------------------------------------------------------------------------------------------------------
+extern "C" {
+double instr_wtime(void) { return 1.E-9 * double(now_ns()); }
+
+void instr_init(void) {
+    config();
+    thread_state();
+}
+
+int instr_id(const char* name) {
+    ThreadState& state = thread_state();
+    auto cached = state.ids.find(name);
+    if (cached != state.ids.end()) return cached->second;
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    auto found = reg.ids.find(name);
+    if (found == reg.ids.end()) {
+        found = reg.ids.emplace(name, int(reg.names.size())).first;
+        reg.names.push_back(name);
+    }
+    state.ids.emplace(name, found->second);
+    return found->second;
+}
+
+void instr_begin(int id) {
+    ThreadState& state = thread_state();
+    Open open{id, 0, {}};
+    if (state.counters) state.counters->read(open.hardware);
+    // After the reading of the counters : it is not part of the region
+    open.start = now_ns();
+    state.open.push_back(open);
+}
+
+void instr_end(int id) {
+    const long long end = now_ns();
+    ThreadState& state = thread_state();
+    double hardware[NB_HARDWARE] = {};
+    if (state.counters) state.counters->read(hardware);
+    auto it = std::find_if(state.open.rbegin(), state.open.rend(), [id](const Open& o) { return o.id == id; });
+    if (it == state.open.rend()) return;
+    const std::size_t depth = state.open.size() - 1 - (it - state.open.rbegin());
+    while (state.open.size() > depth) {
+        close_region(state, state.open.back(), end, hardware);
+        state.open.pop_back();
+    }
+}
+
+void instr_count(int id, double value) {
+    ThreadState& state = thread_state();
+    Stats& stats = state.at(id);
+    ++stats.counts;
+    stats.value += value;
+    if (config().trace.empty()) return;
+    if (state.events.size() >= max_events) {
+        ++state.dropped;
+        return;
+    }
+    state.events.push_back(Event{id, true, now_ns(), 0, stats.value, {}});
+}
+
+void instr_report(void) { write_report({local_summary()}, tracing() ? trace_events(0, origin_ns()) : ""); }
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+namespace instrument {
+long long origin_ns() { return config().origin; }
+
+bool tracing() { return !config().trace.empty(); }
+
+Summary local_summary() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    Summary summary;
+    summary.hardware = reg.hardware;
+    for (std::size_t id = 0; id < reg.names.size(); ++id) {
+        Entry entry;
+        entry.name = reg.names[id];
+        double total = 0.;
+        for (const auto& thread : reg.threads) {
+            if (id >= thread->stats.size()) continue;
+            const Stats& stats = thread->stats[id];
+            entry.calls += stats.calls;
+            entry.counts += stats.counts;
+            entry.value += stats.value;
+            for (int k = 0; k < NB_HARDWARE; ++k) entry.hardware[k] += stats.hardware[k];
+            if (stats.calls == 0) continue;
+            double time = 1.E-9 * double(stats.time);
+            entry.time = std::max(entry.time, time);
+            total += time;
+            entry.threads += 1.;
+        }
+        if (entry.calls == 0. && entry.counts == 0.) continue;
+        entry.thread_mean = entry.threads > 0. ? total / entry.threads : 0.;
+        summary.entries.push_back(entry);
+    }
+    for (const auto& thread : reg.threads) summary.dropped += thread->dropped;
+    return summary;
+}
+
+std::string trace_events(int pid, long long origin) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    std::string out;
+    char buffer[512];
+    std::snprintf(buffer, sizeof(buffer),
+                  "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"processus %d\"}}",
+                  pid, pid);
+    out += buffer;
+    std::vector<std::string> names;
+    for (const auto& name : reg.names) names.push_back(json_string(name));
+    for (const auto& thread : reg.threads) {
+        std::snprintf(buffer, sizeof(buffer),
+                      ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, "
+                      "\"args\": {\"name\": \"thread %d\"}}",
+                      pid, thread->tid, thread->tid);
+        out += buffer;
+        for (const Event& event : thread->events) {
+            const double ts = 1.E-3 * double(event.start - origin);
+            if (event.counter) {
+                std::snprintf(buffer, sizeof(buffer),
+                              ",\n{\"name\": %s, \"ph\": \"C\", \"ts\": %.3f, \"pid\": %d, \"tid\": %d, "
+                              "\"args\": {\"value\": %.6g}}",
+                              names[event.id].c_str(), ts, pid, thread->tid, event.value);
+                out += buffer;
+                continue;
+            }
+            std::snprintf(buffer, sizeof(buffer),
+                          ",\n{\"name\": %s, \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, \"tid\": %d",
+                          names[event.id].c_str(), ts, 1.E-3 * double(event.duration), pid, thread->tid);
+            out += buffer;
+            if (reg.hardware) {
+                const double* h = event.hardware;
+                std::snprintf(buffer, sizeof(buffer),
+                              ", \"args\": {\"cycles\": %.0f, \"instructions\": %.0f, \"cache_misses\": %.0f, "
+                              "\"flops\": %.0f}",
+                              h[CYCLES], h[INSTRUCTIONS], h[CACHE_MISSES], h[FLOPS]);
+                out += buffer;
+            }
+            out += "}";
+        }
+    }
+    return out;
+}
+
+void write_report(const std::vector<Summary>& processes, const std::string& events) {
+    const Config& conf = config();
+    std::vector<Merged> merged = merge(processes);
+    bool hardware = false;
+    long long dropped = 0;
+    for (const Summary& summary : processes) {
+        hardware = hardware || summary.hardware;
+        dropped += summary.dropped;
+    }
+    if (conf.report) print_table(merged, processes.size(), hardware, dropped);
+    if (!conf.json.empty()) write_json(conf.json, merged, processes.size(), hardware, dropped);
+    if (!conf.trace.empty()) {
+        std::ofstream out(conf.trace);
+        if (!out) {
+            std::fprintf(stderr, "INSTRUMENT_TRACE : impossible d'ecrire %s\n", conf.trace.c_str());
+            return;
+        }
+        out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n" << events << "\n]}\n";
+    }
+}
+}  // namespace instrument
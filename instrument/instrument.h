@@ -0,0 +1,121 @@
+#ifndef _INSTRUMENT_H_
+#define _INSTRUMENT_H_
+
+/*
+ * Instrumentation shared by the programs of the TPs (C and C++).
+ *
+ * Regions (timed, possibly nested) and counters (sums of values) are recorded
+ * per thread, then summed per process and over the MPI processes by the report.
+ * With -DNO_INSTRUMENT the INSTR_* macros expand to nothing.
+ *
+ * At run time, environment variables :
+ *     INSTRUMENT_REPORT=1          table of the regions and counters on stdout (process 0)
+ *     INSTRUMENT_JSON=file.json    the same summary, detailed per process
+ *     INSTRUMENT_TRACE=file.json   Chrome trace (chrome://tracing, ui.perfetto.dev) :
+ *                                  one pid per MPI process, one tid per thread
+ *     INSTRUMENT_PERF=1            hardware counters of every region (perf_event) :
+ *                                  cycles, instructions, last level cache misses and,
+ *                                  on Intel processors, double precision flops
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Seconds on the monotonic clock of the regions (also without instrumentation) */
+double instr_wtime(void);
+
+/* Reads the environment. Optional : done by the first call otherwise. */
+void instr_init(void);
+/* Identifier of the region or counter `name` (a string literal : the pointer
+   is cached per thread) */
+int instr_id(const char* name);
+void instr_begin(int id);
+/* Closes the innermost open region `id` of the thread (and the ones opened inside it) */
+void instr_end(int id);
+void instr_count(int id, double value);
+/* Single process report (see instrument_mpi.h for the MPI programs). To call
+   outside of any parallel region. */
+void instr_report(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#if defined(NO_INSTRUMENT)
+#define INSTR_INIT()
+#define INSTR_BEGIN(name)
+#define INSTR_END(name)
+#define INSTR_COUNT(name, value)
+#define INSTR_REPORT()
+#else
+#define INSTR_INIT() instr_init()
+#define INSTR_BEGIN(name) instr_begin(instr_id(name))
+#define INSTR_END(name) instr_end(instr_id(name))
+#define INSTR_COUNT(name, value) instr_count(instr_id(name), (value))
+#define INSTR_REPORT() instr_report()
+#endif
+
+#ifdef __cplusplus
+#include <string>
+#include <vector>
+
+namespace instrument {
+// Region open until the end of the scope
+class Scope {
+public:
+    explicit Scope(int id) : id(id) { instr_begin(id); }
+    ~Scope() { instr_end(id); }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    int id;
+};
+
+// Hardware counters of the regions, summed (see INSTRUMENT_PERF)
+enum Hardware { CYCLES, INSTRUCTIONS, CACHE_MISSES, FLOPS, NB_HARDWARE };
+
+// A region or counter of one process, its threads merged
+struct Entry {
+    std::string name;
+    double calls = 0.;        // closed regions, all threads
+    double time = 0.;         // largest total time of a thread in the region
+    double thread_mean = 0.;  // mean of these times over the threads which entered it
+    double threads = 0.;
+    double counts = 0.;       // calls of instr_count
+    double value = 0.;        // sum of the counted values
+    double hardware[NB_HARDWARE] = {};
+};
+
+struct Summary {
+    std::vector<Entry> entries;
+    bool hardware = false;    // hardware counters read
+    long long dropped = 0;    // trace events over the per thread limit
+};
+
+// Used by the MPI report
+Summary local_summary();
+// Chrome trace events of this process, comma separated, timestamps counted from `origin_ns`
+std::string trace_events(int pid, long long origin_ns);
+// Monotonic clock when the instrumentation started, in nanoseconds
+long long origin_ns();
+// INSTRUMENT_TRACE is set
+bool tracing();
+// Writes the report, the table and the JSON summary, from the summaries of all
+// the processes and their trace events
+void write_report(const std::vector<Summary>& processes, const std::string& events);
+}  // namespace instrument
+
+#if defined(NO_INSTRUMENT)
+#define INSTR_SCOPE(name)
+#else
+#define INSTR_CONCAT_(a, b) a##b
+#define INSTR_CONCAT(a, b) INSTR_CONCAT_(a, b)
+#define INSTR_SCOPE(name)                                                 \
+    static const int INSTR_CONCAT(instr_id_, __LINE__) = instr_id(name); \
+    instrument::Scope INSTR_CONCAT(instr_scope_, __LINE__)(INSTR_CONCAT(instr_id_, __LINE__))
+#endif
+#endif
+
+#endif
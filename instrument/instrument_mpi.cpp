@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "instrument_mpi.h"
+
+using namespace instrument;
+
+namespace {
+// Numbers of an entry, in this order
+const int entry_size = 6 + NB_HARDWARE;
+
+// Sizes of the blocks received by process 0, then their displacements
+std::vector<int> gather_sizes(int size, std::vector<int>& displs, MPI_Comm comm) {
+    int rank, nbp;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nbp);
+    std::vector<int> sizes(rank == 0 ? nbp : 0);
+    MPI_Gather(&size, 1, MPI_INT, sizes.data(), 1, MPI_INT, 0, comm);
+    displs.assign(sizes.size(), 0);
+    for (std::size_t p = 1; p < sizes.size(); ++p) displs[p] = displs[p - 1] + sizes[p - 1];
+    return sizes;
+}
+
+std::string gather_text(const std::string& text, MPI_Comm comm) {
+    std::vector<int> displs;
+    std::vector<int> sizes = gather_sizes(int(text.size()), displs, comm);
+    std::string all(sizes.empty() ? 0 : displs.back() + sizes.back(), '\0');
+    MPI_Gatherv(text.data(), int(text.size()), MPI_CHAR, &all[0], sizes.data(), displs.data(), MPI_CHAR, 0, comm);
+    return all;
+}
+}  // namespace
+
+extern "C" void instr_report_mpi(MPI_Comm comm) {
+    int rank, nbp;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nbp);
+
+    // Names separated by '\0', then the numbers of the entries and of the summary
+    Summary local = local_summary();
+    std::string names;
+    std::vector<double> numbers;
+    for (const Entry& entry : local.entries) {
+        names += entry.name;
+        names += '\0';
+        double values[entry_size] = {entry.calls, entry.time, entry.thread_mean, entry.threads, entry.counts,
+                                     entry.value};
+        std::copy(entry.hardware, entry.hardware + NB_HARDWARE, values + 6);
+        numbers.insert(numbers.end(), values, values + entry_size);
+    }
+    numbers.push_back(local.hardware ? 1. : 0.);
+    numbers.push_back(double(local.dropped));
+
+    std::string all_names = gather_text(names, comm);
+    std::vector<int> displs;
+    std::vector<int> sizes = gather_sizes(int(numbers.size()), displs, comm);
+    std::vector<double> all_numbers(sizes.empty() ? 0 : displs.back() + sizes.back());
+    MPI_Gatherv(numbers.data(), int(numbers.size()), MPI_DOUBLE, all_numbers.data(), sizes.data(), displs.data(),
+                MPI_DOUBLE, 0, comm);
+
+    // Events of all the processes on the time axis of the first one to start
+    int trace = tracing() ? 1 : 0;
+    MPI_Bcast(&trace, 1, MPI_INT, 0, comm);
+    std::string events;
+    if (trace) {
+        long long origin = origin_ns(), first = 0;
+        MPI_Allreduce(&origin, &first, 1, MPI_LONG_LONG, MPI_MIN, comm);
+        std::string mine = trace_events(rank, first);
+        if (rank > 0) mine.insert(0, ",\n");
+        events = gather_text(mine, comm);
+    }
+    if (rank != 0) return;
+
+    std::vector<Summary> processes(nbp);
+    const char* name = all_names.data();
+    for (int p = 0; p < nbp; ++p) {
+        const double* values = all_numbers.data() + displs[p];
+        const int nb_entries = (sizes[p] - 2) / entry_size;
+        for (int e = 0; e < nb_entries; ++e, values += entry_size) {
+            Entry entry;
+            entry.name = name;
+            name += entry.name.size() + 1;
+            entry.calls = values[0];
+            entry.time = values[1];
+            entry.thread_mean = values[2];
+            entry.threads = values[3];
+            entry.counts = values[4];
+            entry.value = values[5];
+            std::copy(values + 6, values + entry_size, entry.hardware);
+            processes[p].entries.push_back(entry);
+        }
+        processes[p].hardware = values[0] != 0.;
+        processes[p].dropped = (long long)values[1];
+    }
+    write_report(processes, events);
+}
@@ -0,0 +1,26 @@
+#ifndef _INSTRUMENT_MPI_H_
+#define _INSTRUMENT_MPI_H_
+
+#include <mpi.h>
+#include "instrument.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Report of all the processes of `comm` (collective), written by its process 0.
+   The trace shows the processes on the same time axis : the clocks of different
+   nodes are not synchronised. */
+void instr_report_mpi(MPI_Comm comm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#if defined(NO_INSTRUMENT)
+#define INSTR_REPORT_MPI(comm)
+#else
+#define INSTR_REPORT_MPI(comm) instr_report_mpi(comm)
+#endif
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef _BOUNDED_QUEUE_HPP_
+#define _BOUNDED_QUEUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Bounded multi-producer multi-consumer FIFO of D. Vyukov : a ring of cells, each
+// with a sequence number telling whether it may be written (sequence == position)
+// or read (sequence == position + 1) at the current turn. Producers and consumers
+// only contend on their own index with a CAS, no lock. The capacity is rounded up
+// to a power of 2. T must be cheap to copy (an index, a pointer).
+template <class T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(std::size_t capacity) {
+        std::size_t size = 2;
+        while (size < capacity) size *= 2;
+        cells.reset(new Cell[size]);
+        mask = size - 1;
+        for (std::size_t k = 0; k < size; ++k) cells[k].sequence.store(k, std::memory_order_relaxed);
+    }
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // false if the queue is full
+    bool try_push(const T& value) {
+        std::size_t position = tail.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[position & mask];
+            const std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const std::intptr_t turn = std::intptr_t(sequence) - std::intptr_t(position);
+            if (turn == 0) {
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+            } else if (turn < 0) {
+                return false;
+            } else {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = value;
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // false if the queue is empty
+    bool try_pop(T& value) {
+        std::size_t position = head.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[position & mask];
+            const std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const std::intptr_t turn = std::intptr_t(sequence) - std::intptr_t(position + 1);
+            if (turn == 0) {
+                if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+            } else if (turn < 0) {
+                return false;
+            } else {
+                position = head.load(std::memory_order_relaxed);
+            }
+        }
+        value = cell->value;
+        // Free for the producers of the next turn
+        cell->sequence.store(position + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when other threads push or pop
+    std::size_t size() const {
+        const std::size_t t = tail.load(std::memory_order_relaxed);
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        return t > h ? t - h : 0;
+    }
+    std::size_t capacity() const { return mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    std::size_t mask;
+    // Producers and consumers on different cache lines
+    char padding_tail[64];
+    std::atomic<std::size_t> tail{0};
+    char padding_head[64];
+    std::atomic<std::size_t> head{0};
+    char padding_end[64];
+};
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef _CHASE_LEV_HPP_
+#define _CHASE_LEV_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Work-stealing deque of Chase and Lev, with the memory orders of Lê, Pop, Cohen
+// and Zappa Nardelli ("Correct and efficient work-stealing for weak memory
+// models", PPoPP 2013). Its owner thread pushes and pops at the bottom, any
+// other thread steals at the top ; only the last element needs a CAS.
+// T must be trivially copyable (a pointer to a task). The array doubles when
+// full : the old ones are kept until the destruction, thieves may still read them.
+template <class T>
+class ChaseLevDeque {
+public:
+    explicit ChaseLevDeque(std::int64_t capacity = 256) {
+        std::int64_t size = 1;
+        while (size < capacity) size *= 2;
+        arrays.emplace_back(new Array(size));
+        array.store(arrays.back().get(), std::memory_order_relaxed);
+    }
+    ChaseLevDeque(const ChaseLevDeque&) = delete;
+    ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+    // Owner only
+    void push(T value) {
+        const std::int64_t b = bottom.load(std::memory_order_relaxed);
+        const std::int64_t t = top.load(std::memory_order_acquire);
+        Array* a = array.load(std::memory_order_relaxed);
+        if (b - t > a->mask) a = grow(a, b, t);
+        a->put(b, value);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // Owner only. Last pushed element, false when empty (or lost to a thief).
+    bool pop(T& value) {
+        const std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Array* a = array.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        value = a->get(b);
+        if (t == b) {
+            // Last element : race with the thieves
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // Any thread. Oldest element, false when empty or lost to another thread.
+    bool steal(T& value) {
+        std::int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const std::int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return false;
+        Array* a = array.load(std::memory_order_acquire);
+        value = a->get(t);
+        return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    // Approximate when other threads push or steal
+    std::int64_t size() const {
+        const std::int64_t b = bottom.load(std::memory_order_relaxed);
+        const std::int64_t t = top.load(std::memory_order_relaxed);
+        return b > t ? b - t : 0;
+    }
+
+private:
+    struct Array {
+        explicit Array(std::int64_t capacity) : mask(capacity - 1), slots(new std::atomic<T>[capacity]) {}
+        T get(std::int64_t i) const { return slots[i & mask].load(std::memory_order_relaxed); }
+        void put(std::int64_t i, T value) { slots[i & mask].store(value, std::memory_order_relaxed); }
+
+        std::int64_t mask;
+        std::unique_ptr<std::atomic<T>[]> slots;
+    };
+
+    Array* grow(Array* old, std::int64_t b, std::int64_t t) {
+        arrays.emplace_back(new Array(2 * (old->mask + 1)));
+        Array* a = arrays.back().get();
+        for (std::int64_t i = t; i < b; ++i) a->put(i, old->get(i));
+        array.store(a, std::memory_order_release);
+        return a;
+    }
+
+    // top and bottom on different cache lines (padding rather than alignas :
+    // over-aligned new needs C++17)
+    char padding_top[64];
+    std::atomic<std::int64_t> top{0};
+    char padding_bottom[64];
+    std::atomic<std::int64_t> bottom{0};
+    char padding_array[64];
+    std::atomic<Array*> array;
+    std::vector<std::unique_ptr<Array>> arrays;  // the current one last
+};
+
+#endif
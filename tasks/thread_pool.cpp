@@ -0,0 +1,197 @@
+#include <cstdlib>
+#include <stdexcept>
+#include <pthread.h>
+#include <sched.h>
+#include "thread_pool.hpp"
+
+namespace {
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local int current_index = 0;
+
+// Attempts to find a task before sleeping
+const int spin_rounds = 64;
+
+// Processors the process may run on
+std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+void pin_thread(pthread_t thread, int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(thread, sizeof(set), &set);
+}
+}  // namespace
+
+ThreadPool::ThreadPool(int nb_threads, bool pin) {
+    std::vector<int> allowed = allowed_cpus();
+    if (nb_threads <= 0) {
+        const char* env = std::getenv("POOL_NUM_THREADS");
+        nb_threads = env ? std::atoi(env) : int(allowed.size());
+    }
+    nb_threads = std::max(nb_threads, 1);
+    if (pin && !allowed.empty()) {
+        for (int k = 0; k < nb_threads; ++k) cpus.push_back(allowed[k % allowed.size()]);
+    }
+    for (int k = 0; k < nb_threads; ++k) {
+        workers.emplace_back(new Worker);
+        workers.back()->random = 2654435761u * (k + 1);
+    }
+    // The owner thread (worker 0) keeps its own affinity
+    for (int k = 1; k < nb_threads; ++k)
+        workers[k]->thread = std::thread(&ThreadPool::work, this, k, cpus.empty() ? -1 : cpus[k]);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop.store(true);
+        ++epoch;
+    }
+    wake.notify_all();
+    for (auto& worker : workers)
+        if (worker->thread.joinable()) worker->thread.join();
+    // Tasks submitted but never waited for
+    Task* task;
+    for (auto& worker : workers)
+        while (worker->deque.pop(task)) task->release();
+}
+
+int ThreadPool::worker_index() const { return current_pool == this ? current_index : 0; }
+
+void ThreadPool::submit(Task* task) {
+    workers[worker_index()]->deque.push(task);
+    if (workers.size() == 1) return;
+    // Pairs with the fence of sleep() : either the sleeper sees the task, or we see it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_relaxed) > 0) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++epoch;
+        }
+        wake.notify_one();
+    }
+}
+
+bool ThreadPool::run_one() {
+    const int index = worker_index();
+    Worker& self = *workers[index];
+    Task* task;
+    if (self.deque.pop(task)) {
+        execute(task);
+        return true;
+    }
+    // Victims in a random order : from a random worker, all of them
+    const int n = size();
+    if (n == 1) return false;
+    self.random ^= self.random << 13;
+    self.random ^= self.random >> 17;
+    self.random ^= self.random << 5;
+    const int first = int(self.random % unsigned(n));
+    for (int k = 0; k < n; ++k) {
+        const int victim = (first + k) % n;
+        if (victim != index && workers[victim]->deque.steal(task)) {
+            execute(task);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::has_work() const {
+    for (const auto& worker : workers)
+        if (worker->deque.size() > 0) return true;
+    return false;
+}
+
+void ThreadPool::sleep() {
+    std::unique_lock<std::mutex> lock(mutex);
+    const long seen = epoch;
+    sleepers.fetch_add(1, std::memory_order_relaxed);
+    lock.unlock();
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!has_work()) {
+        lock.lock();
+        wake.wait(lock, [this, seen] { return epoch != seen || stop.load(); });
+        lock.unlock();
+    }
+    sleepers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void ThreadPool::work(int index, int cpu) {
+    current_pool = this;
+    current_index = index;
+    if (cpu >= 0) pin_thread(pthread_self(), cpu);
+    int idle = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        if (run_one()) {
+            idle = 0;
+        } else if (++idle < spin_rounds) {
+            std::this_thread::yield();
+        } else {
+            sleep();
+            idle = 0;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// The node, then the successors it made ready : the last one directly, the
+// others given to the pool
+void TaskGraph::NodeTask::run() {
+    NodeTask* next = this;
+    while (next) {
+        next->work();
+        NodeTask* ready = nullptr;
+        for (NodeTask* successor : next->successors) {
+            if (successor->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) continue;
+            if (ready) pool->submit(ready);
+            ready = successor;
+        }
+        ++finished;
+        next = ready;
+    }
+}
+
+void TaskGraph::NodeTask::release() {
+    // The successors it ran may be released by now : only this node is read
+    std::atomic<long>& pending = graph.pending;
+    pending.fetch_sub(finished, std::memory_order_acq_rel);
+}
+
+TaskGraph::Node TaskGraph::add(std::function<void()> work, const std::vector<Node>& dependencies) {
+    const Node node = Node(nodes.size());
+    for (Node dependency : dependencies) {
+        if (dependency < 0 || dependency >= node) throw std::invalid_argument("TaskGraph : unknown dependency");
+    }
+    nodes.emplace_back(*this);
+    nodes.back().work = std::move(work);
+    for (Node dependency : dependencies) {
+        nodes[dependency].successors.push_back(&nodes.back());
+        ++nodes.back().nb_dependencies;
+    }
+    return node;
+}
+
+void TaskGraph::run(ThreadPool& pool) {
+    if (nodes.empty()) return;
+    for (auto& data : nodes) {
+        data.pool = &pool;
+        data.remaining.store(data.nb_dependencies, std::memory_order_relaxed);
+        data.finished = 0;
+    }
+    pending.store(long(nodes.size()), std::memory_order_relaxed);
+    // Roots in reverse order : the owner pops the first one first
+    for (Node node = Node(nodes.size()) - 1; node >= 0; --node) {
+        if (nodes[node].nb_dependencies == 0) pool.submit(&nodes[node]);
+    }
+    pool.wait([this] { return pending.load(std::memory_order_acquire) == 0; });
+}
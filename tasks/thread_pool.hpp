@@ -0,0 +1,171 @@
+#ifndef _THREAD_POOL_HPP_
+#define _THREAD_POOL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "chase_lev.hpp"
+
+// Unit of work of the pool, which calls release() once the task has run : by
+// default the task is deleted, tasks owned elsewhere override it. release() is
+// the last access of the pool to the task. A task must not throw.
+class Task {
+public:
+    virtual ~Task() = default;
+    virtual void run() = 0;
+    virtual void release() { delete this; }
+};
+
+// Persistent pool of threads, each with its Chase-Lev deque : a worker runs the
+// tasks it pushed last first and, when its deque is empty, steals the oldest
+// task of another worker. The thread which creates the pool is its worker 0 :
+// it takes part in the work while it waits (parallel_for, TaskGraph::run), and
+// it is the only thread outside of the pool allowed to submit. Idle workers spin
+// a little, then sleep until a task is submitted.
+class ThreadPool {
+public:
+    // nb_threads <= 0 : POOL_NUM_THREADS if set, else the number of processors the
+    // process may run on (with MPI, the ones the process is bound to). With `pin`,
+    // worker k is bound to the k-th of these processors.
+    explicit ThreadPool(int nb_threads = 0, bool pin = true);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return int(workers.size()); }
+    // Index of the calling thread in this pool, 0 for its owner and other threads
+    int worker_index() const;
+
+    void submit(Task* task);
+    // Runs one task of the calling worker's deque or stolen from another one,
+    // false if none was found
+    bool run_one();
+    // Runs tasks until `done()` is true
+    template <class Done>
+    void wait(Done done) {
+        while (!done()) {
+            if (!run_one()) std::this_thread::yield();
+        }
+    }
+
+    // body(b, e) on subranges covering [begin, end), at least `grain` iterations
+    // each but the last (grain <= 0 : about a sixteenth of the range per worker).
+    // Adaptive chunking by lazy binary splitting : a worker running a range gives
+    // away its upper half only when its deque is empty (its previous split was
+    // stolen), so the number of tasks follows the idle workers, not the range size.
+    template <class Body>
+    void parallel_for(long begin, long end, const Body& body, long grain = 0);
+
+private:
+    struct Worker {
+        ChaseLevDeque<Task*> deque;
+        std::thread thread;
+        unsigned random;  // victim selection
+    };
+
+    template <class Body>
+    class RangeTask;
+
+    void work(int index, int cpu);
+    void sleep();
+    bool has_work() const;
+    void execute(Task* task) {
+        task->run();
+        task->release();
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<int> cpus;  // processor of every worker, empty without pinning
+    std::atomic<bool> stop{false};
+    std::atomic<int> sleepers{0};
+    std::mutex mutex;
+    std::condition_variable wake;
+    long epoch = 0;  // submissions seen by sleeping workers, under `mutex`
+};
+
+template <class Body>
+class ThreadPool::RangeTask : public Task {
+public:
+    RangeTask(ThreadPool& pool, const Body& body, std::atomic<long>& remaining, long begin, long end, long grain)
+        : pool(pool), body(body), remaining(remaining), begin(begin), end(end), grain(grain) {}
+
+    void run() override {
+        long b = begin, e = end;
+        const long total = e - b;
+        while (b < e) {
+            if (pool.size() > 1) {
+                while (e - b > grain && pool.workers[pool.worker_index()]->deque.size() == 0) {
+                    const long middle = b + (e - b) / 2;
+                    pool.submit(new RangeTask(pool, body, remaining, middle, e, grain));
+                    e = middle;
+                }
+            }
+            const long chunk_end = std::min(e, b + grain);
+            body(b, chunk_end);
+            b = chunk_end;
+        }
+        // Iterations of this task, the given halves being counted by their own tasks
+        remaining.fetch_sub(total - (end - e), std::memory_order_acq_rel);
+    }
+
+private:
+    ThreadPool& pool;
+    const Body& body;
+    std::atomic<long>& remaining;
+    long begin, end, grain;
+};
+
+template <class Body>
+void ThreadPool::parallel_for(long begin, long end, const Body& body, long grain) {
+    if (end <= begin) return;
+    if (grain <= 0) grain = std::max(1L, (end - begin) / (16L * size()));
+    std::atomic<long> remaining(end - begin);
+    RangeTask<Body> root(*this, body, remaining, begin, end, grain);
+    root.run();
+    wait([&remaining] { return remaining.load(std::memory_order_acquire) == 0; });
+}
+
+// Directed acyclic graph of tasks : a node runs once all the nodes it depends on
+// are done, on any worker, without any global barrier. The graph is built once
+// and may be run several times.
+class TaskGraph {
+public:
+    using Node = int;
+
+    // Node running `work` after `dependencies` (nodes added before it).
+    // Throws std::invalid_argument otherwise.
+    Node add(std::function<void()> work, const std::vector<Node>& dependencies = {});
+    std::size_t size() const { return nodes.size(); }
+
+    // Runs every node and returns when they are all done
+    void run(ThreadPool& pool);
+
+private:
+    // A node is its own task, submitted at most once per run. The nodes it ran are
+    // counted off `pending` in release() : once `pending` is 0 the graph may be
+    // destroyed, so this must be the last access of the pool to the node.
+    struct NodeTask : public Task {
+        explicit NodeTask(TaskGraph& graph) : graph(graph) {}
+        void run() override;
+        void release() override;
+
+        TaskGraph& graph;
+        ThreadPool* pool = nullptr;
+        std::function<void()> work;
+        std::vector<NodeTask*> successors;
+        int nb_dependencies = 0;
+        std::atomic<int> remaining{0};
+        long finished = 0;  // nodes run by the last run(), this one and the successors it ran
+    };
+
+    std::deque<NodeTask> nodes;
+    std::atomic<long> pending{0};
+};
+
+#endif